@@ -31,17 +31,29 @@ static std::vector<char> readFile(const std::string& fileName)
 }
 
 #include <cstdint>
+#include <cstring>
 #include <limits>
 #include <stdexcept>
 #include <vector>
 #include <algorithm>
-#include <execution>
+#include <bit>
 #include <chrono>
 #include <memory>
+#include <mutex>
+#include <deque>
+#include <exception>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp> // for the snorm and half conversions of vertex attributes
 
 #ifndef IMGUI_IMPL_VULKAN_USE_VOLK
 #define IMGUI_IMPL_VULKAN_USE_VOLK
@@ -56,8 +68,33 @@ static std::vector<char> readFile(const std::string& fileName)
 
 #include "ktxvulkan.h"
 
+#include "id_hash_table.hpp"
+#include "meshopt_codec.hpp"
+#include "vertex_codec.hpp"
+
+void App::parseArguments(std::span<char* const> arguments)
+{
+  for (std::string_view argument : arguments.subspan(std::min<size_t>(1, arguments.size())))
+  {
+    if (argument == "--cook")
+    {
+      forceCook = true;
+    }
+    else if (argument == "--benchmark-welding")
+    {
+      benchmarkWelding = true;
+      forceCook = true;
+    }
+    else
+    {
+      throw std::runtime_error(std::string("unknown argument ").append(argument));
+    }
+  }
+}
+
 void App::run()
 {
+  startTime = std::chrono::steady_clock::now();
   initWindow();
   initVulkan();
   initImGui();
@@ -98,22 +135,31 @@ void App::initVulkan()
   createSurface();
   pickPhysicalDevice();
   createLogicalDevice();
+  allocator = std::make_unique<DeviceAllocator>(device, physicalDevice);
   createSwapChain();
   createSwapChainImageViews();
   createDescriptorSetLayout();
   createGraphicsPipeline();
+  createCullPipelines();
   createCommandPool();
   createDepthResources();
-  loadAsset(static_cast<std::filesystem::path>(model_path));
+  loadScene(static_cast<std::filesystem::path>(model_path));
+  uploadBatch = std::make_unique<UploadBatch>(device, physicalDevice, transferQueue, transferIndex, graphicsIndex);
   loadTextures(static_cast<std::filesystem::path>(model_path));
   createTextureSampler();
-  loadGeometry();
-  createVertexBuffer();
-  createIndexBuffers();
+  createMaterialBuffer();
+  createDrawBuffers();
+  createCellStreamer();
+  // textures go out now and follow from pumpUploads, geometry from streamCells, while frames are already being presented
+  uploadBatch->submit();
   createUniformBuffers();
+  createTransformBuffers();
+  createCullBuffers();
   createDescriptorPools();
   createDescriptorSets();
+  createDepthPyramidSets();
   createCommandBuffers();
+  createSecondaryCommandBuffers();
   createSyncObjects();
 }
 
@@ -241,8 +287,20 @@ void App::pickPhysicalDevice()
         }
       );
 
-      auto features = _physicalDevice.template getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan13Features, vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>();
-      bool supportsRequiredFeatures = features.template get<vk::PhysicalDeviceVulkan13Features>().dynamicRendering &&
+      auto features = _physicalDevice.template getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan11Features, vk::PhysicalDeviceVulkan12Features, vk::PhysicalDeviceVulkan13Features, vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>();
+      const auto& vulkan12Features = features.template get<vk::PhysicalDeviceVulkan12Features>();
+      const auto& coreFeatures = features.template get<vk::PhysicalDeviceFeatures2>().features;
+      bool supportsRequiredFeatures = coreFeatures.shaderSampledImageArrayDynamicIndexing &&
+                                      coreFeatures.multiDrawIndirect &&
+                                      coreFeatures.drawIndirectFirstInstance &&
+                                      features.template get<vk::PhysicalDeviceVulkan11Features>().shaderDrawParameters &&
+                                      vulkan12Features.drawIndirectCount &&
+                                      vulkan12Features.shaderSampledImageArrayNonUniformIndexing &&
+                                      vulkan12Features.descriptorBindingPartiallyBound &&
+                                      vulkan12Features.descriptorBindingVariableDescriptorCount &&
+                                      vulkan12Features.runtimeDescriptorArray &&
+                                      vulkan12Features.timelineSemaphore &&
+                                      features.template get<vk::PhysicalDeviceVulkan13Features>().dynamicRendering &&
                                       features.template get<vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>().extendedDynamicState;            
 
       return supportsVulkan1_3 && supportsSamplerAnisotropy && supportsGraphics && supportsAllRequiredExtensions && supportsRequiredFeatures;
@@ -294,34 +352,89 @@ uint32_t findQueueFamilies(const vk::raii::PhysicalDevice& _physicalDevice, cons
   return queueFamilyIndex;
 }
 
+// Uploads go to their own family when there is one, so copies run on the DMA engines alongside rendering
+uint32_t findTransferQueueFamily(const vk::raii::PhysicalDevice& _physicalDevice, uint32_t graphicsFamily)
+{
+  std::vector<vk::QueueFamilyProperties> queueFamilyProperties = _physicalDevice.getQueueFamilyProperties();
+
+  // a transfer-only family is the dedicated copy engine
+  for (uint32_t qfpIndex = 0; qfpIndex < queueFamilyProperties.size(); qfpIndex++)
+  {
+    auto flags = queueFamilyProperties[qfpIndex].queueFlags;
+    if ((flags & vk::QueueFlagBits::eTransfer) && !(flags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)))
+    {
+      return qfpIndex;
+    }
+  }
+
+  // otherwise any other family still runs in parallel with the graphics queue, e.g. async compute
+  for (uint32_t qfpIndex = 0; qfpIndex < queueFamilyProperties.size(); qfpIndex++)
+  {
+    if (qfpIndex != graphicsFamily && (queueFamilyProperties[qfpIndex].queueFlags & (vk::QueueFlagBits::eTransfer | vk::QueueFlagBits::eCompute)))
+    {
+      return qfpIndex;
+    }
+  }
+
+  // single family devices upload on the graphics queue, the upload path stays asynchronous
+  return graphicsFamily;
+}
+
 void App::createLogicalDevice()
 {
   auto queueFamilyIndex = findQueueFamilies(physicalDevice, surface);
-
-  vk::StructureChain<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan13Features, vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT> featureChain = {
-    { .features = {.samplerAnisotropy = vk::True}},
+  auto transferFamilyIndex = findTransferQueueFamily(physicalDevice, queueFamilyIndex);
+
+  vk::StructureChain<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan11Features, vk::PhysicalDeviceVulkan12Features, vk::PhysicalDeviceVulkan13Features, vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT> featureChain = {
+    // each indirect call draws a whole group's commands, whose firstInstance picks the batch's transforms
+    { .features = {.multiDrawIndirect = vk::True, .drawIndirectFirstInstance = vk::True, .samplerAnisotropy = vk::True, .shaderSampledImageArrayDynamicIndexing = vk::True}},
+    // the draw index of an indirect draw picks its draw data
+    {.shaderDrawParameters = true},
+    // indirect draws with counts, and descriptor indexing for the bindless texture array, indexed per draw from the fragment shader
+    {
+      .drawIndirectCount = true,
+      .shaderSampledImageArrayNonUniformIndexing = true,
+      .descriptorBindingPartiallyBound = true,
+      .descriptorBindingVariableDescriptorCount = true,
+      .runtimeDescriptorArray = true,
+      .timelineSemaphore = true
+    },
     {.synchronization2 = true, .dynamicRendering = true},
     {.extendedDynamicState = true}
   };
   
   float queuePriority = 0.0f;
 
-  vk::DeviceQueueCreateInfo deviceQueueCreateInfo {
-    .queueFamilyIndex = queueFamilyIndex,
-    .queueCount = 1,
-    .pQueuePriorities = &queuePriority
+  std::vector<vk::DeviceQueueCreateInfo> deviceQueueCreateInfos {
+    {
+      .queueFamilyIndex = queueFamilyIndex,
+      .queueCount = 1,
+      .pQueuePriorities = &queuePriority
+    }
   };
+  if (transferFamilyIndex != queueFamilyIndex)
+  {
+    deviceQueueCreateInfos.push_back({
+      .queueFamilyIndex = transferFamilyIndex,
+      .queueCount = 1,
+      .pQueuePriorities = &queuePriority
+    });
+  }
+
   vk::DeviceCreateInfo deviceCreateInfo {
     .pNext = &featureChain.get<vk::PhysicalDeviceFeatures2>(),
-    .queueCreateInfoCount = 1,
-    .pQueueCreateInfos = &deviceQueueCreateInfo,
+    .queueCreateInfoCount = static_cast<uint32_t>(deviceQueueCreateInfos.size()),
+    .pQueueCreateInfos = deviceQueueCreateInfos.data(),
     .enabledExtensionCount = static_cast<uint32_t>(requiredDeviceExtensions.size()),
     .ppEnabledExtensionNames = requiredDeviceExtensions.data()
   };
 
   device = vk::raii::Device(physicalDevice, deviceCreateInfo);
   queue = vk::raii::Queue(device, queueFamilyIndex, 0);
+  // same VkQueue as queue without a separate family, only ever used from the main thread
+  transferQueue = vk::raii::Queue(device, transferFamilyIndex, 0);
   graphicsIndex = queueFamilyIndex;
+  transferIndex = transferFamilyIndex;
   (void) computeIndex;
 
   volkLoadDevice(static_cast<VkDevice>(*device));
@@ -422,17 +535,75 @@ void App::createSwapChainImageViews()
 
 void App::createDescriptorSetLayout()
 {
+  // the scene is not loaded yet, so the texture array is as long as the device allows and each set says how much of it it uses
+  const vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+  maxBindlessTextures = std::min({
+    MAX_BINDLESS_TEXTURES,
+    limits.maxPerStageDescriptorSamplers,
+    limits.maxPerStageDescriptorSampledImages,
+    limits.maxDescriptorSetSamplers,
+    limits.maxDescriptorSetSampledImages
+  });
+
+  // the texture array has to be the last binding to have a variable count
   std::array bindings = {
     vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr),
-    vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment, nullptr),
+    vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment, nullptr),
+    vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr),
+    vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr),
+    vk::DescriptorSetLayoutBinding(4, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr),
+    vk::DescriptorSetLayoutBinding(5, vk::DescriptorType::eCombinedImageSampler, maxBindlessTextures, vk::ShaderStageFlagBits::eFragment, nullptr),
+  };
+  // textures are written as they finish uploading, draws only index the ones that have been
+  std::array<vk::DescriptorBindingFlags, bindings.size()> bindingFlags = {
+    vk::DescriptorBindingFlags{},
+    vk::DescriptorBindingFlags{},
+    vk::DescriptorBindingFlags{},
+    vk::DescriptorBindingFlags{},
+    vk::DescriptorBindingFlags{},
+    vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eVariableDescriptorCount
+  };
+  vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo {
+    .bindingCount = static_cast<uint32_t>(bindingFlags.size()),
+    .pBindingFlags = bindingFlags.data()
   };
 
   vk::DescriptorSetLayoutCreateInfo layoutInfo {
+    .pNext = &bindingFlagsInfo,
     .bindingCount = static_cast<uint32_t>(bindings.size()),
     .pBindings = bindings.data()
   };
 
   descriptorSetLayout = vk::raii::DescriptorSetLayout(device, layoutInfo);
+
+  // see cull.slang, it reads the same uniform, transform and draw data buffers as the graphics set
+  std::array cullBindings = {
+    vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+    vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+    vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+    vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+    vk::DescriptorSetLayoutBinding(4, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+    vk::DescriptorSetLayoutBinding(5, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+    vk::DescriptorSetLayoutBinding(6, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+    vk::DescriptorSetLayoutBinding(7, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+    vk::DescriptorSetLayoutBinding(8, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+    vk::DescriptorSetLayoutBinding(9, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+    vk::DescriptorSetLayoutBinding(10, vk::DescriptorType::eSampledImage, 1, vk::ShaderStageFlagBits::eCompute, nullptr)
+  };
+  cullSetLayout = vk::raii::DescriptorSetLayout(device, vk::DescriptorSetLayoutCreateInfo {
+    .bindingCount = static_cast<uint32_t>(cullBindings.size()),
+    .pBindings = cullBindings.data()
+  });
+
+  // see pyramid.slang
+  std::array pyramidBindings = {
+    vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eSampledImage, 1, vk::ShaderStageFlagBits::eCompute, nullptr),
+    vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute, nullptr)
+  };
+  pyramidSetLayout = vk::raii::DescriptorSetLayout(device, vk::DescriptorSetLayoutCreateInfo {
+    .bindingCount = static_cast<uint32_t>(pyramidBindings.size()),
+    .pBindings = pyramidBindings.data()
+  });
 }
 
 void App::createGraphicsPipeline()
@@ -451,11 +622,11 @@ void App::createGraphicsPipeline()
   };
   vk::PipelineShaderStageCreateInfo shaderStages[] = {vertShaderModuleCreateInfo, fragShaderModuleCreateInfo};
   
-  auto bindingDescription = Vertex::getBindingDescription();
+  auto bindingDescriptions = Vertex::getBindingDescriptions();
   auto attributesDescriptions = Vertex::getAttributeDescriptions();
   vk::PipelineVertexInputStateCreateInfo vertexInputInfo {
-    .vertexBindingDescriptionCount = 1,
-    .pVertexBindingDescriptions = &bindingDescription,
+    .vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size()),
+    .pVertexBindingDescriptions = bindingDescriptions.data(),
     .vertexAttributeDescriptionCount = static_cast<uint32_t>(attributesDescriptions.size()),
     .pVertexAttributeDescriptions = attributesDescriptions.data()
   };
@@ -500,7 +671,8 @@ void App::createGraphicsPipeline()
   {
     .depthTestEnable = vk::True,
     .depthWriteEnable = vk::True,
-    .depthCompareOp = vk::CompareOp::eLess,
+    // passes the depth the prepass laid down for the same surface
+    .depthCompareOp = vk::CompareOp::eLessOrEqual,
     .depthBoundsTestEnable = vk::False,
     .stencilTestEnable = vk::False
   };
@@ -524,10 +696,17 @@ void App::createGraphicsPipeline()
     .pAttachments = &colorBlendAttachment
   };
 
+  vk::PushConstantRange drawConstantsRange {
+    .stageFlags = vk::ShaderStageFlagBits::eVertex,
+    .offset = 0,
+    .size = sizeof(DrawConstants)
+  };
+
   vk::PipelineLayoutCreateInfo pipelineLayoutInfo {
     .setLayoutCount = 1,
     .pSetLayouts = &*descriptorSetLayout,
-    .pushConstantRangeCount = 0
+    .pushConstantRangeCount = 1,
+    .pPushConstantRanges = &drawConstantsRange
   };
   pipelineLayout = vk::raii::PipelineLayout(device, pipelineLayoutInfo);
 
@@ -555,6 +734,57 @@ void App::createGraphicsPipeline()
   };
 
   graphicsPipeline = vk::raii::Pipeline(device, nullptr, graphicsPipelineInfo);
+
+  // the depth prepass runs in the same rendering as the colour pass, so it keeps the attachment and writes none of it
+  vk::PipelineShaderStageCreateInfo depthShaderModuleCreateInfo {
+    .stage = vk::ShaderStageFlagBits::eVertex,
+    .module = shaderModule,
+    .pName = "depthMain"
+  };
+  vk::PipelineVertexInputStateCreateInfo positionInputInfo {
+    .vertexBindingDescriptionCount = 1,
+    .pVertexBindingDescriptions = &bindingDescriptions[0],
+    .vertexAttributeDescriptionCount = 1,
+    .pVertexAttributeDescriptions = &attributesDescriptions[0]
+  };
+  depthStencil.depthCompareOp = vk::CompareOp::eLess;
+  colorBlendAttachment.colorWriteMask = {};
+  graphicsPipelineInfo.stageCount = 1;
+  graphicsPipelineInfo.pStages = &depthShaderModuleCreateInfo;
+  graphicsPipelineInfo.pVertexInputState = &positionInputInfo;
+  depthPipeline = vk::raii::Pipeline(device, nullptr, graphicsPipelineInfo);
+}
+
+void App::createCullPipelines()
+{
+  // each compute pass is a module of its own beside shader_path
+  auto createComputePipeline = [&](const char* fileName, const char* entry, const vk::raii::DescriptorSetLayout& setLayout,
+                                   uint32_t pushConstantsSize, vk::raii::PipelineLayout& layout, vk::raii::Pipeline& pipeline)
+  {
+    auto shaderModule = createShaderModule(readFile(std::filesystem::path(shader_path).replace_filename(fileName).string()));
+    vk::PushConstantRange pushConstantRange {
+      .stageFlags = vk::ShaderStageFlagBits::eCompute,
+      .offset = 0,
+      .size = pushConstantsSize
+    };
+    layout = vk::raii::PipelineLayout(device, vk::PipelineLayoutCreateInfo {
+      .setLayoutCount = 1,
+      .pSetLayouts = &*setLayout,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges = &pushConstantRange
+    });
+    vk::ComputePipelineCreateInfo pipelineInfo {
+      .stage = {
+        .stage = vk::ShaderStageFlagBits::eCompute,
+        .module = shaderModule,
+        .pName = entry
+      },
+      .layout = layout
+    };
+    pipeline = vk::raii::Pipeline(device, nullptr, pipelineInfo);
+  };
+  createComputePipeline("cull.spv", "cullMain", cullSetLayout, sizeof(CullConstants), cullPipelineLayout, cullPipeline);
+  createComputePipeline("pyramid.spv", "pyramidMain", pyramidSetLayout, sizeof(PyramidConstants), pyramidPipelineLayout, pyramidPipeline);
 }
 
 [[nodiscard]] vk::raii::ShaderModule App::createShaderModule(const std::vector<char>& code) const 
@@ -574,7 +804,8 @@ void App::createGraphicsPipeline()
   return findSupportedFormat(
     {vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint},
     vk::ImageTiling::eOptimal,
-    vk::FormatFeatureFlagBits::eDepthStencilAttachment
+    // the depth pyramid is built from it
+    vk::FormatFeatureFlagBits::eDepthStencilAttachment | vk::FormatFeatureFlagBits::eSampledImage
   );
 }
 
@@ -611,18 +842,55 @@ void App::createCommandPool()
 void App::createDepthResources()
 {
   vk::Format depthFormat = findDepthFormat();
+  depthImageFormat = depthFormat;
   createImage(
     swapChainExtent.width,
     swapChainExtent.height,
     1,
     depthFormat,
     vk::ImageTiling::eOptimal,
-    vk::ImageUsageFlagBits::eDepthStencilAttachment,
+    vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled,
     vk::MemoryPropertyFlagBits::eDeviceLocal,
     depthImage,
     depthImageMemory
   );
   depthImageView = createImageView(depthImage, depthFormat, vk::ImageAspectFlagBits::eDepth, 1);
+
+  // level 0 matches the depth buffer texel for texel, each level after is half the last rounded down, down to 1x1
+  depthPyramidLevelViews.clear();
+  depthPyramidLevels = static_cast<uint32_t>(std::bit_width(std::max(swapChainExtent.width, swapChainExtent.height)));
+  if (depthPyramidLevels > MAX_DEPTH_PYRAMID_LEVELS)
+  {
+    throw std::runtime_error(std::string("failed to fit a depth pyramid of ").append(std::to_string(depthPyramidLevels)).append(" levels"));
+  }
+  createImage(
+    swapChainExtent.width,
+    swapChainExtent.height,
+    depthPyramidLevels,
+    vk::Format::eR32Sfloat,
+    vk::ImageTiling::eOptimal,
+    vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage,
+    vk::MemoryPropertyFlagBits::eDeviceLocal,
+    depthPyramid,
+    depthPyramidMemory
+  );
+  depthPyramidView = createImageView(depthPyramid, vk::Format::eR32Sfloat, vk::ImageAspectFlagBits::eColor, depthPyramidLevels);
+  for (uint32_t level = 0; level < depthPyramidLevels; level++)
+  {
+    depthPyramidLevelViews.emplace_back(device, vk::ImageViewCreateInfo {
+      .image = depthPyramid,
+      .viewType = vk::ImageViewType::e2D,
+      .format = vk::Format::eR32Sfloat,
+      .subresourceRange = {
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .baseMipLevel = level,
+        .levelCount = 1,
+        .baseArrayLayer = 0,
+        .layerCount = 1
+      }
+    });
+  }
+  depthPyramidValid = false;
 }
 
 void App::createImage(
@@ -632,7 +900,7 @@ void App::createImage(
   vk::ImageUsageFlags usage,
   vk::MemoryPropertyFlags properties,
   vk::raii::Image& image,
-  vk::raii::DeviceMemory& imageMemory
+  DeviceAllocation& imageMemory
 )
 {
   vk::ImageCreateInfo imageInfo {
@@ -651,28 +919,8 @@ void App::createImage(
   image = vk::raii::Image( device, imageInfo );
 
   vk::MemoryRequirements memRequirements = image.getMemoryRequirements();
-  vk::MemoryAllocateInfo allocInfo{
-    .allocationSize = memRequirements.size, 
-    .memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties)
-  };
-  imageMemory = vk::raii::DeviceMemory(device, allocInfo);
-  image.bindMemory(imageMemory, 0);
-}
-
-uint32_t App::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties)
-{
-  // typeFilter is a bitmask, and we iterate over it by shifting 1 by i
-  // then we check if it has the same properties as properties
-  vk::PhysicalDeviceMemoryProperties memProperties = physicalDevice.getMemoryProperties();
-  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
-  {
-    if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-    {
-      return i;
-    }
-  }
-
-  throw std::runtime_error("failed to find suitable memory type!");
+  imageMemory = allocator->allocate(memRequirements, properties, tiling == vk::ImageTiling::eLinear);
+  image.bindMemory(imageMemory.getMemory(), imageMemory.getOffset());
 }
 
 [[nodiscard]] vk::raii::ImageView App::createImageView(
@@ -698,221 +946,670 @@ uint32_t App::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags proper
   return vk::raii::ImageView(device, viewInfo);
 }
 
-void App::loadAsset(std::filesystem::path path)
+void App::loadScene(std::filesystem::path path)
 {
-  fastgltf::Parser parser;
-  constexpr auto options = fastgltf::Options::LoadExternalBuffers;
-  auto data = fastgltf::GltfDataBuffer::FromPath(path);
-  if (data.error() != fastgltf::Error::None)
-    throw std::runtime_error(std::string("failed to load ").append(path.string()));
-  else
-    std::clog << "loaded " << path << std::endl;
-
-  auto parsed = parser.loadGltf(data.get(), path.parent_path(), options);
-  if (parsed.error() != fastgltf::Error::None)
-    throw std::runtime_error(std::string("failed to parse ").append(path.string()));
-  else
-    std::clog << "parsed " << path << std::endl;
+  auto start = std::chrono::steady_clock::now();
 
-  if (fastgltf::validate(parsed.get()) != fastgltf::Error::None)
-    throw std::runtime_error(std::string("failed to validate ").append(path.string()));
+  stats.sceneCacheHit = !forceCook && loadSceneCache(path);
+  if (!stats.sceneCacheHit)
+  {
+    loadAsset(path);
+    collectMaterialTextures();
+    loadGeometry();
+    loadNodes();
+    weldVertices();
+    optimizeGeometry();
+    createMeshlets();
+    createLods();
+    createCells();
+    writeSceneCache(path);
+    // cells stream out of the cache just written as on a warm start, and the cooked copies leave host memory,
+    // when it could not be written they stay and count against the host budget
+    if (sceneCache.open(sceneCachePath(path), path.parent_path(), sizeof(Vertex)))
+    {
+      cellVertices = sceneCache.get<Vertex>(SceneCacheSection::Vertices);
+      cellIndices = sceneCache.get<uint32_t>(SceneCacheSection::Indices);
+      vertices = {};
+      indices = {};
+      cookedHostBytes = 0U;
+    }
+    else
+    {
+      cellVertices = vertices;
+      cellIndices = indices;
+      cookedHostBytes = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t);
+    }
+  }
   else
-    std::clog << "validated " << path << std::endl;
+  {
+    // the cache holds optimized indices only
+    stats.vertexCacheAfter = measureVertexCache(cellIndices);
+  }
+  createDrawBatches();
 
-  asset = std::move(parsed.get());
+  auto end = std::chrono::steady_clock::now();
+  stats.sceneLoadTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+  std::clog << (stats.sceneCacheHit ? "read scene cache for " : "cooked ") << path << " in " << stats.sceneLoadTime << "us" << std::endl;
 }
 
-void App::loadTextures(std::filesystem::path path)
+bool App::loadSceneCache(std::filesystem::path path)
 {
-  textureImages.clear();
-  textureImagesMemory.clear();
-  textureImageViews.clear();
-
-  //std::for_each(std::execution::par, asset.materials.begin(), asset.materials.end(), [&](auto& material)
-  for (auto& material : asset.materials)
+  if (!sceneCache.open(sceneCachePath(path), path.parent_path(), sizeof(Vertex)))
   {
-    fastgltf::Image image = asset.images[asset.textures[material.pbrData.baseColorTexture->textureIndex].imageIndex.value()];
-    std::visit(
-      fastgltf::visitor { [](auto& args) { (void)args; }, [&](fastgltf::sources::URI& filePath)
-        {
-            const std::string texturePath = path.parent_path().append(filePath.uri.path().begin(), filePath.uri.path().end()).string();
-            auto image = createTextureImage(texturePath.c_str());
-            textureImages.emplace_back(std::move(image.first));
-            textureImagesMemory.emplace_back(std::move(image.second));
-        }
-      },
-      image.data);
+    std::clog << "no up to date scene cache for " << path << std::endl;
+    return false;
   }
-  //);
-}
 
-[[nodiscard]] std::pair<vk::raii::Image, vk::raii::DeviceMemory> App::createTextureImage(const char* texturePath)
-{
-  ktxTexture2* kTexture;
-  auto result = ktxTexture2_CreateFromNamedFile(texturePath, KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &kTexture);
+  // a truncated or inconsistent cache is cooked over like a stale one, nothing read from it so far is kept
+  // and the mapping is let go so the cook can replace the file
+  auto rejectSceneCache = [&]()
+  {
+    std::clog << "warning: corrupt scene cache for " << path << ", cooking it again" << std::endl;
+    cellVertices = {};
+    cellIndices = {};
+    meshlets.clear();
+    cells.clear();
+    prims.clear();
+    meshes.clear();
+    sceneGraph.clear();
+    meshInstances.clear();
+    materialTextures.clear();
+    materials.clear();
+    shortIndexCount = 0U;
+    sceneCache = SceneCache{};
+    return false;
+  };
 
-  if (result != KTX_SUCCESS)
+  // geometry stays in the mapping, cells are read out of it as they are streamed in
+  auto cachedVertices = sceneCache.get<Vertex>(SceneCacheSection::Vertices);
+  auto cachedIndices = sceneCache.get<uint32_t>(SceneCacheSection::Indices);
+  auto cachedPrims = sceneCache.get<CachedPrim>(SceneCacheSection::Prims);
+  auto cachedMeshlets = sceneCache.get<Meshlet>(SceneCacheSection::Meshlets);
+  auto cachedMeshes = sceneCache.get<CachedMesh>(SceneCacheSection::Meshes);
+  auto cachedNodes = sceneCache.get<CachedNode>(SceneCacheSection::Nodes);
+  auto cachedCells = sceneCache.get<CachedCell>(SceneCacheSection::Cells);
+
+  cellVertices = cachedVertices;
+  cellIndices = cachedIndices;
+  meshlets.assign(cachedMeshlets.begin(), cachedMeshlets.end());
+
+  cells.clear();
+  cells.reserve(cachedCells.size());
+  shortIndexCount = 0U;
+  for (const auto& cachedCell : cachedCells)
   {
-    throw std::runtime_error("failed to load ktx texture image!");
+    if (static_cast<size_t>(cachedCell.firstVertex) + cachedCell.vertexCount > cachedVertices.size() ||
+        static_cast<size_t>(cachedCell.firstShortIndex) + cachedCell.shortIndexCount > cachedIndices.size() ||
+        static_cast<size_t>(cachedCell.firstWideIndex) + cachedCell.wideIndexCount > cachedIndices.size())
+    {
+      return rejectSceneCache();
+    }
+    auto& cell = cells.emplace_back();
+    cell.boundsMin = glm::vec3(cachedCell.boundsMin[0], cachedCell.boundsMin[1], cachedCell.boundsMin[2]);
+    cell.boundsMax = glm::vec3(cachedCell.boundsMax[0], cachedCell.boundsMax[1], cachedCell.boundsMax[2]);
+    cell.firstVertex = cachedCell.firstVertex;
+    cell.vertexCount = cachedCell.vertexCount;
+    cell.firstShortIndex = cachedCell.firstShortIndex;
+    cell.shortIndexCount = cachedCell.shortIndexCount;
+    cell.firstWideIndex = cachedCell.firstWideIndex;
+    cell.wideIndexCount = cachedCell.wideIndexCount;
+    shortIndexCount += cell.shortIndexCount;
   }
 
-  auto texWidth = kTexture->baseWidth;
-  auto texHeight = kTexture->baseHeight;
-  auto mipLevels = kTexture->numLevels;
-  auto imageSize = ktxTexture_GetDataSize(ktxTexture(kTexture));
-  auto ktxTextureData = ktxTexture_GetData(ktxTexture(kTexture));
+  // every range a primitive draws has to lie inside its cell, the cell's buffer is all that is bound for it
+  auto inCell = [&](const GeometryCell& cell, uint32_t firstIndex, uint32_t indexCount)
+  {
+    const bool inShort = firstIndex >= cell.firstShortIndex && firstIndex + static_cast<size_t>(indexCount) <= cell.firstShortIndex + static_cast<size_t>(cell.shortIndexCount);
+    const bool inWide = firstIndex >= cell.firstWideIndex && firstIndex + static_cast<size_t>(indexCount) <= cell.firstWideIndex + static_cast<size_t>(cell.wideIndexCount);
+    return indexCount == 0 || inShort || inWide;
+  };
 
-  vk::Format textureFormat = static_cast<vk::Format>(ktxTexture2_GetVkFormat(kTexture));
+  prims.clear();
+  prims.reserve(cachedPrims.size());
+  for (const auto& cachedPrim : cachedPrims)
+  {
+    if (cachedPrim.cell >= cells.size() || cachedPrim.lodCount >= MAX_LOD_LEVELS)
+    {
+      return rejectSceneCache();
+    }
+    const GeometryCell& cell = cells[cachedPrim.cell];
+    const bool lodsInRange = std::ranges::all_of(
+      std::span(cachedPrim.lods).first(cachedPrim.lodCount),
+      [&](const LodLevel& lod) { return inCell(cell, lod.firstIndex, lod.indexCount); }
+    );
+    if (!inCell(cell, cachedPrim.firstIndex, cachedPrim.indexCount) ||
+        (cachedPrim.indexCount > 0 && (cachedPrim.vertexOffset < static_cast<int32_t>(cell.firstVertex) ||
+                                       cachedPrim.vertexOffset >= static_cast<int64_t>(cell.firstVertex) + cell.vertexCount)) ||
+        static_cast<size_t>(cachedPrim.firstMeshlet) + cachedPrim.meshletCount > cachedMeshlets.size() ||
+        !lodsInRange)
+    {
+      return rejectSceneCache();
+    }
 
-  vk::raii::Buffer stagingBuffer({});
-  vk::raii::DeviceMemory stagingBufferMemory({});
+    auto& p = prims.emplace_back(PrimData{});
+    // no asset is parsed on a warm start, so there is no mesh to point back to
+    p.parent = nullptr;
+    p.firstIndex = cachedPrim.firstIndex;
+    p.indexCount = cachedPrim.indexCount;
+    p.vertexOffset = cachedPrim.vertexOffset;
+    p.cell = cachedPrim.cell;
+    p.boundsMin = glm::vec3(cachedPrim.boundsMin[0], cachedPrim.boundsMin[1], cachedPrim.boundsMin[2]);
+    p.boundsExtent = glm::vec3(cachedPrim.boundsExtent[0], cachedPrim.boundsExtent[1], cachedPrim.boundsExtent[2]);
+    p.placement = glm::vec3(cachedPrim.placement[0], cachedPrim.placement[1], cachedPrim.placement[2]);
+    p.firstMeshlet = cachedPrim.firstMeshlet;
+    p.meshletCount = cachedPrim.meshletCount;
+    p.lodCount = cachedPrim.lodCount;
+    p.lods = cachedPrim.lods;
+    p.materialIndex = cachedPrim.materialIndex;
+  }
 
-  createBuffer(
-    imageSize,
-    vk::BufferUsageFlagBits::eTransferSrc,
-    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-    stagingBuffer,
-    stagingBufferMemory
-  );
+  meshes.clear();
+  for (const auto& cachedMesh : cachedMeshes)
+  {
+    if (static_cast<size_t>(cachedMesh.firstPrim) + cachedMesh.primCount > prims.size())
+    {
+      return rejectSceneCache();
+    }
+    meshes.push_back({ .firstPrim = cachedMesh.firstPrim, .primCount = cachedMesh.primCount });
+  }
 
-  void* data = stagingBufferMemory.mapMemory(0, imageSize);
-  memcpy(data, ktxTextureData, imageSize);
-  stagingBufferMemory.unmapMemory();
-  
-  vk::raii::Image textureImage = nullptr;
-  vk::raii::DeviceMemory textureImageMemory = nullptr;
-  
-  createImage(texWidth, texHeight, mipLevels, textureFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal, textureImage, textureImageMemory);
-  
-  //textureImages.emplace_back(std::move(tempImage));
-  //textureImagesMemory.emplace_back(std::move(tempMemory));
-  
-  transitionImageLayout(textureImage, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, mipLevels);
-  copyBufferToImage(stagingBuffer, textureImage, texWidth, texHeight, mipLevels, kTexture);
-  transitionImageLayout(textureImage, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, mipLevels);
-  
-  ktxTexture2_Destroy(kTexture);
-  
-  createTextureImageView(textureImage, textureFormat, mipLevels);
-  return std::make_pair(std::move(textureImage), std::move(textureImageMemory));
-}
+  sceneGraph.clear();
+  meshInstances.clear();
+  for (const auto& cachedNode : cachedNodes)
+  {
+    const uint32_t node = static_cast<uint32_t>(sceneGraph.size());
+    if ((cachedNode.parent != SceneGraph::NO_PARENT && cachedNode.parent >= node) ||
+        (cachedNode.mesh != ~0U && cachedNode.mesh >= meshes.size()))
+    {
+      return rejectSceneCache();
+    }
+    sceneGraph.addNode(
+      cachedNode.parent,
+      glm::vec3(cachedNode.translation[0], cachedNode.translation[1], cachedNode.translation[2]),
+      glm::quat(cachedNode.rotation[3], cachedNode.rotation[0], cachedNode.rotation[1], cachedNode.rotation[2]),
+      glm::vec3(cachedNode.scale[0], cachedNode.scale[1], cachedNode.scale[2])
+    );
+    if (cachedNode.mesh != ~0U) meshInstances.push_back({ .node = node, .mesh = cachedNode.mesh });
+  }
 
-void App::createBuffer(
-  vk::DeviceSize size,
-  vk::BufferUsageFlags usage,
-  vk::MemoryPropertyFlags properties,
-  vk::raii::Buffer& buffer,
-  vk::raii::DeviceMemory& bufferMemory
-)
-{
-  vk::BufferCreateInfo bufferInfo{
-    .size = size,
-    .usage = usage,
-    .sharingMode = vk::SharingMode::eExclusive
-  };
-  buffer = vk::raii::Buffer(device, bufferInfo);
-  vk::MemoryRequirements memRequirements = buffer.getMemoryRequirements();
-  vk::MemoryAllocateInfo allocInfo{
-    .allocationSize = memRequirements.size,
-    .memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties)
-  };
-  bufferMemory = vk::raii::DeviceMemory(device, allocInfo);
-  buffer.bindMemory(*bufferMemory, 0);
+  try
+  {
+    materialTextures = sceneCache.strings(SceneCacheSection::Materials);
+  }
+  catch (const std::exception&)
+  {
+    return rejectSceneCache();
+  }
+  for (uint32_t texture : sceneCache.get<uint32_t>(SceneCacheSection::MaterialTextures))
+  {
+    if (texture > materialTextures.size()) return rejectSceneCache();
+    materials.push_back({ .baseColorTexture = texture });
+  }
+  return true;
 }
 
-void App::transitionImageLayout(
-  const vk::raii::Image& image,
-  vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
-  uint32_t mipLevels
-)
+void App::writeSceneCache(std::filesystem::path path)
 {
-  const auto commandBuffer = beginSingleTimeCommands();
-
-  vk::ImageMemoryBarrier barrier {
-    .oldLayout = oldLayout,
-    .newLayout = newLayout,
-    .image = image,
-    .subresourceRange = {vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1}
-  };
+  std::vector<CachedPrim> cachedPrims;
+  cachedPrims.reserve(prims.size());
+  for (const auto& p : prims)
+  {
+    cachedPrims.push_back({
+      .firstIndex = p.firstIndex,
+      .indexCount = p.indexCount,
+      .materialIndex = static_cast<uint32_t>(p.materialIndex),
+      .vertexOffset = p.vertexOffset,
+      .cell = p.cell,
+      .boundsMin = { p.boundsMin.x, p.boundsMin.y, p.boundsMin.z },
+      .boundsExtent = { p.boundsExtent.x, p.boundsExtent.y, p.boundsExtent.z },
+      .placement = { p.placement.x, p.placement.y, p.placement.z },
+      .firstMeshlet = p.firstMeshlet,
+      .meshletCount = p.meshletCount,
+      .lodCount = p.lodCount,
+      .lods = p.lods
+    });
+  }
 
-  vk::PipelineStageFlags srcStage;
-  vk::PipelineStageFlags dstStage;
+  std::vector<CachedMesh> cachedMeshes;
+  cachedMeshes.reserve(meshes.size());
+  for (const auto& mesh : meshes)
+  {
+    cachedMeshes.push_back({ .firstPrim = mesh.firstPrim, .primCount = mesh.primCount });
+  }
 
-  if (oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eTransferDstOptimal)
+  std::vector<CachedNode> cachedNodes;
+  cachedNodes.reserve(sceneGraph.size());
+  for (uint32_t node = 0; node < sceneGraph.size(); node++)
   {
-    barrier.srcAccessMask = {};
-    barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-    
-    srcStage = vk::PipelineStageFlagBits::eTopOfPipe;
-    dstStage = vk::PipelineStageFlagBits::eTransfer;
+    const glm::vec3 translation = sceneGraph.translation(node);
+    const glm::quat rotation = sceneGraph.rotation(node);
+    const glm::vec3 scale = sceneGraph.scale(node);
+    cachedNodes.push_back({
+      .parent = sceneGraph.parent(node),
+      .mesh = ~0U,
+      .translation = { translation.x, translation.y, translation.z },
+      .rotation = { rotation.x, rotation.y, rotation.z, rotation.w },
+      .scale = { scale.x, scale.y, scale.z }
+    });
   }
-  else if (oldLayout == vk::ImageLayout::eTransferDstOptimal && newLayout == vk::ImageLayout::eShaderReadOnlyOptimal)
+  for (const auto& instance : meshInstances)
   {
-    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-    
-    srcStage = vk::PipelineStageFlagBits::eTransfer;
-    dstStage = vk::PipelineStageFlagBits::eFragmentShader;
+    cachedNodes[instance.node].mesh = instance.mesh;
   }
-  else
+
+  std::vector<CachedCell> cachedCells;
+  cachedCells.reserve(cells.size());
+  for (const auto& cell : cells)
   {
-    throw std::invalid_argument("unsupported layout transition!");
+    cachedCells.push_back({
+      .boundsMin = { cell.boundsMin.x, cell.boundsMin.y, cell.boundsMin.z },
+      .boundsMax = { cell.boundsMax.x, cell.boundsMax.y, cell.boundsMax.z },
+      .firstVertex = cell.firstVertex,
+      .vertexCount = cell.vertexCount,
+      .firstShortIndex = cell.firstShortIndex,
+      .shortIndexCount = cell.shortIndexCount,
+      .firstWideIndex = cell.firstWideIndex,
+      .wideIndexCount = cell.wideIndexCount
+    });
   }
 
-  commandBuffer->pipelineBarrier(srcStage, dstStage, {}, {}, nullptr, barrier);
-  endSingleTimeCommands(*commandBuffer);
+  SceneCacheWriter writer;
+  writer.addStrings(SceneCacheSection::Sources, assetSources);
+  writer.add(SceneCacheSection::Vertices, vertices.data(), vertices.size() * sizeof(Vertex));
+  writer.add(SceneCacheSection::Indices, indices.data(), indices.size() * sizeof(uint32_t));
+  writer.add(SceneCacheSection::Prims, cachedPrims.data(), cachedPrims.size() * sizeof(CachedPrim));
+  writer.addStrings(SceneCacheSection::Materials, materialTextures);
+  std::vector<uint32_t> cachedMaterialTextures;
+  cachedMaterialTextures.reserve(materials.size());
+  for (const auto& material : materials) cachedMaterialTextures.push_back(material.baseColorTexture);
+  writer.add(SceneCacheSection::MaterialTextures, cachedMaterialTextures.data(), cachedMaterialTextures.size() * sizeof(uint32_t));
+  writer.add(SceneCacheSection::Meshlets, meshlets.data(), meshlets.size() * sizeof(Meshlet));
+  writer.add(SceneCacheSection::Meshes, cachedMeshes.data(), cachedMeshes.size() * sizeof(CachedMesh));
+  writer.add(SceneCacheSection::Nodes, cachedNodes.data(), cachedNodes.size() * sizeof(CachedNode));
+  writer.add(SceneCacheSection::Cells, cachedCells.data(), cachedCells.size() * sizeof(CachedCell));
+
+  // a read-only asset directory only costs the next launch its warm start
+  try
+  {
+    writer.write(sceneCachePath(path), hashSources(path.parent_path(), assetSources), sizeof(Vertex));
+    std::clog << "wrote " << sceneCachePath(path) << std::endl;
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "failed to write scene cache: " << e.what() << std::endl;
+  }
 }
 
-std::unique_ptr<vk::raii::CommandBuffer> App::beginSingleTimeCommands()
+void App::loadAsset(std::filesystem::path path)
 {
-  vk::CommandBufferAllocateInfo allocInfo {
-    .commandPool = commandPool,
-    .level = vk::CommandBufferLevel::ePrimary,
-    .commandBufferCount = 1
-  };
-  std::unique_ptr<vk::raii::CommandBuffer> commandBuffer = std::make_unique<vk::raii::CommandBuffer>(std::move(device.allocateCommandBuffers(allocInfo).front()));
+  auto start = std::chrono::steady_clock::now();
 
-  vk::CommandBufferBeginInfo beginInfo {
-    .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit
-  };
-  commandBuffer->begin(beginInfo);
+  // quantized attributes are decoded to floats like any other, see loadGeometry
+  // gpu instances become nodes of their own, see loadNodes
+  // compressed buffer views are decoded once the buffers are attached, see decodeCompressedViews
+  fastgltf::Parser parser(
+    fastgltf::Extensions::KHR_mesh_quantization | fastgltf::Extensions::EXT_mesh_gpu_instancing | fastgltf::Extensions::EXT_meshopt_compression
+  );
+  // external buffers are attached below, either mapped or read onto the heap,
+  // so their uris can be recorded as scene cache sources first
+  constexpr auto options = fastgltf::Options::None;
+
+  std::unique_ptr<fastgltf::GltfDataGetter> data;
+  if (mapAssetFiles)
+  {
+    auto mapped = fastgltf::MappedGltfFile::FromPath(path);
+    if (mapped.error() != fastgltf::Error::None)
+      throw std::runtime_error(std::string("failed to map ").append(path.string()));
+    data = std::make_unique<fastgltf::MappedGltfFile>(std::move(mapped.get()));
+  }
+  else
+  {
+    auto buffer = fastgltf::GltfDataBuffer::FromPath(path);
+    if (buffer.error() != fastgltf::Error::None)
+      throw std::runtime_error(std::string("failed to load ").append(path.string()));
+    data = std::make_unique<fastgltf::GltfDataBuffer>(std::move(buffer.get()));
+  }
+  std::clog << "loaded " << path << std::endl;
+
+  auto parsed = parser.loadGltf(*data, path.parent_path(), options);
+  if (parsed.error() != fastgltf::Error::None)
+    throw std::runtime_error(std::string("failed to parse ").append(path.string()));
+  else
+    std::clog << "parsed " << path << std::endl;
+
+  if (fastgltf::validate(parsed.get()) != fastgltf::Error::None)
+    throw std::runtime_error(std::string("failed to validate ").append(path.string()));
+  else
+    std::clog << "validated " << path << std::endl;
+
+  asset = std::move(parsed.get());
+
+  // the json itself is only copied when read through a GltfDataBuffer
+  stats.assetBytesCopied = mapAssetFiles ? 0U : data->totalSize();
+
+  assetSources = { path.filename().generic_string() };
+  mappedBuffers.clear();
+  mappedBuffers.reserve(asset.buffers.size());
+  for (auto& buffer : asset.buffers)
+  {
+    if (const auto* uri = std::get_if<fastgltf::sources::URI>(&buffer.data))
+    {
+      const auto relativePath = uri->uri.fspath();
+      const auto fileByteOffset = uri->fileByteOffset;
+      const auto mimeType = uri->mimeType;
+      assetSources.emplace_back(relativePath.generic_string());
+
+      if (mapAssetFiles)
+      {
+        // point the buffer at the mapping so the default accessor adapter reads from the page cache
+        const auto& file = mappedBuffers.emplace_back(path.parent_path() / relativePath);
+        if (fileByteOffset + buffer.byteLength > file.size())
+          throw std::runtime_error(std::string("buffer overruns ").append(relativePath.string()));
+
+        buffer.data = fastgltf::sources::ByteView {
+          .bytes = fastgltf::span<const std::byte>(file.data() + fileByteOffset, buffer.byteLength),
+          .mimeType = mimeType
+        };
+      }
+      else
+      {
+        // equivalent to Options::LoadExternalBuffers
+        std::ifstream file(path.parent_path() / relativePath, std::ios::binary);
+        if (!file.is_open())
+          throw std::runtime_error(std::string("failed to open ").append(relativePath.string()));
+
+        fastgltf::sources::Vector vector { .bytes = std::vector<std::byte>(buffer.byteLength), .mimeType = mimeType };
+        file.seekg(static_cast<std::streamoff>(fileByteOffset));
+        file.read(reinterpret_cast<char*>(vector.bytes.data()), static_cast<std::streamsize>(vector.bytes.size()));
+        if (!file.good())
+          throw std::runtime_error(std::string("failed to read ").append(relativePath.string()));
+
+        buffer.data = std::move(vector);
+      }
+    }
 
-  return commandBuffer;
+    // external buffers in copying mode, and data uris in either mode
+    if (const auto* vector = std::get_if<fastgltf::sources::Vector>(&buffer.data))
+    {
+      stats.assetBytesCopied += vector->bytes.size();
+    }
+    else if (const auto* array = std::get_if<fastgltf::sources::Array>(&buffer.data))
+    {
+      stats.assetBytesCopied += array->bytes.size_bytes();
+    }
+  }
+
+  decodeCompressedViews();
+
+  auto end = std::chrono::steady_clock::now();
+  stats.assetLoadTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+  std::clog << (mapAssetFiles ? "mapped " : "copied ") << path << " in " << stats.assetLoadTime << "us, "
+            << stats.assetBytesCopied << " bytes copied" << std::endl;
 }
 
-void App::endSingleTimeCommands(const vk::raii::CommandBuffer& commandBuffer) const
+// the bytes loadAsset attached to a buffer, none for a fallback that only stands in for compressed views
+static std::span<const std::byte> bufferBytes(const fastgltf::Buffer& buffer)
 {
-  commandBuffer.end();
-
-  vk::SubmitInfo submitInfo {
-    .commandBufferCount = 1,
-    .pCommandBuffers = &*commandBuffer
-  };
-  queue.submit(submitInfo, nullptr);
-  queue.waitIdle();
+  return std::visit(fastgltf::visitor {
+    [](const auto&) { return std::span<const std::byte>(); },
+    [](const fastgltf::sources::Array& array) { return std::span<const std::byte>(array.bytes.data(), array.bytes.size_bytes()); },
+    [](const fastgltf::sources::Vector& vector) { return std::span<const std::byte>(vector.bytes); },
+    [](const fastgltf::sources::ByteView& view) { return std::span<const std::byte>(view.bytes.data(), view.bytes.size()); }
+  }, buffer.data);
 }
 
-void App::copyBufferToImage(
-  const vk::raii::Buffer& buffer,
-  const vk::raii::Image& image,
-  uint32_t width, uint32_t height, uint32_t mipLevels,
-  ktxTexture2* kTexture
-)
+void App::decodeCompressedViews()
 {
-  std::unique_ptr<vk::raii::CommandBuffer> commandBuffer = beginSingleTimeCommands();
-  
-  std::vector<vk::BufferImageCopy> regions;
+  auto start = std::chrono::steady_clock::now();
+
+  // every EXT_meshopt_compression view decodes into its own slice of one new buffer,
+  // laid out first so the views decode in parallel
+  std::vector<size_t> compressed;
+  std::vector<size_t> offsets;
+  size_t decodedSize = 0U;
+  size_t compressedSize = 0U;
+  for (size_t i = 0; i < asset.bufferViews.size(); i++)
+  {
+    const auto& compression = asset.bufferViews[i].meshoptCompression;
+    if (!compression) continue;
+    compressed.push_back(i);
+    offsets.push_back(decodedSize);
+    // every slice starts 16-byte aligned, so decoded floats and indices are read in place
+    decodedSize += (compression->count * compression->byteStride + 15) & ~size_t(15);
+    compressedSize += compression->byteLength;
+  }
+  stats.compressedViews = static_cast<uint32_t>(compressed.size());
+  if (compressed.empty()) return;
 
-  for (uint32_t level = 0; level < mipLevels; level++)
+  fastgltf::sources::Vector decoded { .bytes = std::vector<std::byte>(decodedSize), .mimeType = fastgltf::MimeType::None };
+  threadPool.parallelFor(compressed.size(), 1, [&](size_t begin, size_t end)
   {
-    ktx_size_t offset;
-    ktxTexture2_GetImageOffset(kTexture, level, 0, 0, &offset);
+    for (size_t c = begin; c < end; c++)
+    {
+      const auto& compression = *asset.bufferViews[compressed[c]].meshoptCompression;
+      const auto source = bufferBytes(asset.buffers[compression.bufferIndex]);
+      std::byte* out = decoded.bytes.data() + offsets[c];
 
-    uint32_t mipWidth = std::max(1u, width >> level);
-    uint32_t mipHeight = std::max(1u, height >> level);
+      bool valid = compression.byteOffset + compression.byteLength <= source.size();
+      const auto in = valid ? source.subspan(compression.byteOffset, compression.byteLength) : std::span<const std::byte>();
+      switch (compression.mode)
+      {
+        case fastgltf::MeshoptCompressionMode::Attributes:
+          valid = valid && decodeMeshoptVertices(out, compression.count, compression.byteStride, in);
+          break;
+        case fastgltf::MeshoptCompressionMode::Triangles:
+          valid = valid && decodeMeshoptTriangles(out, compression.count, compression.byteStride, in);
+          break;
+        case fastgltf::MeshoptCompressionMode::Indices:
+          valid = valid && decodeMeshoptIndices(out, compression.count, compression.byteStride, in);
+          break;
+      }
+      if (!valid)
+        throw std::runtime_error(std::string("failed to decode compressed buffer view ").append(std::to_string(compressed[c])));
 
-    vk::BufferImageCopy region {
-      .bufferOffset = offset,
+      switch (compression.filter)
+      {
+        case fastgltf::MeshoptCompressionFilter::None:
+          break;
+        case fastgltf::MeshoptCompressionFilter::Octahedral:
+          unfilterMeshoptOctahedral(out, compression.count, compression.byteStride);
+          break;
+        case fastgltf::MeshoptCompressionFilter::Quaternion:
+          unfilterMeshoptQuaternion(out, compression.count);
+          break;
+        case fastgltf::MeshoptCompressionFilter::Exponential:
+          unfilterMeshoptExponential(out, compression.count * compression.byteStride / 4);
+          break;
+      }
+    }
+  });
+
+  // the views now read the decoded bytes like any other, through the default accessor adapter
+  const size_t decodedBuffer = asset.buffers.size();
+  asset.buffers.push_back({ .byteLength = decodedSize, .data = std::move(decoded) });
+  for (size_t c = 0; c < compressed.size(); c++)
+  {
+    auto& view = asset.bufferViews[compressed[c]];
+    view.bufferIndex = decodedBuffer;
+    view.byteOffset = offsets[c];
+    view.byteLength = view.meshoptCompression->count * view.meshoptCompression->byteStride;
+    view.meshoptCompression.reset();
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  stats.compressedViewDecodeTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+  std::clog << "decoded " << compressed.size() << " compressed buffer views, " << compressedSize << " -> " << decodedSize
+            << " bytes in " << stats.compressedViewDecodeTime << "us on " << threadPool.size() + 1 << " threads" << std::endl;
+}
+
+void App::collectMaterialTextures()
+{
+  // materials sharing an image share its texture slot, ~0U stands in for the fallback until the slot count is known
+  materialTextures.clear();
+  materials.clear();
+  std::unordered_map<size_t, uint32_t> imageSlots;
+  for (auto& material : asset.materials)
+  {
+    uint32_t slot = ~0U;
+    if (material.pbrData.baseColorTexture.has_value())
+    {
+      const fastgltf::Texture& texture = asset.textures[material.pbrData.baseColorTexture->textureIndex];
+      if (texture.imageIndex.has_value())
+      {
+        const size_t imageIndex = texture.imageIndex.value();
+        if (auto found = imageSlots.find(imageIndex); found != imageSlots.end())
+        {
+          slot = found->second;
+        }
+        else if (const auto* filePath = std::get_if<fastgltf::sources::URI>(&asset.images[imageIndex].data))
+        {
+          slot = static_cast<uint32_t>(materialTextures.size());
+          imageSlots.emplace(imageIndex, slot);
+          materialTextures.emplace_back(filePath->uri.path().begin(), filePath->uri.path().end());
+        }
+        else
+        {
+          std::clog << "warning: image " << imageIndex << " is not a file, material " << materials.size()
+                    << " is drawn with the white fallback" << std::endl;
+        }
+      }
+    }
+    materials.push_back({ .baseColorTexture = slot });
+  }
+
+  for (auto& material : materials)
+  {
+    if (material.baseColorTexture == ~0U) material.baseColorTexture = static_cast<uint32_t>(materialTextures.size());
+  }
+}
+
+void App::loadTextures(std::filesystem::path path)
+{
+  // one slot per image and the white fallback last
+  const size_t textureCount = materialTextures.size() + 1;
+  textureImages.clear();
+  textureImagesMemory.clear();
+  textureImageViews.clear();
+  // textures finish out of order, so every slot exists up front and is filled by index
+  for (size_t i = 0; i < textureCount; i++)
+  {
+    textureImages.emplace_back(nullptr);
+    textureImagesMemory.emplace_back(nullptr);
+    textureImageViews.emplace_back(nullptr);
+  }
+  textureUploadValues.assign(textureCount, UPLOAD_PENDING);
+  texturesPending = textureCount;
+
+  // workers do the file i/o and ktx decoding, nothing that touches the device
+  // uploads happen in pumpUploads, so this returns straight away and frames start while textures stream in
+  for (size_t i = 0; i < materialTextures.size(); i++)
+  {
+    std::string texturePath = path.parent_path().append(materialTextures[i].begin(), materialTextures[i].end()).string();
+    threadPool.submit([this, i, texturePath = std::move(texturePath)]()
+    {
+      DecodedTexture texture { .index = i, .kTexture = nullptr, .error = nullptr };
+      try
+      {
+        texture.kTexture = decodeTexture(texturePath.c_str());
+      }
+      catch (...)
+      {
+        texture.error = std::current_exception();
+      }
+
+      std::lock_guard lock(decodedMutex);
+      decodedTextures.push_back(texture);
+    });
+  }
+
+  DecodedTexture fallback { .index = materialTextures.size(), .kTexture = createFallbackTexture(), .error = nullptr };
+  std::lock_guard lock(decodedMutex);
+  decodedTextures.push_back(fallback);
+}
+
+[[nodiscard]] ktxTexture2* App::decodeTexture(const char* texturePath)
+{
+  ktxTexture2* kTexture;
+  auto result = ktxTexture2_CreateFromNamedFile(texturePath, KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &kTexture);
+
+  if (result != KTX_SUCCESS)
+  {
+    throw std::runtime_error(std::string("failed to load ktx texture image ").append(texturePath));
+  }
+
+  // basis supercompressed textures are transcoded here too, it is the most expensive part of a decode
+  if (ktxTexture2_NeedsTranscoding(kTexture))
+  {
+    result = ktxTexture2_TranscodeBasis(kTexture, KTX_TTF_RGBA32, 0);
+    if (result != KTX_SUCCESS)
+    {
+      ktxTexture2_Destroy(kTexture);
+      throw std::runtime_error(std::string("failed to transcode ktx texture image ").append(texturePath));
+    }
+  }
+
+  return kTexture;
+}
+
+[[nodiscard]] ktxTexture2* App::createFallbackTexture()
+{
+  // a single white texel, so materials without a base colour texture draw untextured
+  ktxTextureCreateInfo createInfo {
+    .glInternalformat = 0,
+    .vkFormat = static_cast<ktx_uint32_t>(vk::Format::eR8G8B8A8Srgb),
+    .pDfd = nullptr,
+    .baseWidth = 1,
+    .baseHeight = 1,
+    .baseDepth = 1,
+    .numDimensions = 2,
+    .numLevels = 1,
+    .numLayers = 1,
+    .numFaces = 1,
+    .isArray = KTX_FALSE,
+    .generateMipmaps = KTX_FALSE
+  };
+
+  ktxTexture2* kTexture;
+  if (ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &kTexture) != KTX_SUCCESS)
+  {
+    throw std::runtime_error("failed to create fallback texture");
+  }
+
+  const std::array<ktx_uint8_t, 4> white = { 255, 255, 255, 255 };
+  if (ktxTexture_SetImageFromMemory(ktxTexture(kTexture), 0, 0, 0, white.data(), white.size()) != KTX_SUCCESS)
+  {
+    ktxTexture2_Destroy(kTexture);
+    throw std::runtime_error("failed to fill fallback texture");
+  }
+
+  return kTexture;
+}
+
+void App::createTextureImage(ktxTexture2* kTexture, size_t textureIndex)
+{
+  auto texWidth = kTexture->baseWidth;
+  auto texHeight = kTexture->baseHeight;
+  auto mipLevels = kTexture->numLevels;
+  auto ktxTextureData = ktxTexture_GetData(ktxTexture(kTexture));
+
+  vk::Format textureFormat = static_cast<vk::Format>(ktxTexture2_GetVkFormat(kTexture));
+
+  vk::raii::Image textureImage = nullptr;
+  DeviceAllocation textureImageMemory = nullptr;
+  
+  createImage(texWidth, texHeight, mipLevels, textureFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal, textureImage, textureImageMemory);
+
+  std::vector<vk::BufferImageCopy> regions;
+  for (uint32_t level = 0; level < mipLevels; level++)
+  {
+    ktx_size_t offset;
+    ktxTexture2_GetImageOffset(kTexture, level, 0, 0, &offset);
+
+    uint32_t mipWidth = std::max(1u, texWidth >> level);
+    uint32_t mipHeight = std::max(1u, texHeight >> level);
+
+    vk::BufferImageCopy region {
+      .bufferOffset = offset,
       .bufferRowLength = 0,
       .bufferImageHeight = 0,
       .imageSubresource = {
@@ -929,173 +1626,1562 @@ void App::copyBufferToImage(
       }
     };
 
-    regions.push_back(region);
-  }
-  commandBuffer->copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, regions);
+    regions.push_back(region);
+  }
+
+  // the batch copies the texels into the staging ring straight away, so the ktx texture can go now
+  textureUploadValues[textureIndex] = uploadBatch->uploadImage(ktxTextureData, *textureImage, textureFormat, mipLevels, regions);
+  sceneUploadValue = std::max(sceneUploadValue, textureUploadValues[textureIndex]);
+  
+  ktxTexture2_Destroy(kTexture);
+  
+  createTextureImageView(textureImage, textureFormat, mipLevels, textureIndex);
+  textureImages[textureIndex] = std::move(textureImage);
+  textureImagesMemory[textureIndex] = std::move(textureImageMemory);
+}
+
+void App::createBuffer(
+  vk::DeviceSize size,
+  vk::BufferUsageFlags usage,
+  vk::MemoryPropertyFlags properties,
+  vk::raii::Buffer& buffer,
+  DeviceAllocation& bufferMemory
+)
+{
+  vk::BufferCreateInfo bufferInfo{
+    .size = size,
+    .usage = usage,
+    .sharingMode = vk::SharingMode::eExclusive
+  };
+  buffer = vk::raii::Buffer(device, bufferInfo);
+  vk::MemoryRequirements memRequirements = buffer.getMemoryRequirements();
+  bufferMemory = allocator->allocate(memRequirements, properties, true);
+  buffer.bindMemory(bufferMemory.getMemory(), bufferMemory.getOffset());
+}
+
+void App::createTextureImageView(const vk::raii::Image& image, vk::Format format, uint32_t mipLevels, size_t textureIndex)
+{
+  textureImageViews[textureIndex] = createImageView(image, format, vk::ImageAspectFlagBits::eColor, mipLevels);
+}
+
+void App::createTextureSampler()
+{
+  vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+  vk::SamplerCreateInfo samplerInfo {
+    .magFilter = vk::Filter::eLinear,
+    .minFilter = vk::Filter::eLinear,
+    .mipmapMode = vk::SamplerMipmapMode::eLinear,
+    .addressModeU = vk::SamplerAddressMode::eRepeat,
+    .addressModeV = vk::SamplerAddressMode::eRepeat,
+    .addressModeW = vk::SamplerAddressMode::eRepeat,
+    .mipLodBias = 0.0f,
+    .anisotropyEnable = vk::True,
+    .maxAnisotropy = properties.limits.maxSamplerAnisotropy,
+    .compareEnable = vk::False,
+    .compareOp = vk::CompareOp::eAlways,
+    .minLod = 0.0f,
+    .maxLod = vk::LodClampNone
+  };
+
+  textureSampler = vk::raii::Sampler(device, samplerInfo);
+}
+
+void App::createMaterialBuffer()
+{
+  // materials were filled with their texture slots by collectMaterialTextures or loadSceneCache
+  for (const auto& p : prims)
+  {
+    if (p.materialIndex >= materials.size())
+    {
+      throw std::runtime_error(std::string("failed to find material ").append(std::to_string(p.materialIndex)));
+    }
+  }
+
+  // a scene without materials still binds a valid buffer
+  const vk::DeviceSize bufferSize = std::max<size_t>(materials.size(), 1) * sizeof(MaterialData);
+  createBuffer(
+    bufferSize,
+    vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+    vk::MemoryPropertyFlagBits::eDeviceLocal,
+    materialBuffer,
+    materialBufferMemory
+  );
+  materialUploadValue = materials.empty() ? 0U : uploadBatch->uploadBuffer(
+    materials.data(), materials.size() * sizeof(MaterialData), *materialBuffer, 0,
+    vk::PipelineStageFlagBits2::eFragmentShader,
+    vk::AccessFlagBits2::eShaderStorageRead
+  );
+}
+
+void App::createDrawBuffers()
+{
+  // every batch drawn whole at its finest level, ranges local to its cell's buffer as recordDraws binds it,
+  // the culling pass swaps in a coarser level from the draw data
+  std::vector<vk::DrawIndexedIndirectCommand> commands;
+  std::vector<DrawData> drawData;
+  std::vector<uint32_t> counts;
+  commands.reserve(drawBatches.size());
+  drawData.reserve(drawBatches.size());
+  drawGroups.clear();
+  for (const DrawBatch& batch : drawBatches)
+  {
+    const PrimData& p = prims[batch.prim];
+    const GeometryCell& cell = cells[p.cell];
+    const bool wideIndices = p.firstIndex >= shortIndexCount;
+    if (drawGroups.empty() || drawGroups.back().cell != p.cell || drawGroups.back().wideIndices != wideIndices)
+    {
+      drawGroups.push_back({
+        .cell = p.cell,
+        .wideIndices = wideIndices,
+        .firstDraw = static_cast<uint32_t>(commands.size()),
+        .drawCount = 0U,
+        .triangleCount = 0U,
+        .texturesReady = false
+      });
+    }
+    drawGroups.back().drawCount++;
+    drawGroups.back().triangleCount += p.indexCount / 3 * batch.instanceCount;
+
+    commands.push_back({
+      .indexCount = p.indexCount,
+      .instanceCount = batch.instanceCount,
+      .firstIndex = p.firstIndex - (wideIndices ? cell.firstWideIndex : cell.firstShortIndex),
+      .vertexOffset = p.vertexOffset - static_cast<int32_t>(cell.firstVertex),
+      .firstInstance = batch.firstInstance
+    });
+    DrawData& data = drawData.emplace_back(DrawData {
+      .boundsMin = p.boundsMin,
+      .material = static_cast<uint32_t>(p.materialIndex),
+      .boundsExtent = p.boundsExtent,
+      .group = static_cast<uint32_t>(drawGroups.size() - 1),
+      .lods = {},
+      .lodCount = p.lodCount,
+      .pad = {}
+    });
+    // a primitive's levels sit in the same cell and index width as its full range
+    for (uint32_t level = 0; level < p.lodCount; level++)
+    {
+      data.lods[level] = {
+        .firstIndex = p.lods[level].firstIndex - (wideIndices ? cell.firstWideIndex : cell.firstShortIndex),
+        .indexCount = p.lods[level].indexCount,
+        .error = p.lods[level].error,
+        .pad = 0U
+      };
+    }
+  }
+  for (const DrawGroup& group : drawGroups)
+  {
+    counts.push_back(group.drawCount);
+  }
+
+  // a scene without batches still binds valid buffers
+  auto createUploaded = [&](const void* data, size_t size, vk::BufferUsageFlags usage, vk::PipelineStageFlags2 dstStage,
+                            vk::AccessFlags2 dstAccess, vk::raii::Buffer& buffer, DeviceAllocation& bufferMemory)
+  {
+    createBuffer(std::max<size_t>(size, sizeof(uint32_t)), usage | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, buffer, bufferMemory);
+    if (size > 0U)
+    {
+      drawBuffersUploadValue = uploadBatch->uploadBuffer(data, size, *buffer, 0, dstStage, dstAccess);
+    }
+  };
+  drawBuffersUploadValue = 0U;
+  // the culling pass reads the commands too
+  createUploaded(
+    commands.data(), commands.size() * sizeof(vk::DrawIndexedIndirectCommand), vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+    vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eComputeShader,
+    vk::AccessFlagBits2::eIndirectCommandRead | vk::AccessFlagBits2::eShaderStorageRead, drawCommandBuffer, drawCommandBufferMemory
+  );
+  createUploaded(
+    counts.data(), counts.size() * sizeof(uint32_t), vk::BufferUsageFlagBits::eIndirectBuffer,
+    vk::PipelineStageFlagBits2::eDrawIndirect, vk::AccessFlagBits2::eIndirectCommandRead, drawCountBuffer, drawCountBufferMemory
+  );
+  createUploaded(
+    drawData.data(), drawData.size() * sizeof(DrawData), vk::BufferUsageFlagBits::eStorageBuffer,
+    vk::PipelineStageFlagBits2::eVertexShader | vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eShaderStorageRead,
+    drawDataBuffer, drawDataBufferMemory
+  );
+
+  // only ever written by the culling pass, one half per phase
+  auto createCulled = [&](size_t size, vk::BufferUsageFlags usage, vk::raii::Buffer& buffer, DeviceAllocation& bufferMemory)
+  {
+    createBuffer(std::max<size_t>(size, sizeof(uint32_t)), usage | vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, buffer, bufferMemory);
+  };
+  createCulled(2U * commands.size() * sizeof(vk::DrawIndexedIndirectCommand), vk::BufferUsageFlagBits::eIndirectBuffer, culledCommandBuffer, culledCommandBufferMemory);
+  createCulled(2U * commands.size() * sizeof(uint32_t), {}, culledDrawIdBuffer, culledDrawIdBufferMemory);
+  // cleared at the start of every culled frame
+  createCulled(2U * drawGroups.size() * sizeof(uint32_t), vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst, culledCountBuffer, culledCountBufferMemory);
+  createCulled(commands.size() * sizeof(uint32_t), {}, occludedBuffer, occludedBufferMemory);
+
+  std::clog << "built " << commands.size() << " indirect draw commands in " << drawGroups.size() << " groups" << std::endl;
+}
+
+// float accessors the vertex codec can read in place, anything else goes through fastgltf's conversions first
+static std::optional<Float3Stream> float3Stream(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor)
+{
+  if (accessor.componentType != fastgltf::ComponentType::Float || accessor.normalized || accessor.sparse.has_value() ||
+      !accessor.bufferViewIndex.has_value() ||
+      (accessor.type != fastgltf::AccessorType::Vec3 && accessor.type != fastgltf::AccessorType::Vec4))
+  {
+    return std::nullopt;
+  }
+  const auto bytes = fastgltf::DefaultBufferDataAdapter{}(asset, accessor.bufferViewIndex.value()).subspan(accessor.byteOffset);
+  const size_t elementSize = fastgltf::getElementByteSize(accessor.type, accessor.componentType);
+  return Float3Stream {
+    .data = bytes.data(),
+    .count = accessor.count,
+    .stride = asset.bufferViews[accessor.bufferViewIndex.value()].byteStride.value_or(elementSize)
+  };
+}
+
+// fastgltf's copyFromAccessor drops the normalized flag when it converts, iterating applies it
+template <typename T, size_t Stride = sizeof(T)>
+static void copyConverted(const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, void* out)
+{
+  fastgltf::iterateAccessorWithIndex<T>(asset, accessor, [&](T value, size_t i)
+  {
+    std::memcpy(static_cast<std::byte*>(out) + i * Stride, &value, sizeof(T));
+  });
+}
+
+// whether b's vertices are a's moved somewhere else, positions may be a step apart from being quantized to different bounds
+static bool sameVertexRange(std::span<const Vertex> vertices, const PrimData& a, const PrimData& b, size_t count)
+{
+  const glm::vec3 step = glm::max(a.boundsExtent, b.boundsExtent) / static_cast<float>(UINT16_MAX);
+  if (glm::any(glm::greaterThan(glm::abs(a.boundsExtent - b.boundsExtent), step))) return false;
+
+  const auto rangeA = vertices.subspan(static_cast<size_t>(a.vertexOffset), count);
+  const auto rangeB = vertices.subspan(static_cast<size_t>(b.vertexOffset), count);
+  return std::ranges::equal(rangeA, rangeB, [](const Vertex& va, const Vertex& vb)
+  {
+    const glm::ivec3 d = glm::abs(glm::ivec3(glm::u16vec3(va.pos)) - glm::ivec3(glm::u16vec3(vb.pos)));
+    return d.x <= 1 && d.y <= 1 && d.z <= 1 && va.pos.w == vb.pos.w &&
+           va.normal == vb.normal && va.tangent == vb.tangent && va.texCoord == vb.texCoord;
+  });
+}
+
+void App::loadGeometry()
+{
+  auto start = std::chrono::steady_clock::now();
+
+  // primitives share accessors (Sponza's indices accessor 37 backs eight of them), so each accessor is decoded once
+  // index ranges are local to their primitive and can be shared whatever the vertices,
+  // vertex ranges are shared when every attribute accessor matches, and otherwise copy attributes already decoded
+  // every range is laid out first as a running sum of accessor counts, so the decoding fills disjoint slices in parallel
+  constexpr size_t NO_ACCESSOR = ~size_t(0);
+  enum Attribute : size_t { Position, Normal, Tangent, TexCoord };
+
+  struct IndexJob {
+    size_t accessor;
+    uint32_t firstIndex;
+  };
+  struct VertexJob {
+    size_t prim; // owner of the range
+    size_t vertexCount;
+    std::array<size_t, 4> accessors;
+    // prim whose range the accessor was first decoded into, NO_ACCESSOR when this range decodes it
+    std::array<size_t, 4> copyFrom;
+  };
+
+  std::unordered_map<size_t, std::pair<uint32_t, uint32_t>> indexRanges; // accessor -> firstIndex, indexCount
+  std::map<std::array<size_t, 4>, size_t> vertexRanges; // position, normal, tangent, texcoord accessor -> prim that owns them
+  std::array<std::unordered_map<size_t, size_t>, 4> decoded; // per attribute, accessor -> prim it is decoded for
+  std::vector<IndexJob> indexJobs;
+  std::vector<VertexJob> vertexJobs;
+  std::vector<std::pair<size_t, size_t>> sharedRanges; // prim, prim that owns the vertex range it draws
+  size_t indexTotal = indices.size();
+  size_t vertexTotal = vertices.size();
+  uint32_t sharedIndexRanges = 0U;
+
+  for (auto& mesh : asset.meshes)
+  {
+    meshes.push_back({ .firstPrim = static_cast<uint32_t>(prims.size()), .primCount = static_cast<uint32_t>(mesh.primitives.size()) });
+    for (auto& p : mesh.primitives)
+    {
+      const size_t primIndex = prims.size();
+      PrimData& prim = prims.emplace_back(PrimData{});
+      prim.materialIndex = p.materialIndex.value();
+      prim.parent = &mesh;
+
+      // indices stay local to the primitive, drawIndexed adds vertexOffset
+      if (p.indicesAccessor.has_value())
+      {
+        const uint32_t count = static_cast<uint32_t>(asset.accessors[p.indicesAccessor.value()].count);
+        auto [range, inserted] = indexRanges.try_emplace(p.indicesAccessor.value(), static_cast<uint32_t>(indexTotal), count);
+        if (inserted)
+        {
+          indexJobs.push_back({ p.indicesAccessor.value(), range->second.first });
+          indexTotal += count;
+        }
+        else
+        {
+          sharedIndexRanges++;
+        }
+        prim.firstIndex = range->second.first;
+        prim.indexCount = range->second.second;
+      }
+
+      auto accessorOf = [&](std::string_view attribute)
+      {
+        auto found = p.findAttribute(attribute);
+        return found != p.attributes.end() ? found->accessorIndex : NO_ACCESSOR;
+      };
+      const std::array<size_t, 4> accessors = { accessorOf("POSITION"), accessorOf("NORMAL"), accessorOf("TANGENT"), accessorOf("TEXCOORD_0") };
+
+      auto [owner, inserted] = vertexRanges.try_emplace(accessors, primIndex);
+      if (!inserted)
+      {
+        prim.vertexOffset = prims[owner->second].vertexOffset;
+        sharedRanges.emplace_back(primIndex, owner->second);
+        continue;
+      }
+
+      // attributes left out by the primitive keep Vertex's defaults
+      VertexJob job { .prim = primIndex, .vertexCount = 0U, .accessors = accessors, .copyFrom = {} };
+      for (size_t attribute = 0; attribute < accessors.size(); attribute++)
+      {
+        job.copyFrom[attribute] = NO_ACCESSOR;
+        if (accessors[attribute] == NO_ACCESSOR) continue;
+        job.vertexCount = std::max(job.vertexCount, asset.accessors[accessors[attribute]].count);
+        auto [first, firstTime] = decoded[attribute].try_emplace(accessors[attribute], primIndex);
+        if (!firstTime) job.copyFrom[attribute] = first->second;
+      }
+      prim.vertexOffset = static_cast<int32_t>(vertexTotal);
+      vertexTotal += job.vertexCount;
+      vertexJobs.push_back(job);
+    }
+  }
+  indices.resize(indexTotal);
+  vertices.resize(vertexTotal);
+
+  // floats are read where they lie when the accessor is float already, otherwise converted into scratch first
+  auto float3s = [&](const fastgltf::Accessor& accessor, std::vector<glm::vec4>& scratch)
+  {
+    if (auto stream = float3Stream(asset, accessor)) return *stream;
+    scratch.resize(accessor.count);
+    if (accessor.type == fastgltf::AccessorType::Vec4)
+      copyConverted<glm::vec4>(asset, accessor, scratch.data());
+    else
+      copyConverted<glm::vec3, sizeof(glm::vec4)>(asset, accessor, scratch.data());
+    return Float3Stream { .data = reinterpret_cast<const std::byte*>(scratch.data()), .count = accessor.count, .stride = sizeof(glm::vec4) };
+  };
+
+  auto decodeRange = [&](const VertexJob& job, std::vector<glm::vec4>& scratch)
+  {
+    PrimData& prim = prims[job.prim];
+    Vertex* range = vertices.data() + prim.vertexOffset;
+    std::byte* bytes = reinterpret_cast<std::byte*>(range);
+
+    // KHR_mesh_quantization inputs (normalized or not) come out as floats,
+    // and are quantized again to the primitive's own bounds
+    if (job.accessors[Position] != NO_ACCESSOR && job.copyFrom[Position] == NO_ACCESSOR)
+    {
+      const Float3Stream positions = float3s(asset.accessors[job.accessors[Position]], scratch);
+      glm::vec3 boundsMin(std::numeric_limits<float>::max());
+      glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+      float3Bounds(positions, boundsMin, boundsMax);
+      if (positions.count == 0) boundsMin = boundsMax = glm::vec3(0.0f);
+
+      const glm::vec3 extent = boundsMax - boundsMin;
+      const glm::vec3 scale = glm::vec3(
+        extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+        extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+        extent.z > 0.0f ? 1.0f / extent.z : 0.0f
+      );
+      quantizeUnorm16(positions, boundsMin, scale, bytes + offsetof(Vertex, pos), sizeof(Vertex));
+      prim.boundsMin = boundsMin;
+      prim.boundsExtent = extent;
+    }
+
+    if (job.accessors[Normal] != NO_ACCESSOR && job.copyFrom[Normal] == NO_ACCESSOR)
+    {
+      octEncodeSnorm16(float3s(asset.accessors[job.accessors[Normal]], scratch), bytes + offsetof(Vertex, normal), sizeof(Vertex));
+    }
+
+    // the bitangent sign rides in the position's spare w
+    if (job.accessors[Tangent] != NO_ACCESSOR && job.copyFrom[Tangent] == NO_ACCESSOR)
+    {
+      const Float3Stream tangents = float3s(asset.accessors[job.accessors[Tangent]], scratch);
+      octEncodeSnorm16(tangents, bytes + offsetof(Vertex, tangent), sizeof(Vertex));
+      for (size_t idx = 0; idx < tangents.count; idx++)
+      {
+        float sign;
+        std::memcpy(&sign, tangents.data + idx * tangents.stride + 3 * sizeof(float), sizeof(sign));
+        range[idx].pos.w = sign < 0.0f ? 0U : UINT16_MAX;
+      }
+    }
+
+    if (job.accessors[TexCoord] != NO_ACCESSOR && job.copyFrom[TexCoord] == NO_ACCESSOR)
+    {
+      fastgltf::iterateAccessorWithIndex<glm::vec2>(
+        asset, asset.accessors[job.accessors[TexCoord]], [&](glm::vec2 uv, size_t idx)
+        {
+          range[idx].texCoord = glm::u16vec2(glm::packHalf1x16(uv.x), glm::packHalf1x16(uv.y));
+        }
+      );
+    }
+  };
+
+  // attributes another range decoded are copied once every range is decoded, each field on its own
+  // so a copied position keeps this range's bitangent sign and the other way around
+  auto copyShared = [&](const VertexJob& job)
+  {
+    PrimData& prim = prims[job.prim];
+    for (size_t attribute = 0; attribute < job.accessors.size(); attribute++)
+    {
+      if (job.copyFrom[attribute] == NO_ACCESSOR) continue;
+      const PrimData& source = prims[job.copyFrom[attribute]];
+      const size_t count = asset.accessors[job.accessors[attribute]].count;
+      Vertex* dst = vertices.data() + prim.vertexOffset;
+      const Vertex* src = vertices.data() + source.vertexOffset;
+      for (size_t idx = 0; idx < count; idx++)
+      {
+        switch (attribute)
+        {
+          case Position: dst[idx].pos = glm::u16vec4(glm::u16vec3(src[idx].pos), dst[idx].pos.w); break;
+          case Normal: dst[idx].normal = src[idx].normal; break;
+          case Tangent: dst[idx].tangent = src[idx].tangent; dst[idx].pos.w = src[idx].pos.w; break;
+          case TexCoord: dst[idx].texCoord = src[idx].texCoord; break;
+        }
+      }
+      if (attribute == Position)
+      {
+        prim.boundsMin = source.boundsMin;
+        prim.boundsExtent = source.boundsExtent;
+      }
+    }
+  };
+
+  threadPool.parallelFor(indexJobs.size() + vertexJobs.size(), 1, [&](size_t begin, size_t end)
+  {
+    std::vector<glm::vec4> scratch;
+    for (size_t j = begin; j < end; j++)
+    {
+      if (j < indexJobs.size())
+        fastgltf::copyFromAccessor<uint32_t>(asset, asset.accessors[indexJobs[j].accessor], indices.data() + indexJobs[j].firstIndex);
+      else
+        decodeRange(vertexJobs[j - indexJobs.size()], scratch);
+    }
+  });
+  threadPool.parallelFor(vertexJobs.size(), 1, [&](size_t begin, size_t end)
+  {
+    for (size_t j = begin; j < end; j++)
+    {
+      copyShared(vertexJobs[j]);
+    }
+  });
+  for (auto [primIndex, owner] : sharedRanges)
+  {
+    prims[primIndex].boundsMin = prims[owner].boundsMin;
+    prims[primIndex].boundsExtent = prims[owner].boundsExtent;
+  }
+
+  // primitives sharing an index accessor but not their vertices are often one kit piece placed again with its positions baked in
+  // (Sponza's columns and arches), so a range matching an earlier one but for where its bounds sit is dropped,
+  // and its primitives draw the earlier range with the difference as their placement
+  std::map<std::tuple<uint32_t, uint32_t, size_t>, std::vector<size_t>> pieces; // firstIndex, indexCount, vertexCount -> ranges kept
+  std::vector<size_t> sameAs(vertexJobs.size(), NO_ACCESSOR);
+  size_t repeatedVertices = 0U;
+  for (size_t j = 0; j < vertexJobs.size(); j++)
+  {
+    const PrimData& prim = prims[vertexJobs[j].prim];
+    if (prim.indexCount == 0 || vertexJobs[j].vertexCount == 0) continue;
+    auto& kept = pieces[{ prim.firstIndex, prim.indexCount, vertexJobs[j].vertexCount }];
+    for (size_t k : kept)
+    {
+      if (sameVertexRange(vertices, prims[vertexJobs[k].prim], prim, vertexJobs[j].vertexCount))
+      {
+        sameAs[j] = k;
+        repeatedVertices += vertexJobs[j].vertexCount;
+        break;
+      }
+    }
+    if (sameAs[j] == NO_ACCESSOR) kept.push_back(j);
+  }
+
+  if (repeatedVertices > 0U)
+  {
+    // ranges kept slide down over the dropped ones, which are laid out in the same order
+    std::vector<int32_t> movedTo(vertexJobs.size());
+    size_t keptTotal = static_cast<size_t>(prims[vertexJobs.front().prim].vertexOffset);
+    for (size_t j = 0; j < vertexJobs.size(); j++)
+    {
+      if (sameAs[j] != NO_ACCESSOR) continue;
+      const auto range = vertices.begin() + prims[vertexJobs[j].prim].vertexOffset;
+      std::copy(range, range + static_cast<ptrdiff_t>(vertexJobs[j].vertexCount), vertices.begin() + static_cast<ptrdiff_t>(keptTotal));
+      movedTo[j] = static_cast<int32_t>(keptTotal);
+      keptTotal += vertexJobs[j].vertexCount;
+    }
+    vertices.resize(keptTotal);
+
+    std::unordered_map<size_t, size_t> rangeOf; // prim -> vertex job it draws
+    for (size_t j = 0; j < vertexJobs.size(); j++)
+    {
+      rangeOf[vertexJobs[j].prim] = j;
+    }
+    for (auto [primIndex, owner] : sharedRanges)
+    {
+      rangeOf[primIndex] = rangeOf.at(owner);
+    }
+    for (auto [primIndex, j] : rangeOf)
+    {
+      PrimData& prim = prims[primIndex];
+      if (sameAs[j] == NO_ACCESSOR)
+      {
+        prim.vertexOffset = movedTo[j];
+        continue;
+      }
+      const PrimData& piece = prims[vertexJobs[sameAs[j]].prim];
+      prim.vertexOffset = movedTo[sameAs[j]];
+      prim.placement = prim.boundsMin - piece.boundsMin;
+      prim.boundsMin = piece.boundsMin;
+      prim.boundsExtent = piece.boundsExtent;
+    }
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  stats.geometryDecodeTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+  std::clog << "shared " << sharedIndexRanges << " index ranges and " << sharedRanges.size() << " vertex ranges between "
+            << prims.size() << " primitives, " << std::ranges::count_if(sameAs, [](size_t k) { return k != NO_ACCESSOR; })
+            << " vertex ranges repeat another elsewhere, dropping " << repeatedVertices << " vertices" << std::endl;
+
+  std::clog << "decoded " << indexJobs.size() << " index ranges and " << vertexJobs.size() << " vertex ranges into "
+            << vertices.size() << " vertices of " << sizeof(Vertex) << " bytes in " << stats.geometryDecodeTime << "us on "
+            << threadPool.size() + 1 << " threads" << std::endl;
+}
+
+void App::loadNodes()
+{
+  // the default scene depth first, so parents land before their children; without scenes every root node is drawn
+  std::vector<size_t> roots;
+  if (!asset.scenes.empty())
+  {
+    const auto& scene = asset.scenes[asset.defaultScene.value_or(0)];
+    roots.assign(scene.nodeIndices.begin(), scene.nodeIndices.end());
+  }
+  else
+  {
+    std::vector<bool> isChild(asset.nodes.size(), false);
+    for (const auto& node : asset.nodes)
+    {
+      for (size_t child : node.children) isChild[child] = true;
+    }
+    for (size_t i = 0; i < asset.nodes.size(); i++)
+    {
+      if (!isChild[i]) roots.push_back(i);
+    }
+  }
+
+  sceneGraph.clear();
+  meshInstances.clear();
+  std::vector<std::pair<size_t, uint32_t>> stack; // gltf node, parent in the graph
+  for (auto root = roots.rbegin(); root != roots.rend(); ++root)
+  {
+    stack.emplace_back(*root, SceneGraph::NO_PARENT);
+  }
+  while (!stack.empty())
+  {
+    auto [nodeIndex, parent] = stack.back();
+    stack.pop_back();
+    const fastgltf::Node& node = asset.nodes[nodeIndex];
+
+    fastgltf::TRS trs;
+    if (const auto* matrix = std::get_if<fastgltf::math::fmat4x4>(&node.transform))
+      fastgltf::math::decomposeTransformMatrix(*matrix, trs.scale, trs.rotation, trs.translation);
+    else
+      trs = std::get<fastgltf::TRS>(node.transform);
+
+    const uint32_t graphNode = sceneGraph.addNode(
+      parent,
+      glm::vec3(trs.translation.x(), trs.translation.y(), trs.translation.z()),
+      glm::quat(trs.rotation.w(), trs.rotation.x(), trs.rotation.y(), trs.rotation.z()),
+      glm::vec3(trs.scale.x(), trs.scale.y(), trs.scale.z())
+    );
+    if (node.meshIndex.has_value() && !node.instancingAttributes.empty())
+    {
+      // EXT_mesh_gpu_instancing places the mesh once per instance relative to the node, which draws nothing itself
+      size_t instanceCount = 0U;
+      for (const auto& attribute : node.instancingAttributes)
+      {
+        instanceCount = std::max(instanceCount, asset.accessors[attribute.accessorIndex].count);
+      }
+      std::vector<glm::vec3> translations(instanceCount, glm::vec3(0.0f));
+      std::vector<glm::vec4> rotations(instanceCount, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)); // xyzw
+      std::vector<glm::vec3> scales(instanceCount, glm::vec3(1.0f));
+      if (auto found = node.findInstancingAttribute("TRANSLATION"); found != node.instancingAttributes.end())
+        copyConverted<glm::vec3>(asset, asset.accessors[found->accessorIndex], translations.data());
+      if (auto found = node.findInstancingAttribute("ROTATION"); found != node.instancingAttributes.end())
+        copyConverted<glm::vec4>(asset, asset.accessors[found->accessorIndex], rotations.data());
+      if (auto found = node.findInstancingAttribute("SCALE"); found != node.instancingAttributes.end())
+        copyConverted<glm::vec3>(asset, asset.accessors[found->accessorIndex], scales.data());
+
+      for (size_t i = 0; i < instanceCount; i++)
+      {
+        const glm::quat rotation(rotations[i].w, rotations[i].x, rotations[i].y, rotations[i].z);
+        meshInstances.push_back({
+          .node = sceneGraph.addNode(graphNode, translations[i], rotation, scales[i]),
+          .mesh = static_cast<uint32_t>(node.meshIndex.value())
+        });
+      }
+    }
+    else if (node.meshIndex.has_value())
+    {
+      meshInstances.push_back({ .node = graphNode, .mesh = static_cast<uint32_t>(node.meshIndex.value()) });
+    }
+    for (auto child = node.children.rbegin(); child != node.children.rend(); ++child)
+    {
+      stack.emplace_back(*child, graphNode);
+    }
+  }
+
+  std::clog << "flattened " << sceneGraph.size() << " nodes drawing " << meshInstances.size() << " mesh instances" << std::endl;
+}
+
+void App::createDrawBatches()
+{
+  // primitives drawing the same indices from the same vertices with the same material look alike but for where they are,
+  // since primitives sharing vertices share their bounds, meshlets and levels too
+  std::map<std::tuple<uint32_t, uint32_t, int32_t, size_t>, size_t> batchOf; // firstIndex, indexCount, vertexOffset, material -> batch
+  std::vector<std::vector<BatchInstance>> instances;
+  drawBatches.clear();
+  for (const MeshInstance& instance : meshInstances)
+  {
+    const MeshData& mesh = meshes[instance.mesh];
+    for (uint32_t primIndex = mesh.firstPrim; primIndex < mesh.firstPrim + mesh.primCount; primIndex++)
+    {
+      const PrimData& p = prims[primIndex];
+      if (p.indexCount == 0) continue;
+      auto [found, inserted] = batchOf.try_emplace({ p.firstIndex, p.indexCount, p.vertexOffset, p.materialIndex }, drawBatches.size());
+      if (inserted)
+      {
+        drawBatches.push_back({ .prim = primIndex, .firstInstance = 0U, .instanceCount = 0U });
+        instances.emplace_back();
+      }
+      instances[found->second].push_back({ .node = instance.node, .placement = p.placement });
+    }
+  }
+
+  // batches of a cell are drawn together, so its buffer is bound once, and within it by index width,
+  // so each run is one indirect draw
+  std::vector<size_t> order(drawBatches.size());
+  std::iota(order.begin(), order.end(), size_t(0));
+  std::ranges::stable_sort(order, {}, [&](size_t b)
+  {
+    const PrimData& p = prims[drawBatches[b].prim];
+    return std::pair(p.cell, p.firstIndex >= shortIndexCount);
+  });
+
+  // each batch's instances are contiguous, so one draw covers them all
+  std::vector<DrawBatch> sorted;
+  sorted.reserve(drawBatches.size());
+  batchInstances.clear();
+  for (size_t b : order)
+  {
+    sorted.push_back({
+      .prim = drawBatches[b].prim,
+      .firstInstance = static_cast<uint32_t>(batchInstances.size()),
+      .instanceCount = static_cast<uint32_t>(instances[b].size())
+    });
+    batchInstances.insert(batchInstances.end(), instances[b].begin(), instances[b].end());
+  }
+  drawBatches = std::move(sorted);
+
+  std::clog << "batched " << batchInstances.size() << " primitive instances into " << drawBatches.size() << " instanced draws" << std::endl;
+}
+
+std::vector<App::VertexRange> App::collectVertexRanges() const
+{
+  std::map<int32_t, std::vector<std::pair<uint32_t, uint32_t>>> drawn; // vertexOffset -> index ranges
+  std::map<uint32_t, int32_t> drawnWith; // firstIndex -> vertexOffset, or -1 when drawn with several
+  for (const auto& p : prims)
+  {
+    auto& indexRanges = drawn[p.vertexOffset];
+    if (p.indexCount == 0) continue;
+    indexRanges.emplace_back(p.firstIndex, p.indexCount);
+    auto [found, inserted] = drawnWith.try_emplace(p.firstIndex, p.vertexOffset);
+    if (!inserted && found->second != p.vertexOffset) found->second = -1;
+  }
+
+  std::vector<VertexRange> ranges;
+  for (auto it = drawn.begin(); it != drawn.end(); ++it)
+  {
+    // vertex ranges are laid out back to back, each runs up to the next
+    const auto next = std::next(it);
+    const size_t rangeEnd = next != drawn.end() ? static_cast<size_t>(next->first) : vertices.size();
+
+    auto& range = ranges.emplace_back(VertexRange{
+      .vertexOffset = it->first,
+      .vertexCount = static_cast<uint32_t>(rangeEnd - static_cast<size_t>(it->first)),
+      .indexRanges = std::move(it->second),
+      .exclusive = true
+    });
+    std::ranges::sort(range.indexRanges);
+    range.indexRanges.erase(std::unique(range.indexRanges.begin(), range.indexRanges.end()), range.indexRanges.end());
+    range.exclusive = std::ranges::all_of(range.indexRanges, [&](const auto& indexRange)
+    {
+      return drawnWith.at(indexRange.first) == range.vertexOffset;
+    });
+  }
+  return ranges;
+}
+
+// vertices this close to one already kept are welded to it, they only differ by rounding in the exporter or in quantization
+// positions are in steps of their range's 16-bit grid, normals and tangents in snorm16 steps
+constexpr int32_t WELD_POSITION_EPSILON = 1;
+constexpr int32_t WELD_DIRECTION_EPSILON = 16;
+constexpr float WELD_TEXCOORD_EPSILON = 1.0f / 8192.0f;
+// near duplicates are found through a grid this many position steps wide, in the vertex's cell and the ones it is near
+constexpr uint32_t WELD_CELL_SIZE = 4U;
+
+static uint64_t hashWeldCell(uint32_t x, uint32_t y, uint32_t z, uint32_t w)
+{
+  const std::array<uint32_t, 4> cell = { x, y, z, w };
+  return hashBytes(reinterpret_cast<const std::byte*>(cell.data()), sizeof(cell));
+}
+
+static bool nearlyEqual(const Vertex& a, const Vertex& b)
+{
+  auto close = [](int32_t x, int32_t y, int32_t epsilon) { return std::abs(x - y) <= epsilon; };
+  return a.pos.w == b.pos.w &&
+    close(a.pos.x, b.pos.x, WELD_POSITION_EPSILON) && close(a.pos.y, b.pos.y, WELD_POSITION_EPSILON) && close(a.pos.z, b.pos.z, WELD_POSITION_EPSILON) &&
+    close(a.normal.x, b.normal.x, WELD_DIRECTION_EPSILON) && close(a.normal.y, b.normal.y, WELD_DIRECTION_EPSILON) &&
+    close(a.tangent.x, b.tangent.x, WELD_DIRECTION_EPSILON) && close(a.tangent.y, b.tangent.y, WELD_DIRECTION_EPSILON) &&
+    std::abs(glm::unpackHalf1x16(a.texCoord.x) - glm::unpackHalf1x16(b.texCoord.x)) <= WELD_TEXCOORD_EPSILON &&
+    std::abs(glm::unpackHalf1x16(a.texCoord.y) - glm::unpackHalf1x16(b.texCoord.y)) <= WELD_TEXCOORD_EPSILON;
+}
+
+// welded gets the vertices that are kept, remap where each input vertex went
+static void weldRange(std::span<const Vertex> range, std::vector<Vertex>& welded, std::vector<uint32_t>& remap, uint32_t& exactDuplicates, uint32_t& nearDuplicates)
+{
+  welded.clear();
+  remap.resize(range.size());
+  IdHashTable exact(range.size());
+  IdHashTable cells(range.size());
+
+  for (size_t v = 0; v < range.size(); v++)
+  {
+    const Vertex& vertex = range[v];
+    const uint64_t hash = std::hash<Vertex>()(vertex);
+    uint32_t found = IdHashTable::EMPTY;
+    if (exact.probe(hash, [&](uint32_t id) { found = id; return welded[id] == vertex; }))
+    {
+      remap[v] = found;
+      exactDuplicates++;
+      continue;
+    }
+
+    // a neighbouring cell is searched too when the position is within epsilon of that side of its own
+    const glm::uvec3 cell = glm::uvec3(vertex.pos) / WELD_CELL_SIZE;
+    const glm::uvec3 within = glm::uvec3(vertex.pos) % WELD_CELL_SIZE;
+    glm::ivec3 low, high;
+    for (int axis = 0; axis < 3; axis++)
+    {
+      low[axis] = cell[axis] > 0 && within[axis] < WELD_POSITION_EPSILON ? -1 : 0;
+      high[axis] = within[axis] >= WELD_CELL_SIZE - WELD_POSITION_EPSILON ? 1 : 0;
+    }
+    bool near = false;
+    for (int z = low.z; z <= high.z && !near; z++)
+      for (int y = low.y; y <= high.y && !near; y++)
+        for (int x = low.x; x <= high.x && !near; x++)
+        {
+          near = cells.probe(hashWeldCell(cell.x + x, cell.y + y, cell.z + z, vertex.pos.w), [&](uint32_t id)
+          {
+            found = id;
+            return nearlyEqual(welded[id], vertex);
+          });
+        }
+    if (near)
+    {
+      remap[v] = found;
+      nearDuplicates++;
+      continue;
+    }
+
+    const uint32_t id = static_cast<uint32_t>(welded.size());
+    welded.push_back(vertex);
+    exact.insert(hash, id);
+    cells.insert(hashWeldCell(cell.x, cell.y, cell.z, vertex.pos.w), id);
+    remap[v] = id;
+  }
+}
+
+// exact deduplication of every loaded vertex, once with IdHashTable and once with std::unordered_map,
+// the ranges are quantized to different bounds so this is only a workload of the right size and shape
+static void benchmarkWeldTables(std::span<const Vertex> vertices)
+{
+  constexpr int RUNS = 10;
+  long long int tableTime = 0L;
+  long long int mapTime = 0L;
+  size_t tableUnique = 0U;
+  size_t mapUnique = 0U;
+
+  for (int run = 0; run < RUNS; run++)
+  {
+    auto start = std::chrono::steady_clock::now();
+    {
+      std::vector<Vertex> unique;
+      unique.reserve(vertices.size());
+      IdHashTable table(vertices.size());
+      for (const Vertex& vertex : vertices)
+      {
+        const uint32_t next = static_cast<uint32_t>(unique.size());
+        if (table.findOrInsert(std::hash<Vertex>()(vertex), next, [&](uint32_t id) { return unique[id] == vertex; }) == next)
+        {
+          unique.push_back(vertex);
+        }
+      }
+      tableUnique = unique.size();
+    }
+    auto middle = std::chrono::steady_clock::now();
+    {
+      std::unordered_map<Vertex, uint32_t> map;
+      map.reserve(vertices.size());
+      for (const Vertex& vertex : vertices)
+      {
+        map.try_emplace(vertex, static_cast<uint32_t>(map.size()));
+      }
+      mapUnique = map.size();
+    }
+    auto end = std::chrono::steady_clock::now();
+    tableTime += std::chrono::duration_cast<std::chrono::microseconds>(middle - start).count();
+    mapTime += std::chrono::duration_cast<std::chrono::microseconds>(end - middle).count();
+  }
+
+  std::clog << "weld benchmark over " << vertices.size() << " vertices (" << tableUnique << " unique): open addressing "
+            << tableTime / RUNS << "us, std::unordered_map " << mapTime / RUNS << "us (" << mapUnique << " unique), mean of "
+            << RUNS << " runs" << std::endl;
+}
+
+void App::weldVertices()
+{
+  auto start = std::chrono::steady_clock::now();
+  if (benchmarkWelding) benchmarkWeldTables(vertices);
+
+  // welding renumbers vertices, so like the fetch reorder it leaves ranges that share index ranges alone
+  const std::vector<VertexRange> ranges = collectVertexRanges();
+  std::vector<std::vector<Vertex>> welded(ranges.size());
+  std::vector<uint32_t> exactDuplicates(ranges.size(), 0U);
+  std::vector<uint32_t> nearDuplicates(ranges.size(), 0U);
+  threadPool.parallelFor(ranges.size(), 1, [&](size_t begin, size_t end)
+  {
+    std::vector<uint32_t> remap;
+    for (size_t r = begin; r < end; r++)
+    {
+      const VertexRange& range = ranges[r];
+      const auto input = std::span(vertices).subspan(range.vertexOffset, range.vertexCount);
+      if (!range.exclusive)
+      {
+        welded[r].assign(input.begin(), input.end());
+        continue;
+      }
+
+      weldRange(input, welded[r], remap, exactDuplicates[r], nearDuplicates[r]);
+      for (auto [firstIndex, indexCount] : range.indexRanges)
+      {
+        for (uint32_t& index : std::span(indices).subspan(firstIndex, indexCount))
+        {
+          index = remap[index];
+        }
+      }
+    }
+  });
+
+  // across primitives, ranges left identical (the same vertices quantized to the same bounds) are kept once
+  std::unordered_map<int32_t, const PrimData*> rangePrims;
+  for (const auto& p : prims)
+  {
+    rangePrims.try_emplace(p.vertexOffset, &p);
+  }
+  std::vector<Vertex> compacted;
+  compacted.reserve(vertices.size());
+  std::unordered_map<int32_t, int32_t> newOffsets;
+  IdHashTable keptRanges(ranges.size());
+  uint32_t mergedRanges = 0U;
+  for (uint32_t r = 0; r < ranges.size(); r++)
+  {
+    const PrimData& p = *rangePrims.at(ranges[r].vertexOffset);
+    const uint64_t hash = hashBytes(reinterpret_cast<const std::byte*>(welded[r].data()), welded[r].size() * sizeof(Vertex));
+    const uint32_t kept = keptRanges.findOrInsert(hash, r, [&](uint32_t other)
+    {
+      const PrimData& otherPrim = *rangePrims.at(ranges[other].vertexOffset);
+      return welded[other] == welded[r] && otherPrim.boundsMin == p.boundsMin && otherPrim.boundsExtent == p.boundsExtent;
+    });
+
+    if (kept != r)
+    {
+      newOffsets.emplace(ranges[r].vertexOffset, newOffsets.at(ranges[kept].vertexOffset));
+      mergedRanges++;
+      continue;
+    }
+    newOffsets.emplace(ranges[r].vertexOffset, static_cast<int32_t>(compacted.size()));
+    compacted.insert(compacted.end(), welded[r].begin(), welded[r].end());
+  }
+
+  const size_t vertexCount = vertices.size();
+  vertices = std::move(compacted);
+  for (auto& p : prims)
+  {
+    p.vertexOffset = newOffsets.at(p.vertexOffset);
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  std::clog << "welded " << std::reduce(exactDuplicates.begin(), exactDuplicates.end()) << " exact and "
+            << std::reduce(nearDuplicates.begin(), nearDuplicates.end()) << " near duplicates and merged " << mergedRanges
+            << " vertex ranges, " << vertexCount << " -> " << vertices.size() << " vertices in "
+            << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << "us" << std::endl;
+}
+
+void App::optimizeGeometry()
+{
+  auto start = std::chrono::steady_clock::now();
+  stats.vertexCacheBefore = measureVertexCache(indices);
+
+  // index ranges are shared between primitives, each is optimized once against the vertices of the first that draws it
+  std::map<uint32_t, size_t> indexRanges; // firstIndex -> prim
+  for (size_t i = 0; i < prims.size(); i++)
+  {
+    if (prims[i].indexCount > 0) indexRanges.try_emplace(prims[i].firstIndex, i);
+  }
+  std::vector<size_t> rangePrims;
+  for (auto [firstIndex, prim] : indexRanges)
+  {
+    rangePrims.push_back(prim);
+  }
+
+  threadPool.parallelFor(rangePrims.size(), 1, [&](size_t begin, size_t end)
+  {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> clusters;
+    for (size_t r = begin; r < end; r++)
+    {
+      const PrimData& p = prims[rangePrims[r]];
+      const auto range = std::span(indices).subspan(p.firstIndex, p.indexCount);
+      const uint32_t vertexCount = *std::ranges::max_element(range) + 1;
+
+      // overdraw sorting only compares directions and centroids, the quantized grid is plenty
+      positions.resize(vertexCount);
+      for (uint32_t v = 0; v < vertexCount; v++)
+      {
+        positions[v] = p.boundsMin + glm::vec3(vertices[p.vertexOffset + v].pos) / static_cast<float>(UINT16_MAX) * p.boundsExtent;
+      }
+
+      optimizeVertexCache(range, vertexCount, clusters);
+      optimizeOverdraw(range, positions, clusters);
+    }
+  });
+
+  // vertices are put in the order the triangles first use them
+  std::vector<VertexRange> fetchRanges = collectVertexRanges();
+  std::erase_if(fetchRanges, [](const VertexRange& range) { return !range.exclusive; });
+
+  threadPool.parallelFor(fetchRanges.size(), 1, [&](size_t begin, size_t end)
+  {
+    constexpr uint32_t UNUSED = ~0U;
+    std::vector<uint32_t> remap;
+    std::vector<Vertex> reordered;
+    for (size_t r = begin; r < end; r++)
+    {
+      const VertexRange& range = fetchRanges[r];
+      remap.assign(range.vertexCount, UNUSED);
+      uint32_t used = 0U;
+      for (auto [firstIndex, indexCount] : range.indexRanges)
+      {
+        for (uint32_t& index : std::span(indices).subspan(firstIndex, indexCount))
+        {
+          if (remap[index] == UNUSED) remap[index] = used++;
+          index = remap[index];
+        }
+      }
 
-  endSingleTimeCommands(*commandBuffer);
+      // vertices no triangle uses go to the end
+      reordered.resize(range.vertexCount);
+      for (uint32_t v = 0; v < range.vertexCount; v++)
+      {
+        if (remap[v] == UNUSED) remap[v] = used++;
+        reordered[remap[v]] = vertices[range.vertexOffset + v];
+      }
+      std::ranges::copy(reordered, vertices.begin() + range.vertexOffset);
+    }
+  });
+
+  auto end = std::chrono::steady_clock::now();
+  stats.geometryOptimizeTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+  stats.vertexCacheAfter = measureVertexCache(indices);
+  std::clog << "optimized " << rangePrims.size() << " index ranges and " << fetchRanges.size() << " vertex ranges in "
+            << stats.geometryOptimizeTime << "us on " << threadPool.size() + 1 << " threads, ACMR "
+            << stats.vertexCacheBefore.acmr() << " -> " << stats.vertexCacheAfter.acmr() << ", ATVR "
+            << stats.vertexCacheBefore.atvr() << " -> " << stats.vertexCacheAfter.atvr() << std::endl;
 }
 
-void App::createTextureImageView(const vk::raii::Image& image, vk::Format format, uint32_t mipLevels)
+void App::createMeshlets()
 {
-  textureImageViews.emplace_back(createImageView(image, format, vk::ImageAspectFlagBits::eColor, mipLevels));
+  auto start = std::chrono::steady_clock::now();
+
+  // primitives drawing the same indices from the same vertices share meshlets, the bounds depend on both
+  std::map<std::pair<uint32_t, int32_t>, size_t> sources; // firstIndex, vertexOffset -> first prim drawing them
+  std::vector<size_t> sourcePrims;
+  for (size_t i = 0; i < prims.size(); i++)
+  {
+    if (prims[i].indexCount == 0) continue;
+    if (sources.try_emplace({prims[i].firstIndex, prims[i].vertexOffset}, sourcePrims.size()).second) sourcePrims.push_back(i);
+  }
+
+  std::vector<std::vector<Meshlet>> built(sourcePrims.size());
+  threadPool.parallelFor(sourcePrims.size(), 1, [&](size_t begin, size_t end)
+  {
+    std::vector<glm::vec3> positions;
+    for (size_t r = begin; r < end; r++)
+    {
+      const PrimData& p = prims[sourcePrims[r]];
+      const auto range = std::span(indices).subspan(p.firstIndex, p.indexCount);
+      const uint32_t vertexCount = *std::ranges::max_element(range) + 1;
+
+      // bounds are in the space the vertex shader puts positions in before the model matrix
+      positions.resize(vertexCount);
+      for (uint32_t v = 0; v < vertexCount; v++)
+      {
+        positions[v] = p.boundsMin + glm::vec3(vertices[p.vertexOffset + v].pos) / static_cast<float>(UINT16_MAX) * p.boundsExtent;
+      }
+      buildMeshlets(range, positions, built[r]);
+    }
+  });
+
+  meshlets.clear();
+  std::vector<uint32_t> firstMeshlets(built.size());
+  for (size_t r = 0; r < built.size(); r++)
+  {
+    firstMeshlets[r] = static_cast<uint32_t>(meshlets.size());
+    meshlets.insert(meshlets.end(), built[r].begin(), built[r].end());
+  }
+  for (auto& p : prims)
+  {
+    if (p.indexCount == 0) continue;
+    const size_t r = sources.at({p.firstIndex, p.vertexOffset});
+    p.firstMeshlet = firstMeshlets[r];
+    p.meshletCount = static_cast<uint32_t>(built[r].size());
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  std::clog << "built " << meshlets.size() << " meshlets for " << sourcePrims.size() << " primitives in "
+            << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << "us" << std::endl;
 }
 
-void App::createTextureSampler()
+void App::createLods()
 {
-  vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
-  vk::SamplerCreateInfo samplerInfo {
-    .magFilter = vk::Filter::eLinear,
-    .minFilter = vk::Filter::eLinear,
-    .mipmapMode = vk::SamplerMipmapMode::eLinear,
-    .addressModeU = vk::SamplerAddressMode::eRepeat,
-    .addressModeV = vk::SamplerAddressMode::eRepeat,
-    .addressModeW = vk::SamplerAddressMode::eRepeat,
-    .mipLodBias = 0.0f,
-    .anisotropyEnable = vk::True,
-    .maxAnisotropy = properties.limits.maxSamplerAnisotropy,
-    .compareEnable = vk::False,
-    .compareOp = vk::CompareOp::eAlways,
-    .minLod = 0.0f,
-    .maxLod = vk::LodClampNone
+  auto start = std::chrono::steady_clock::now();
+
+  // like meshlets, the levels depend on both the indices and the vertices they are drawn against
+  std::map<std::pair<uint32_t, int32_t>, size_t> sources; // firstIndex, vertexOffset -> first prim drawing them
+  std::vector<size_t> sourcePrims;
+  for (size_t i = 0; i < prims.size(); i++)
+  {
+    if (prims[i].indexCount == 0) continue;
+    if (sources.try_emplace({prims[i].firstIndex, prims[i].vertexOffset}, sourcePrims.size()).second) sourcePrims.push_back(i);
+  }
+
+  struct BuiltLod {
+    std::vector<uint32_t> indices;
+    float error;
   };
+  std::vector<std::vector<BuiltLod>> built(sourcePrims.size());
+  threadPool.parallelFor(sourcePrims.size(), 1, [&](size_t begin, size_t end)
+  {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> clusters;
+    for (size_t r = begin; r < end; r++)
+    {
+      const PrimData& p = prims[sourcePrims[r]];
+      const auto range = std::span(indices).subspan(p.firstIndex, p.indexCount);
+      const uint32_t vertexCount = *std::ranges::max_element(range) + 1;
 
-  textureSampler = vk::raii::Sampler(device, samplerInfo);
+      // errors come out in the space the vertex shader puts positions in, where the camera is compared against them
+      positions.resize(vertexCount);
+      for (uint32_t v = 0; v < vertexCount; v++)
+      {
+        positions[v] = p.boundsMin + glm::vec3(vertices[p.vertexOffset + v].pos) / static_cast<float>(UINT16_MAX) * p.boundsExtent;
+      }
+
+      // each level halves the one before, until the surface would move by a tenth of the primitive's size
+      // or the locked borders stop it shrinking much further
+      const float maxError = 0.1f * glm::length(p.boundsExtent);
+      std::span<const uint32_t> previous = range;
+      float error = 0.0f;
+      for (uint32_t level = 1; level < MAX_LOD_LEVELS; level++)
+      {
+        float levelError = 0.0f;
+        std::vector<uint32_t> simplified = simplifyMesh(previous, positions, previous.size() / 6 * 3, maxError, levelError);
+        if (simplified.empty() || simplified.size() * 10 > previous.size() * 8) break;
+
+        optimizeVertexCache(simplified, vertexCount, clusters);
+        // levels simplify the one before, so their errors add up
+        error += levelError;
+        built[r].push_back({ std::move(simplified), error });
+        previous = built[r].back().indices;
+      }
+    }
+  });
+
+  // every level goes after all the original ranges, createCells sorts out the widths and where they go
+  size_t originalIndices = 0U;
+  size_t coarsestIndices = 0U;
+  std::vector<std::array<LodLevel, MAX_LOD_LEVELS - 1>> levels(built.size());
+  for (size_t r = 0; r < built.size(); r++)
+  {
+    originalIndices += prims[sourcePrims[r]].indexCount;
+    coarsestIndices += built[r].empty() ? prims[sourcePrims[r]].indexCount : built[r].back().indices.size();
+    for (size_t level = 0; level < built[r].size(); level++)
+    {
+      levels[r][level] = {
+        .firstIndex = static_cast<uint32_t>(indices.size()),
+        .indexCount = static_cast<uint32_t>(built[r][level].indices.size()),
+        .error = built[r][level].error
+      };
+      indices.insert(indices.end(), built[r][level].indices.begin(), built[r][level].indices.end());
+    }
+  }
+  for (auto& p : prims)
+  {
+    if (p.indexCount == 0) continue;
+    const size_t r = sources.at({p.firstIndex, p.vertexOffset});
+    p.lodCount = static_cast<uint32_t>(built[r].size());
+    p.lods = levels[r];
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  std::clog << "simplified " << sourcePrims.size() << " primitives from " << originalIndices / 3 << " to " << coarsestIndices / 3
+            << " triangles at their coarsest in " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << "us" << std::endl;
 }
 
-void App::loadGeometry()
+// cells hold about this much geometry, a grid over the scene is sized to give about that many of them
+constexpr size_t CELL_TARGET_BYTES = 1024U * 1024U;
+
+void App::createCells()
 {
-  for (auto& mesh : asset.meshes)
+  auto start = std::chrono::steady_clock::now();
+
+  // vertex ranges run from each vertexOffset up to the next, index ranges are every primitive's and every level's
+  std::map<int32_t, uint32_t> vertexRanges; // vertexOffset -> range
+  for (const auto& p : prims)
   {
-    meshes.emplace_back(MeshData{});
-    for (auto& p : mesh.primitives)
+    vertexRanges.try_emplace(p.vertexOffset, 0U);
+  }
+  std::vector<int32_t> rangeOffsets;
+  for (auto& [vertexOffset, range] : vertexRanges)
+  {
+    range = static_cast<uint32_t>(rangeOffsets.size());
+    rangeOffsets.push_back(vertexOffset);
+  }
+
+  // vertex ranges drawn with the same index range have to land in the same cell, they are joined into units
+  std::vector<uint32_t> unitOf(rangeOffsets.size());
+  std::iota(unitOf.begin(), unitOf.end(), 0U);
+  auto find = [&](uint32_t range)
+  {
+    while (unitOf[range] != range)
+    {
+      unitOf[range] = unitOf[unitOf[range]];
+      range = unitOf[range];
+    }
+    return range;
+  };
+  std::map<uint32_t, std::pair<uint32_t, uint32_t>> indexRanges; // firstIndex -> indexCount, first vertex range drawing it
+  for (const auto& p : prims)
+  {
+    if (p.indexCount == 0) continue;
+    const uint32_t range = vertexRanges.at(p.vertexOffset);
+    auto join = [&](uint32_t firstIndex, uint32_t indexCount)
+    {
+      auto [found, inserted] = indexRanges.try_emplace(firstIndex, indexCount, range);
+      if (inserted) return;
+      found->second.first = std::max(found->second.first, indexCount);
+      unitOf[find(range)] = find(found->second.second);
+    };
+    join(p.firstIndex, p.indexCount);
+    for (const LodLevel& lod : std::span(p.lods).first(p.lodCount))
+    {
+      join(lod.firstIndex, lod.indexCount);
+    }
+  }
+
+  // units are placed by the world bounds of every instance drawing them, or where they are when nothing does
+  std::vector<glm::vec3> unitMin(rangeOffsets.size(), glm::vec3(std::numeric_limits<float>::max()));
+  std::vector<glm::vec3> unitMax(rangeOffsets.size(), glm::vec3(std::numeric_limits<float>::lowest()));
+  auto grow = [&](const PrimData& p, const glm::mat4& transform)
+  {
+    const uint32_t unit = find(vertexRanges.at(p.vertexOffset));
+    for (int corner = 0; corner < 8; corner++)
+    {
+      const glm::vec3 local = p.boundsMin + p.boundsExtent * glm::vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+      const glm::vec3 world = glm::vec3(transform * glm::vec4(local, 1.0f));
+      unitMin[unit] = glm::min(unitMin[unit], world);
+      unitMax[unit] = glm::max(unitMax[unit], world);
+    }
+  };
+  sceneGraph.update();
+  for (const MeshInstance& instance : meshInstances)
+  {
+    const MeshData& mesh = meshes[instance.mesh];
+    for (const PrimData& p : std::span(prims).subspan(mesh.firstPrim, mesh.primCount))
+    {
+      grow(p, instanceTransform({ .node = instance.node, .placement = p.placement }));
+    }
+  }
+  for (const PrimData& p : prims)
+  {
+    const uint32_t unit = find(vertexRanges.at(p.vertexOffset));
+    if (unitMin[unit].x > unitMax[unit].x) grow(p, glm::translate(glm::mat4(1.0f), p.placement));
+  }
+
+  std::vector<uint32_t> units;
+  glm::vec3 sceneMin(std::numeric_limits<float>::max());
+  glm::vec3 sceneMax(std::numeric_limits<float>::lowest());
+  for (uint32_t range = 0; range < rangeOffsets.size(); range++)
+  {
+    if (find(range) != range) continue;
+    units.push_back(range);
+    const glm::vec3 centre = 0.5f * (unitMin[range] + unitMax[range]);
+    sceneMin = glm::min(sceneMin, centre);
+    sceneMax = glm::max(sceneMax, centre);
+  }
+
+  // the smallest edge whose grid over the unit centres has at most the target number of cells,
+  // an axis shorter than the edge gets a single cell
+  const size_t targetCells = std::max<size_t>(1U, (vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t)) / CELL_TARGET_BYTES);
+  const glm::vec3 sceneExtent = units.empty() ? glm::vec3(0.0f) : sceneMax - sceneMin;
+  auto gridFor = [&](float edge)
+  {
+    return glm::max(glm::uvec3(glm::ceil(sceneExtent / edge)), glm::uvec3(1U));
+  };
+  auto cellCount = [&](float edge)
+  {
+    const glm::uvec3 grid = gridFor(edge);
+    return static_cast<size_t>(grid.x) * grid.y * grid.z;
+  };
+  float edge = std::max({ sceneExtent.x, sceneExtent.y, sceneExtent.z });
+  if (edge > 0.0f)
+  {
+    const float longest = edge;
+    while (edge > longest * 1e-4f && cellCount(edge * 0.5f) <= targetCells)
+    {
+      edge *= 0.5f;
+    }
+    for (float step = edge * 0.25f; step > edge * 1e-3f; step *= 0.5f)
     {
-      prims.emplace_back(PrimData{});
+      if (cellCount(edge - step) <= targetCells) edge -= step;
+    }
+  }
+  else
+  {
+    edge = 1.0f;
+  }
+  const glm::uvec3 grid = gridFor(edge);
 
-      uint32_t v_offset = static_cast<uint32_t>(vertices.size());
+  std::map<uint32_t, std::vector<uint32_t>> cellUnits; // grid cell -> units, both in order
+  for (uint32_t unit : units)
+  {
+    const glm::vec3 centre = 0.5f * (unitMin[unit] + unitMax[unit]);
+    const glm::uvec3 coord = glm::min(glm::uvec3(glm::max((centre - sceneMin) / edge, glm::vec3(0.0f))), grid - 1U);
+    cellUnits[coord.x + grid.x * (coord.y + grid.y * coord.z)].push_back(unit);
+  }
 
-      if (p.indicesAccessor.has_value())
+  std::vector<std::vector<uint32_t>> unitRanges(rangeOffsets.size()); // unit -> its vertex ranges
+  for (uint32_t range = 0; range < rangeOffsets.size(); range++)
+  {
+    unitRanges[find(range)].push_back(range);
+  }
+  std::vector<std::vector<uint32_t>> unitIndexRanges(rangeOffsets.size()); // unit -> firstIndex of its index ranges
+  for (const auto& [firstIndex, range] : indexRanges)
+  {
+    unitIndexRanges[find(range.second)].push_back(firstIndex);
+  }
+
+  // each cell's vertices are contiguous, and so are its 16-bit and its 32-bit index ranges
+  cells.clear();
+  std::vector<Vertex> laidOut;
+  laidOut.reserve(vertices.size());
+  std::unordered_map<int32_t, int32_t> newOffsets;
+  std::vector<uint32_t> cellOfUnit(rangeOffsets.size());
+  for (const auto& [key, members] : cellUnits)
+  {
+    auto& cell = cells.emplace_back();
+    cell.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    cell.boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+    cell.firstVertex = static_cast<uint32_t>(laidOut.size());
+    for (uint32_t unit : members)
+    {
+      cellOfUnit[unit] = static_cast<uint32_t>(cells.size() - 1);
+      cell.boundsMin = glm::min(cell.boundsMin, unitMin[unit]);
+      cell.boundsMax = glm::max(cell.boundsMax, unitMax[unit]);
+      for (uint32_t range : unitRanges[unit])
       {
-        auto& accessor = asset.accessors[p.indicesAccessor.value()];
-        prims.back().indices.resize(accessor.count);
-        fastgltf::iterateAccessorWithIndex<uint32_t>(
-          asset, accessor, [&](uint32_t index, size_t idx)
-            {
-              prims.back().indices[idx] = index + v_offset;
-            }
-        );
+        const size_t rangeEnd = range + 1 < rangeOffsets.size() ? static_cast<size_t>(rangeOffsets[range + 1]) : vertices.size();
+        newOffsets.emplace(rangeOffsets[range], static_cast<int32_t>(laidOut.size()));
+        laidOut.insert(laidOut.end(), vertices.begin() + rangeOffsets[range], vertices.begin() + rangeEnd);
       }
-      
-      auto pos = p.findAttribute("POSITION");
-      auto uv = p.findAttribute("TEXCOORD_0");
-      
-      if (pos != p.attributes.end())
+    }
+    cell.vertexCount = static_cast<uint32_t>(laidOut.size()) - cell.firstVertex;
+  }
+
+  std::vector<uint32_t> partitioned;
+  partitioned.reserve(indices.size());
+  std::unordered_map<uint32_t, uint32_t> remapped; // old firstIndex -> new
+  for (bool wide : {false, true})
+  {
+    size_t cellIndex = 0U;
+    for (const auto& [key, members] : cellUnits)
+    {
+      GeometryCell& cell = cells[cellIndex++];
+      const uint32_t first = static_cast<uint32_t>(partitioned.size());
+      for (uint32_t unit : members)
       {
-        auto& accessor = asset.accessors[pos->accessorIndex];
-        vertices.resize(v_offset + accessor.count);
-        
-        fastgltf::iterateAccessorWithIndex<glm::vec3>(
-          asset, accessor, [&](glm::vec3 position, uint32_t idx)
-          {
-            vertices[idx + v_offset].pos = position / 500.0f;
-          }
-        );
-      }
-      
-      if (uv != p.attributes.end())
-      {  
-        auto& accessor = asset.accessors[uv->accessorIndex];
-        fastgltf::iterateAccessorWithIndex<glm::vec2>(
-          asset, accessor, [&](glm::vec2 uv, uint32_t idx)
-          {
-            vertices[idx + v_offset].texCoord = uv;
-          }
-        );
+        for (uint32_t firstIndex : unitIndexRanges[unit])
+        {
+          const auto range = std::span(indices).subspan(firstIndex, indexRanges.at(firstIndex).first);
+          if ((*std::ranges::max_element(range) > UINT16_MAX) != wide) continue;
+          remapped.emplace(firstIndex, static_cast<uint32_t>(partitioned.size()));
+          partitioned.insert(partitioned.end(), range.begin(), range.end());
+        }
       }
+      (wide ? cell.firstWideIndex : cell.firstShortIndex) = first;
+      (wide ? cell.wideIndexCount : cell.shortIndexCount) = static_cast<uint32_t>(partitioned.size()) - first;
+    }
+    if (!wide) shortIndexCount = static_cast<uint32_t>(partitioned.size());
+  }
 
-      prims.back().imageViewIndex = p.materialIndex.value();
-
-      prims.back().parent = &mesh;
+  const size_t vertexCount = vertices.size();
+  vertices = std::move(laidOut);
+  indices = std::move(partitioned);
+  for (auto& p : prims)
+  {
+    p.cell = cellOfUnit[find(vertexRanges.at(p.vertexOffset))];
+    p.vertexOffset = newOffsets.at(p.vertexOffset);
+    // primitives without indices draw nothing, they are left pointing at the start
+    p.firstIndex = p.indexCount == 0 ? 0U : remapped.at(p.firstIndex);
+    for (LodLevel& lod : std::span(p.lods).first(p.lodCount))
+    {
+      lod.firstIndex = remapped.at(lod.firstIndex);
     }
   }
-}
 
-void App::copyBuffer(
-  vk::raii::Buffer& srcBuffer, vk::raii::Buffer& dstBuffer,
-  vk::DeviceSize size
-)
-{
-  vk::CommandBufferAllocateInfo allocInfo {
-    .commandPool = commandPool,
-    .level = vk::CommandBufferLevel::ePrimary, 
-    .commandBufferCount = 1
-  };
-  vk::raii::CommandBuffer commandCopyBuffer = std::move(device.allocateCommandBuffers(allocInfo).front());
-  commandCopyBuffer.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
-  commandCopyBuffer.copyBuffer(*srcBuffer, *dstBuffer, vk::BufferCopy{.size = size});
-  commandCopyBuffer.end();
-  queue.submit(vk::SubmitInfo{.commandBufferCount = 1, .pCommandBuffers = &*commandCopyBuffer}, nullptr);
-  queue.waitIdle();
+  auto end = std::chrono::steady_clock::now();
+  std::clog << "split " << units.size() << " vertex range groups into " << cells.size() << " cells on a " << grid.x << "x" << grid.y
+            << "x" << grid.z << " grid of " << edge << " units, " << vertexCount << " -> " << vertices.size() << " vertices, "
+            << shortIndexCount << " indices as uint16 and " << indices.size() - shortIndexCount << " as uint32 in "
+            << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << "us" << std::endl;
 }
 
-void App::createVertexBuffer()
+VertexCacheStats App::measureVertexCache(std::span<const uint32_t> indexData) const
 {
-  vk::DeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-  vk::raii::Buffer stagingBuffer({});
-  vk::raii::DeviceMemory stagingBufferMemory({});
+  // every draw counts, a range drawn by several primitives is transformed that many times
+  VertexCacheStats total;
+  for (const auto& p : prims)
+  {
+    if (p.indexCount == 0) continue;
+    const auto range = indexData.subspan(p.firstIndex, p.indexCount);
+    total += analyzeVertexCache(range, *std::ranges::max_element(range) + 1);
+  }
+  return total;
+}
 
-  createBuffer(
-    bufferSize,
-    vk::BufferUsageFlagBits::eTransferSrc,
-    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-    stagingBuffer,
-    stagingBufferMemory
-  );
+// reads in flight at once, each is a copy out of the mapped cache that may have to page in from disk
+constexpr uint32_t MAX_CELL_READS = 8U;
+// how much of each frame's measured velocity goes into the smoothed one prefetching follows
+constexpr float STREAMING_VELOCITY_SMOOTHING = 0.25f;
 
-  void* dataStaging = stagingBufferMemory.mapMemory(0, bufferSize);
-  memcpy(dataStaging, vertices.data(), bufferSize);
-  stagingBufferMemory.unmapMemory();
+void App::createCellStreamer()
+{
+  std::vector<CellStreamer::Cell> streamed;
+  streamed.reserve(cells.size());
+  vk::DeviceSize geometryBytes = 0U;
+  for (const auto& cell : cells)
+  {
+    streamed.push_back({ .boundsMin = cell.boundsMin, .boundsMax = cell.boundsMax, .hostBytes = cell.size(), .deviceBytes = cell.size() });
+    geometryBytes += cell.size();
+  }
+  cellStreamer.reset(std::move(streamed));
+  cellsUploading.clear();
+  lastStreamTime = {};
 
-  createBuffer(
-    bufferSize,
-    vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
-    vk::MemoryPropertyFlagBits::eDeviceLocal,
-    vertexBuffer,
-    vertexBufferMemory
-  );
+  std::clog << "streaming " << cells.size() << " cells holding " << geometryBytes << " bytes of geometry" << std::endl;
+}
 
-  copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+// a cell's vertices split into their streams then its indices, the 16-bit part narrowed, as they are laid out on the device
+static void packCell(GeometryCell& cell, std::span<const Vertex> vertices, std::span<const uint32_t> indices)
+{
+  cell.hostData.resize(cell.size());
+  std::byte* positions = cell.hostData.data() + cell.streamOffset(0);
+  std::byte* frames = cell.hostData.data() + cell.streamOffset(1);
+  std::byte* texCoords = cell.hostData.data() + cell.streamOffset(2);
+  for (const Vertex& vertex : vertices.subspan(cell.firstVertex, cell.vertexCount))
+  {
+    positions = std::copy_n(reinterpret_cast<const std::byte*>(&vertex.pos), sizeof(vertex.pos), positions);
+    frames = std::copy_n(reinterpret_cast<const std::byte*>(&vertex.normal), sizeof(vertex.normal), frames);
+    frames = std::copy_n(reinterpret_cast<const std::byte*>(&vertex.tangent), sizeof(vertex.tangent), frames);
+    texCoords = std::copy_n(reinterpret_cast<const std::byte*>(&vertex.texCoord), sizeof(vertex.texCoord), texCoords);
+  }
+  auto* shortIndices = reinterpret_cast<uint16_t*>(cell.hostData.data() + cell.indexOffset());
+  for (uint32_t i = 0; i < cell.shortIndexCount; i++)
+  {
+    shortIndices[i] = static_cast<uint16_t>(indices[cell.firstShortIndex + i]);
+  }
+  std::memcpy(cell.hostData.data() + cell.wideIndexOffset(), indices.data() + cell.firstWideIndex, sizeof(uint32_t) * cell.wideIndexCount);
 }
 
-void App::createIndexBuffers()
+void App::streamCells()
 {
-  for (auto& p : prims)
+  auto start = std::chrono::steady_clock::now();
+
+  std::deque<ReadCell> read;
+  {
+    std::lock_guard lock(readCellsMutex);
+    read.swap(readCells);
+  }
+  std::exception_ptr error;
+  for (const auto& done : read)
   {
-    vk::DeviceSize bufferSize = sizeof(p.indices[0]) * p.indices.size();
-    vk::raii::Buffer stagingBuffer({});
-    vk::raii::DeviceMemory stagingBufferMemory({});
+    if (done.error && !error) error = done.error;
+    cellStreamer.readFinished(done.cell);
+  }
+  if (error) std::rethrow_exception(error);
 
-    createBuffer(
-      bufferSize,
-      vk::BufferUsageFlagBits::eTransferSrc,
-      vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-      stagingBuffer,
-      stagingBufferMemory
-    );
+  // a cell is drawable once the frame acquiring its upload is being recorded
+  std::erase_if(cellsUploading, [&](uint32_t cell)
+  {
+    if (cells[cell].uploadValue > uploadsAcquired) return false;
+    cellStreamer.uploadFinished(cell);
+    return true;
+  });
+
+  // prefetching follows the velocity the camera has actually been moving at, not the keys held
+  const float seconds = std::chrono::duration<float>(start - lastStreamTime).count();
+  if (lastStreamTime != std::chrono::steady_clock::time_point{} && seconds > 0.0f)
+  {
+    streamingVelocity = glm::mix(streamingVelocity, (cullCameraPosition - streamingPosition) / seconds, STREAMING_VELOCITY_SMOOTHING);
+  }
+  streamingPosition = cullCameraPosition;
+  lastStreamTime = start;
+
+  // cooked geometry kept because the cache could not be written takes its share of the host budget first
+  const uint64_t hostBudget = static_cast<uint64_t>(std::max(streamingHostBudgetMB, 0)) * 1024U * 1024U;
+  const CellStreamer::Settings settings {
+    .radius = streamingRadius,
+    .lookahead = streamingLookahead,
+    .hostBudget = hostBudget - std::min(hostBudget, cookedHostBytes),
+    .deviceBudget = static_cast<uint64_t>(std::max(streamingDeviceBudgetMB, 0)) * 1024U * 1024U,
+    .maxReads = MAX_CELL_READS
+  };
+  cellStreamer.plan(streamingPosition, streamingVelocity, settings, streamingPlan);
 
-    void* dataStaging = stagingBufferMemory.mapMemory(0, bufferSize);
-    memcpy(dataStaging, p.indices.data(), (size_t) bufferSize);
-    stagingBufferMemory.unmapMemory();
+  // the previous frame may still be drawing from an evicted cell, this frame does not
+  for (uint32_t c : streamingPlan.deviceEvictions)
+  {
+    GeometryCell& cell = cells[c];
+    retiredCellBuffers[currentFrame].emplace_back(std::move(cell.buffer), std::move(cell.bufferMemory));
+    cell.buffer = nullptr;
+    cell.bufferMemory = nullptr;
+    cell.uploadValue = UPLOAD_PENDING;
+  }
 
+  for (uint32_t c : streamingPlan.uploads)
+  {
+    GeometryCell& cell = cells[c];
     createBuffer(
-      bufferSize,
-      vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+      cell.size(),
+      vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
       vk::MemoryPropertyFlagBits::eDeviceLocal,
-      p.indexBuffer,
-      p.indexBufferMemory
+      cell.buffer,
+      cell.bufferMemory
     );
+    cell.uploadValue = uploadBatch->uploadBuffer(
+      cell.hostData.data(), cell.hostData.size(), *cell.buffer, 0,
+      vk::PipelineStageFlagBits2::eVertexAttributeInput | vk::PipelineStageFlagBits2::eIndexInput,
+      vk::AccessFlagBits2::eVertexAttributeRead | vk::AccessFlagBits2::eIndexRead
+    );
+    cellsUploading.push_back(c);
+  }
+  if (!streamingPlan.uploads.empty()) uploadBatch->submit();
+
+  // uploads are staged by now, so the host copies can go
+  for (uint32_t c : streamingPlan.hostEvictions)
+  {
+    cells[c].hostData = {};
+  }
+
+  for (uint32_t c : streamingPlan.reads)
+  {
+    threadPool.submit([this, c]
+    {
+      ReadCell result { .cell = c };
+      try
+      {
+        packCell(cells[c], cellVertices, cellIndices);
+      }
+      catch (...)
+      {
+        result.error = std::current_exception();
+      }
+      std::lock_guard lock(readCellsMutex);
+      readCells.push_back(std::move(result));
+    });
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  stats.cellStreamTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+  stats.cellsResident = cellStreamer.residentCount();
+  stats.cellUploads = cellStreamer.uploadCount();
+  stats.cellEvictions = cellStreamer.evictionCount();
+  stats.cellDeviceBytes = cellStreamer.deviceBytes();
+  stats.cellHostBytes = cellStreamer.hostBytes() + cookedHostBytes;
+}
+
+void App::pumpUploads()
+{
+  std::deque<DecodedTexture> decoded;
+  {
+    std::lock_guard lock(decodedMutex);
+    decoded.swap(decodedTextures);
+  }
+
+  // this thread is the only uploader, it owns the upload queue and its command pool
+  std::exception_ptr error;
+  for (auto& texture : decoded)
+  {
+    texturesPending--;
+    if (error || texture.error)
+    {
+      if (!error) error = texture.error;
+      if (texture.kTexture != nullptr) ktxTexture2_Destroy(texture.kTexture);
+      continue;
+    }
+
+    try
+    {
+      createTextureImage(texture.kTexture, texture.index);
+    }
+    catch (...)
+    {
+      error = std::current_exception();
+    }
+  }
+
+  if (error) std::rethrow_exception(error);
 
-    copyBuffer(stagingBuffer, p.indexBuffer, bufferSize);
+  uploadBatch->submit();
+  uploadBatch->collect();
+
+  const auto& uploadStats = uploadBatch->getStats();
+  stats.uploadSubmissions = uploadStats.submissions;
+  stats.uploadWaitTime = uploadStats.waitTime;
+
+  if (stats.textureLoadTime == 0L && texturesPending == 0 && sceneUploadValue <= uploadsAcquired)
+  {
+    stats.textureLoadTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+    std::clog << "scene resident after " << stats.textureLoadTime << "us, " << materialTextures.size() << " textures decoded on "
+              << threadPool.size() << " threads" << std::endl;
+    std::clog << "uploaded " << uploadStats.uploads << " resources (" << uploadStats.bytesStaged << " bytes) in "
+              << uploadStats.submissions << " submissions from " << uploadStats.commandBuffers << " command buffers on "
+              << (uploadBatch->transfersOwnership() ? "a dedicated transfer queue" : "the graphics queue") << ", waited "
+              << uploadStats.waitTime << "us" << std::endl;
   }
 }
 
@@ -1109,25 +3195,82 @@ void App::createUniformBuffers()
   {
     vk::DeviceSize bufferSize = sizeof(MVP);
     vk::raii::Buffer buffer({});
-    vk::raii::DeviceMemory bufferMemory({});
+    DeviceAllocation bufferMemory = nullptr;
     createBuffer(bufferSize, vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, buffer, bufferMemory);
     uniformBuffers.emplace_back(std::move(buffer));
+    // host-visible blocks stay mapped for the allocator's lifetime
+    uniformBuffersMapped.emplace_back(bufferMemory.getMapped());
     uniformBuffersMemory.emplace_back(std::move(bufferMemory));
-    uniformBuffersMapped.emplace_back(uniformBuffersMemory[i].mapMemory(0, bufferSize));
   }
 }
 
+void App::createTransformBuffers()
+{
+  transformBuffers.clear();
+  transformBuffersMemory.clear();
+  transformBuffersMapped.clear();
+
+  // a scene without instances still binds a valid buffer
+  const vk::DeviceSize bufferSize = std::max<size_t>(batchInstances.size(), 1) * sizeof(glm::mat4);
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+  {
+    vk::raii::Buffer buffer({});
+    DeviceAllocation bufferMemory = nullptr;
+    createBuffer(bufferSize, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, buffer, bufferMemory);
+    transformBuffers.emplace_back(std::move(buffer));
+    transformBuffersMapped.emplace_back(bufferMemory.getMapped());
+    transformBuffersMemory.emplace_back(std::move(bufferMemory));
+  }
+  // no frame's copy holds anything yet
+  transformGenerations.fill(~uint64_t(0));
+}
+
+void App::createCullBuffers()
+{
+  cullGroupBuffers.clear();
+  cullGroupBuffersMemory.clear();
+  cullGroupBuffersMapped.clear();
+  cullStatsBuffers.clear();
+  cullStatsBuffersMemory.clear();
+  cullStatsBuffersMapped.clear();
+
+  // a scene without groups still binds a valid buffer
+  const vk::DeviceSize groupsSize = std::max<size_t>(drawGroups.size(), 1) * sizeof(CullGroup);
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+  {
+    vk::raii::Buffer groupBuffer({});
+    DeviceAllocation groupBufferMemory = nullptr;
+    createBuffer(groupsSize, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, groupBuffer, groupBufferMemory);
+    cullGroupBuffers.emplace_back(std::move(groupBuffer));
+    cullGroupBuffersMapped.emplace_back(groupBufferMemory.getMapped());
+    cullGroupBuffersMemory.emplace_back(std::move(groupBufferMemory));
+
+    // read and cleared by the cpu once the frame's fence has passed
+    vk::raii::Buffer statsBuffer({});
+    DeviceAllocation statsBufferMemory = nullptr;
+    createBuffer(sizeof(CullStats), vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, statsBuffer, statsBufferMemory);
+    cullStatsBuffers.emplace_back(std::move(statsBuffer));
+    cullStatsBuffersMapped.emplace_back(statsBufferMemory.getMapped());
+    *static_cast<CullStats*>(cullStatsBuffersMapped.back()) = {};
+    cullStatsBuffersMemory.emplace_back(std::move(statsBufferMemory));
+  }
+}
 
 void App::createDescriptorPools()
 {
+  const uint32_t textureCount = static_cast<uint32_t>(materialTextures.size()) + 1U;
+  // a graphics and a culling set per frame in flight, and a set per level of the depth pyramid
   std::array poolSizes = {
-    vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, MAX_FRAMES_IN_FLIGHT * static_cast<uint32_t>(prims.size())),
-    vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, MAX_FRAMES_IN_FLIGHT * static_cast<uint32_t>(prims.size()))
+    vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, MAX_FRAMES_IN_FLIGHT * 2U),
+    vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, MAX_FRAMES_IN_FLIGHT * textureCount),
+    vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, MAX_FRAMES_IN_FLIGHT * (4U + 9U)),
+    vk::DescriptorPoolSize(vk::DescriptorType::eSampledImage, MAX_FRAMES_IN_FLIGHT + MAX_DEPTH_PYRAMID_LEVELS),
+    vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, MAX_DEPTH_PYRAMID_LEVELS)
   };
 
   vk::DescriptorPoolCreateInfo poolInfo {
     .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-    .maxSets = MAX_FRAMES_IN_FLIGHT * static_cast<uint32_t>(prims.size()),
+    .maxSets = MAX_FRAMES_IN_FLIGHT * 2U + MAX_DEPTH_PYRAMID_LEVELS,
     .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
     .pPoolSizes = poolSizes.data()
   };
@@ -1149,65 +3292,251 @@ void App::createDescriptorPools()
     vk::DescriptorPoolSize(vk::DescriptorType::eInputAttachment, 10)
   };
 
-  vk::DescriptorPoolCreateInfo imguiPoolInfo {
-    .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-    .maxSets = 1000 * static_cast<uint32_t>(imguiPoolSizes.size()),
-    .poolSizeCount = static_cast<uint32_t>(imguiPoolSizes.size()),
-    .pPoolSizes = imguiPoolSizes.data()
-  };
+  vk::DescriptorPoolCreateInfo imguiPoolInfo {
+    .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+    .maxSets = 1000 * static_cast<uint32_t>(imguiPoolSizes.size()),
+    .poolSizeCount = static_cast<uint32_t>(imguiPoolSizes.size()),
+    .pPoolSizes = imguiPoolSizes.data()
+  };
+
+  imguiDescriptorPool = vk::raii::DescriptorPool(device, imguiPoolInfo);
+}
+
+void App::createDescriptorSets()
+{
+  // every image and the white fallback
+  const uint32_t textureCount = static_cast<uint32_t>(materialTextures.size()) + 1U;
+  if (textureCount > maxBindlessTextures)
+  {
+    throw std::runtime_error(std::string("failed to fit ").append(std::to_string(textureCount))
+      .append(" textures in a bindless array of ").append(std::to_string(maxBindlessTextures)));
+  }
+
+  std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, *descriptorSetLayout);
+  std::vector<uint32_t> textureCounts(MAX_FRAMES_IN_FLIGHT, textureCount);
+  vk::DescriptorSetVariableDescriptorCountAllocateInfo textureCountInfo {
+    .descriptorSetCount = static_cast<uint32_t>(textureCounts.size()),
+    .pDescriptorCounts = textureCounts.data()
+  };
+  vk::DescriptorSetAllocateInfo allocInfo {
+    .pNext = &textureCountInfo,
+    .descriptorPool = static_cast<vk::DescriptorPool>(descriptorPool),
+    .descriptorSetCount = static_cast<uint32_t>(layouts.size()),
+    .pSetLayouts = layouts.data(),
+  };
+  descriptorSets.clear();
+  descriptorSets = device.allocateDescriptorSets(allocInfo);
+  textureBound.assign(textureCount, {});
+
+  // textures are written by bindResidentTextures once they have been uploaded
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+  {
+    vk::DescriptorBufferInfo bufferInfo {
+      .buffer = static_cast<vk::Buffer>(uniformBuffers[i]),
+      .offset = 0,
+      .range = sizeof(MVP)
+    };
+
+    vk::DescriptorBufferInfo materialsInfo {
+      .buffer = static_cast<vk::Buffer>(materialBuffer),
+      .offset = 0,
+      .range = vk::WholeSize
+    };
+
+    vk::DescriptorBufferInfo transformsInfo {
+      .buffer = static_cast<vk::Buffer>(transformBuffers[i]),
+      .offset = 0,
+      .range = vk::WholeSize
+    };
+
+    vk::DescriptorBufferInfo drawDataInfo {
+      .buffer = static_cast<vk::Buffer>(drawDataBuffer),
+      .offset = 0,
+      .range = vk::WholeSize
+    };
+
+    vk::DescriptorBufferInfo culledDrawIdsInfo {
+      .buffer = static_cast<vk::Buffer>(culledDrawIdBuffer),
+      .offset = 0,
+      .range = vk::WholeSize
+    };
 
-  imguiDescriptorPool = vk::raii::DescriptorPool(device, imguiPoolInfo);
-}
+    std::array descriptorWrites = {
+      vk::WriteDescriptorSet {
+        .dstSet = static_cast<vk::DescriptorSet>(descriptorSets[i]),
+        .dstBinding = 0,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = vk::DescriptorType::eUniformBuffer,
+        .pBufferInfo = &bufferInfo
+      },
+      vk::WriteDescriptorSet {
+        .dstSet = static_cast<vk::DescriptorSet>(descriptorSets[i]),
+        .dstBinding = 1,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = vk::DescriptorType::eStorageBuffer,
+        .pBufferInfo = &materialsInfo
+      },
+      vk::WriteDescriptorSet {
+        .dstSet = static_cast<vk::DescriptorSet>(descriptorSets[i]),
+        .dstBinding = 2,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = vk::DescriptorType::eStorageBuffer,
+        .pBufferInfo = &transformsInfo
+      },
+      vk::WriteDescriptorSet {
+        .dstSet = static_cast<vk::DescriptorSet>(descriptorSets[i]),
+        .dstBinding = 3,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = vk::DescriptorType::eStorageBuffer,
+        .pBufferInfo = &drawDataInfo
+      },
+      vk::WriteDescriptorSet {
+        .dstSet = static_cast<vk::DescriptorSet>(descriptorSets[i]),
+        .dstBinding = 4,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = vk::DescriptorType::eStorageBuffer,
+        .pBufferInfo = &culledDrawIdsInfo
+      }
+    };
 
-void App::createDescriptorSets()
-{
-  for (auto& p : prims)
+    device.updateDescriptorSets(descriptorWrites, {});
+  }
+
+  // the culling sets, their depth pyramid is written by createDepthPyramidSets
+  std::vector<vk::DescriptorSetLayout> cullLayouts(MAX_FRAMES_IN_FLIGHT, *cullSetLayout);
+  vk::DescriptorSetAllocateInfo cullAllocInfo {
+    .descriptorPool = static_cast<vk::DescriptorPool>(descriptorPool),
+    .descriptorSetCount = static_cast<uint32_t>(cullLayouts.size()),
+    .pSetLayouts = cullLayouts.data(),
+  };
+  cullDescriptorSets.clear();
+  cullDescriptorSets = device.allocateDescriptorSets(cullAllocInfo);
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
   {
-    std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, *descriptorSetLayout);
-    vk::DescriptorSetAllocateInfo allocInfo {
-      .descriptorPool = static_cast<vk::DescriptorPool>(descriptorPool),
-      .descriptorSetCount = static_cast<uint32_t>(layouts.size()),
-      .pSetLayouts = layouts.data(),
+    // in binding order, see cull.slang
+    std::array bufferInfos = {
+      vk::DescriptorBufferInfo { .buffer = static_cast<vk::Buffer>(uniformBuffers[i]), .offset = 0, .range = sizeof(MVP) },
+      vk::DescriptorBufferInfo { .buffer = static_cast<vk::Buffer>(transformBuffers[i]), .offset = 0, .range = vk::WholeSize },
+      vk::DescriptorBufferInfo { .buffer = static_cast<vk::Buffer>(drawDataBuffer), .offset = 0, .range = vk::WholeSize },
+      vk::DescriptorBufferInfo { .buffer = static_cast<vk::Buffer>(drawCommandBuffer), .offset = 0, .range = vk::WholeSize },
+      vk::DescriptorBufferInfo { .buffer = static_cast<vk::Buffer>(cullGroupBuffers[i]), .offset = 0, .range = vk::WholeSize },
+      vk::DescriptorBufferInfo { .buffer = static_cast<vk::Buffer>(culledCommandBuffer), .offset = 0, .range = vk::WholeSize },
+      vk::DescriptorBufferInfo { .buffer = static_cast<vk::Buffer>(culledDrawIdBuffer), .offset = 0, .range = vk::WholeSize },
+      vk::DescriptorBufferInfo { .buffer = static_cast<vk::Buffer>(culledCountBuffer), .offset = 0, .range = vk::WholeSize },
+      vk::DescriptorBufferInfo { .buffer = static_cast<vk::Buffer>(occludedBuffer), .offset = 0, .range = vk::WholeSize },
+      vk::DescriptorBufferInfo { .buffer = static_cast<vk::Buffer>(cullStatsBuffers[i]), .offset = 0, .range = vk::WholeSize }
     };
-    p.descriptorSets.clear();
-    p.descriptorSets = device.allocateDescriptorSets(allocInfo);
-
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    std::vector<vk::WriteDescriptorSet> descriptorWrites;
+    for (uint32_t binding = 0; binding < bufferInfos.size(); binding++)
     {
-      vk::DescriptorBufferInfo bufferInfo {
-        .buffer = static_cast<vk::Buffer>(uniformBuffers[i]),
-        .offset = 0,
-        .range = sizeof(MVP)
-      };
+      descriptorWrites.push_back({
+        .dstSet = static_cast<vk::DescriptorSet>(cullDescriptorSets[i]),
+        .dstBinding = binding,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = binding == 0 ? vk::DescriptorType::eUniformBuffer : vk::DescriptorType::eStorageBuffer,
+        .pBufferInfo = &bufferInfos[binding]
+      });
+    }
+    device.updateDescriptorSets(descriptorWrites, {});
+  }
+}
 
-      vk::DescriptorImageInfo imageInfo {
-        .sampler = static_cast<vk::Sampler>(textureSampler),
-        .imageView = static_cast<vk::ImageView>(textureImageViews[p.imageViewIndex]),
-        .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
-      };
+void App::createDepthPyramidSets()
+{
+  std::vector<vk::DescriptorSetLayout> layouts(depthPyramidLevels, *pyramidSetLayout);
+  vk::DescriptorSetAllocateInfo allocInfo {
+    .descriptorPool = static_cast<vk::DescriptorPool>(descriptorPool),
+    .descriptorSetCount = static_cast<uint32_t>(layouts.size()),
+    .pSetLayouts = layouts.data(),
+  };
+  depthPyramidSets.clear();
+  depthPyramidSets = device.allocateDescriptorSets(allocInfo);
 
-      std::array descriptorWrites = {
-        vk::WriteDescriptorSet{
-          .dstSet = static_cast<vk::DescriptorSet>(p.descriptorSets[i]),
-          .dstBinding = 0,
-          .dstArrayElement = 0,
-          .descriptorCount = 1,
-          .descriptorType = vk::DescriptorType::eUniformBuffer,
-          .pBufferInfo = &bufferInfo
-        },
-        vk::WriteDescriptorSet{
-          .dstSet = static_cast<vk::DescriptorSet>(p.descriptorSets[i]),
-          .dstBinding = 1,
-          .dstArrayElement = 0,
-          .descriptorCount = 1,
-          .descriptorType = vk::DescriptorType::eCombinedImageSampler,
-          .pImageInfo = &imageInfo
-        },
-      };
+  // the pyramid stays in the general layout, read and written, the depth buffer is read between the phases' renderings
+  for (uint32_t level = 0; level < depthPyramidLevels; level++)
+  {
+    vk::DescriptorImageInfo sourceInfo {
+      .imageView = level == 0 ? *depthImageView : *depthPyramidLevelViews[level - 1],
+      .imageLayout = level == 0 ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::eGeneral
+    };
+    vk::DescriptorImageInfo destinationInfo {
+      .imageView = depthPyramidLevelViews[level],
+      .imageLayout = vk::ImageLayout::eGeneral
+    };
+    std::array descriptorWrites = {
+      vk::WriteDescriptorSet {
+        .dstSet = static_cast<vk::DescriptorSet>(depthPyramidSets[level]),
+        .dstBinding = 0,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = vk::DescriptorType::eSampledImage,
+        .pImageInfo = &sourceInfo
+      },
+      vk::WriteDescriptorSet {
+        .dstSet = static_cast<vk::DescriptorSet>(depthPyramidSets[level]),
+        .dstBinding = 1,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = vk::DescriptorType::eStorageImage,
+        .pImageInfo = &destinationInfo
+      }
+    };
+    device.updateDescriptorSets(descriptorWrites, {});
+  }
 
-      device.updateDescriptorSets(descriptorWrites, {});
-    }
+  vk::DescriptorImageInfo pyramidInfo {
+    .imageView = depthPyramidView,
+    .imageLayout = vk::ImageLayout::eGeneral
+  };
+  for (const auto& cullDescriptorSet : cullDescriptorSets)
+  {
+    vk::WriteDescriptorSet descriptorWrite {
+      .dstSet = static_cast<vk::DescriptorSet>(cullDescriptorSet),
+      .dstBinding = 10,
+      .dstArrayElement = 0,
+      .descriptorCount = 1,
+      .descriptorType = vk::DescriptorType::eSampledImage,
+      .pImageInfo = &pyramidInfo
+    };
+    device.updateDescriptorSets(descriptorWrite, {});
+  }
+}
+
+void App::bindResidentTextures()
+{
+  // draws read the material buffer for their texture, none can go until it has landed
+  if (materialUploadValue > uploadsAcquired) return;
+
+  // only this frame's set, the other frame in flight may still be reading its own
+  std::vector<vk::DescriptorImageInfo> imageInfos;
+  std::vector<vk::WriteDescriptorSet> descriptorWrites;
+  imageInfos.reserve(textureBound.size());
+  for (size_t texture = 0; texture < textureBound.size(); texture++)
+  {
+    if (textureBound[texture][currentFrame] || textureUploadValues[texture] > uploadsAcquired) continue;
+
+    imageInfos.push_back({
+      .sampler = static_cast<vk::Sampler>(textureSampler),
+      .imageView = static_cast<vk::ImageView>(textureImageViews[texture]),
+      .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+    });
+    descriptorWrites.push_back({
+      .dstSet = static_cast<vk::DescriptorSet>(descriptorSets[currentFrame]),
+      .dstBinding = 5,
+      .dstArrayElement = static_cast<uint32_t>(texture),
+      .descriptorCount = 1,
+      .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+      .pImageInfo = &imageInfos.back()
+    });
+    textureBound[texture][currentFrame] = true;
   }
+  if (!descriptorWrites.empty()) device.updateDescriptorSets(descriptorWrites, {});
 }
 
 void App::createCommandBuffers()
@@ -1223,6 +3552,41 @@ void App::createCommandBuffers()
   commandBuffers = vk::raii::CommandBuffers(device, allocInfo);
 }
 
+void App::createSecondaryCommandBuffers()
+{
+  recordingSlots = threadPool.size() + 1;
+  secondaryCommandBuffers.clear();
+  imguiCommandBuffers.clear();
+  secondaryCommandPools.clear();
+
+  for (uint32_t slot = 0; slot < MAX_FRAMES_IN_FLIGHT * recordingSlots; slot++)
+  {
+    // reset whole once a frame rather than buffer by buffer
+    vk::CommandPoolCreateInfo poolInfo {
+      .flags = vk::CommandPoolCreateFlagBits::eTransient,
+      .queueFamilyIndex = graphicsIndex,
+    };
+    secondaryCommandPools.emplace_back(device, poolInfo);
+
+    vk::CommandBufferAllocateInfo allocInfo {
+      .commandPool = secondaryCommandPools.back(),
+      .level = vk::CommandBufferLevel::eSecondary,
+      .commandBufferCount = 2
+    };
+    for (vk::raii::CommandBuffer& commandBuffer : vk::raii::CommandBuffers(device, allocInfo))
+    {
+      secondaryCommandBuffers.push_back(std::move(commandBuffer));
+    }
+  }
+
+  vk::CommandBufferAllocateInfo imguiAllocInfo {
+    .commandPool = commandPool,
+    .level = vk::CommandBufferLevel::eSecondary,
+    .commandBufferCount = MAX_FRAMES_IN_FLIGHT
+  };
+  imguiCommandBuffers = vk::raii::CommandBuffers(device, imguiAllocInfo);
+}
+
 void App::createSyncObjects()
 {
   presentCompleteSemaphores.clear();
@@ -1290,11 +3654,13 @@ void App::mainLoop()
 {
   static bool showWindow = true;
   float deltaMultiplier = 1000000.0f;
-  for (auto& p : prims)
+  for (const auto& instance : meshInstances)
   {
-    stats.tris += static_cast<uint32_t>(p.indices.size());
+    for (const auto& p : std::span(prims).subspan(meshes[instance.mesh].firstPrim, meshes[instance.mesh].primCount))
+    {
+      stats.tris += p.indexCount / 3;
+    }
   }
-  stats.tris /= 3;
   camera.update(1.0f);
   double xpos, ypos;
   while (glfwWindowShouldClose(pWindow) != GLFW_TRUE)
@@ -1320,6 +3686,8 @@ void App::mainLoop()
     if (ypos == camera.oldYpos)
       camera.deltaPitch = 0.0f;
 
+    stats.memory = allocator->getStats();
+
     ImGui_ImplVulkan_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -1327,7 +3695,52 @@ void App::mainLoop()
     {
       ImGui::Begin("Delta Frametime", &showWindow, ImGuiWindowFlags_AlwaysAutoResize);
       ImGui::Text("%llius", stats.frametime);
-      ImGui::Text("%i tris", stats.tris);
+      ImGui::Text("%i tris, %u drawn", stats.tris, stats.trisDrawn);
+      ImGui::Text("%u draw calls, %u/%u meshlets visible", stats.drawcalls, stats.meshletsVisible, stats.meshletsTotal);
+      if (!indirectDraws)
+        ImGui::Text("%u/%u batches in the frustum, culled in %llius", stats.batchesVisible, stats.batchesTotal, stats.frustumCullTime);
+      ImGui::Text("%u indirect commands, recorded in %llius", stats.indirectCommands, stats.meshDrawTime);
+      if (indirectDraws && occlusionCulling)
+      {
+        ImGui::Text("%u batches tested, %u outside the frustum", stats.cull.tested, stats.cull.frustumRejected);
+        ImGui::Text("phase 1 drew %u, occluded %u, phase 2 drew %u", stats.cull.phase1Drawn, stats.cull.phase1Occluded, stats.cull.phase2Drawn);
+      }
+      ImGui::Text("%zu primitive instances in %zu batches", batchInstances.size(), drawBatches.size());
+      ImGui::Text("%u/%zu cells resident, %u uploaded, %u evicted in total, streamed in %llius", stats.cellsResident, cells.size(), stats.cellUploads, stats.cellEvictions, stats.cellStreamTime);
+      ImGui::Text("cells take %.1f/%d MB of device and %.1f/%d MB of host memory", stats.cellDeviceBytes / 1048576.0, streamingDeviceBudgetMB, stats.cellHostBytes / 1048576.0, streamingHostBudgetMB);
+      ImGui::SliderFloat("Streaming Radius", &streamingRadius, 1.0f, 1000.0f);
+      ImGui::SliderFloat("Prefetch Seconds", &streamingLookahead, 0.0f, 4.0f);
+      ImGui::SliderInt("Device Budget MB", &streamingDeviceBudgetMB, 1, 4096);
+      ImGui::SliderInt("Host Budget MB", &streamingHostBudgetMB, 1, 4096);
+      ImGui::Checkbox("Cull Meshlets", &cullMeshlets);
+      ImGui::Checkbox("Select LODs", &selectLods);
+      ImGui::Checkbox("Depth Prepass", &depthPrepass);
+      ImGui::Checkbox("Indirect Draws", &indirectDraws);
+      ImGui::Checkbox("Occlusion Culling", &occlusionCulling);
+      ImGui::Checkbox("Parallel Recording", &parallelRecording);
+      ImGui::SliderFloat("LOD Pixel Error", &lodPixelError, 0.25f, 16.0f);
+      ImGui::Text("draws per LOD");
+      for (uint32_t draws : stats.lodDraws)
+      {
+        ImGui::SameLine();
+        ImGui::Text("%u", draws);
+      }
+      ImGui::Text("asset %s in %llius, %zu bytes copied", mapAssetFiles ? "mapped" : "copied", stats.assetLoadTime, stats.assetBytesCopied);
+      ImGui::Text("scene %s in %llius", stats.sceneCacheHit ? "cached" : "cooked", stats.sceneLoadTime);
+      if (!stats.sceneCacheHit)
+        ImGui::Text("geometry decoded in %llius on %u threads", stats.geometryDecodeTime, threadPool.size() + 1);
+      if (!stats.sceneCacheHit && stats.compressedViews > 0)
+        ImGui::Text("%u compressed buffer views decoded in %llius", stats.compressedViews, stats.compressedViewDecodeTime);
+      if (stats.sceneCacheHit)
+        ImGui::Text("ACMR %.3f, ATVR %.3f (optimized when cooked)", stats.vertexCacheAfter.acmr(), stats.vertexCacheAfter.atvr());
+      else
+        ImGui::Text("ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", stats.vertexCacheBefore.acmr(), stats.vertexCacheAfter.acmr(), stats.vertexCacheBefore.atvr(), stats.vertexCacheAfter.atvr());
+      ImGui::Text("%zu nodes, %u transforms updated in %llius", sceneGraph.size(), stats.transformsUpdated, stats.transformUpdateTime);
+      ImGui::Text("first frame after %llius", stats.startupTime);
+      ImGui::Text("scene resident after %llius", stats.textureLoadTime);
+      ImGui::Text("%u upload submissions, waited %llius", stats.uploadSubmissions, stats.uploadWaitTime);
+      ImGui::Text("%u memory blocks (%u dedicated), %u allocations", stats.memory.blocks, stats.memory.dedicatedBlocks, stats.memory.allocations);
+      ImGui::Text("%.1f/%.1f MB in use, %.0f%% fragmented", stats.memory.bytesInUse / 1048576.0, stats.memory.bytesReserved / 1048576.0, stats.memory.fragmentation * 100.0f);
       ImGui::Spacing();
       ImGui::SliderFloat("Cam X", &camera.position.x, -3.0f, 3.0f);
       ImGui::SliderFloat("Cam Y", &camera.position.y, -3.0f, 3.0f);
@@ -1353,6 +3766,12 @@ void App::mainLoop()
     drawFrame();
     auto end = std::chrono::system_clock::now();
     stats.frametime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    if (stats.startupTime == 0L)
+    {
+      stats.startupTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+      std::clog << "first frame after " << stats.startupTime << "us" << std::endl;
+    }
   }
   device.waitIdle();
 }
@@ -1374,6 +3793,7 @@ void App::recreateSwapChain()
     createSwapChain();
     createSwapChainImageViews();
     createDepthResources();
+    createDepthPyramidSets();
 }
 
 void App::cleanupSwapChain()
@@ -1387,13 +3807,23 @@ void App::reloadShaders()
     device.waitIdle();
     pipelineLayout = nullptr;
     graphicsPipeline = nullptr;
+    depthPipeline = nullptr;
+    cullPipelineLayout = nullptr;
+    cullPipeline = nullptr;
+    pyramidPipelineLayout = nullptr;
+    pyramidPipeline = nullptr;
     createGraphicsPipeline();
+    createCullPipelines();
 }
 
 void App::drawFrame()
 {
   while (vk::Result::eTimeout == device.waitForFences(*inFlightFences[currentFrame], vk::True, UINT64_MAX))
   { }
+
+  // this frame slot's last submission has finished, so has the one before it
+  retiredCellBuffers[currentFrame].clear();
+  pumpUploads();
   
   auto [result, imageIndex] = swapChain.acquireNextImage(UINT64_MAX, *presentCompleteSemaphores[semaphoreIndex], nullptr);
 
@@ -1410,24 +3840,55 @@ void App::drawFrame()
 
   updateModelViewProjection(currentFrame);
 
+  // whatever the upload queue has finished is acquired by this frame and drawable from it on
+  const uint64_t uploadsCompleted = uploadBatch->completedValue();
+  const bool acquireUploads = uploadsCompleted > uploadsAcquired;
+  uploadsAcquired = uploadsCompleted;
+  bindResidentTextures();
+  streamCells();
+
+  // this frame slot's last culling counts have landed, and are cleared for the next
+  auto* cullStats = static_cast<CullStats*>(cullStatsBuffersMapped[currentFrame]);
+  stats.cull = *cullStats;
+  *cullStats = {};
+
   device.resetFences(*inFlightFences[currentFrame]);
   commandBuffers[currentFrame].reset();
 
-  recordCommandBuffer(imageIndex);
+  auto recordStart = std::chrono::steady_clock::now();
+  recordCommandBuffer(imageIndex, acquireUploads);
+  stats.meshDrawTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - recordStart).count();
+
+  std::array waitSemaphoreInfos = {
+    vk::SemaphoreSubmitInfo{
+      .semaphore = *presentCompleteSemaphores[semaphoreIndex],
+      .stageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput
+    },
+    // already signalled, it orders the release on the upload queue before this frame's acquire
+    vk::SemaphoreSubmitInfo{
+      .semaphore = *uploadBatch->getSemaphore(),
+      .value = uploadsAcquired,
+      .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+    }
+  };
+
+  vk::CommandBufferSubmitInfo commandBufferInfo { .commandBuffer = *commandBuffers[currentFrame] };
 
-  vk::PipelineStageFlags waitDestinationStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput);
+  vk::SemaphoreSubmitInfo signalSemaphoreInfo {
+    .semaphore = *renderFinishedSemaphores[imageIndex],
+    .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+  };
   
-  const vk::SubmitInfo submitInfo {
-    .waitSemaphoreCount = 1,
-    .pWaitSemaphores = &*presentCompleteSemaphores[semaphoreIndex],
-    .pWaitDstStageMask = &waitDestinationStageMask,
-    .commandBufferCount = 1,
-    .pCommandBuffers = &*commandBuffers[currentFrame],
-    .signalSemaphoreCount = 1,
-    .pSignalSemaphores = &*renderFinishedSemaphores[imageIndex]
+  const vk::SubmitInfo2 submitInfo {
+    .waitSemaphoreInfoCount = acquireUploads ? 2U : 1U,
+    .pWaitSemaphoreInfos = waitSemaphoreInfos.data(),
+    .commandBufferInfoCount = 1,
+    .pCommandBufferInfos = &commandBufferInfo,
+    .signalSemaphoreInfoCount = 1,
+    .pSignalSemaphoreInfos = &signalSemaphoreInfo
   };
 
-  queue.submit(submitInfo, *inFlightFences[currentFrame]);
+  queue.submit2(submitInfo, *inFlightFences[currentFrame]);
 
   const vk::PresentInfoKHR presentInfo {
     .waitSemaphoreCount = 1,
@@ -1452,6 +3913,42 @@ void App::drawFrame()
   currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
+glm::mat4 App::instanceTransform(const BatchInstance& instance) const
+{
+  // the node's world matrix, after moving the primitive out to its placement
+  glm::mat4 transform = sceneGraph.worlds()[instance.node];
+  transform[3] += transform * glm::vec4(instance.placement, 0.0f);
+  return transform;
+}
+
+void App::updateBatchBounds()
+{
+  if (batchCuller.size() != drawBatches.size()) batchCuller.resize(drawBatches.size());
+
+  // the primitive's bounds as a centre and half extent, carried into world space by each instance's transform,
+  // where the half extent along each world axis is the sum of the absolute transformed local half extents
+  for (uint32_t b = 0; b < drawBatches.size(); b++)
+  {
+    const DrawBatch& batch = drawBatches[b];
+    const PrimData& p = prims[batch.prim];
+    const glm::vec3 centre = p.boundsMin + 0.5f * p.boundsExtent;
+    const glm::vec3 halfExtent = 0.5f * p.boundsExtent;
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (const BatchInstance& instance : std::span(batchInstances).subspan(batch.firstInstance, batch.instanceCount))
+    {
+      const glm::mat4 transform = instanceTransform(instance);
+      const glm::vec3 worldCentre = glm::vec3(transform * glm::vec4(centre, 1.0f));
+      const glm::vec3 worldHalfExtent = glm::abs(glm::vec3(transform[0])) * halfExtent.x +
+                                        glm::abs(glm::vec3(transform[1])) * halfExtent.y +
+                                        glm::abs(glm::vec3(transform[2])) * halfExtent.z;
+      boundsMin = glm::min(boundsMin, worldCentre - worldHalfExtent);
+      boundsMax = glm::max(boundsMax, worldCentre + worldHalfExtent);
+    }
+    batchCuller.setBounds(b, boundsMin, boundsMax);
+  }
+}
+
 void App::updateModelViewProjection(uint32_t imageIndex)
 {
   MVP mvp{};
@@ -1465,13 +3962,50 @@ void App::updateModelViewProjection(uint32_t imageIndex)
   mvp.proj[1][1] *= -1;
   mvp.model = glm::rotate(camera.getRotationMatrix(), 0.0f, glm::vec3(0.0f, 0.0f, 1.0f));
 
+  // frustum planes of the whole transform (Gribb and Hartmann) land in world space, depth is zero to one
+  const glm::mat4 clip = mvp.proj * mvp.view * mvp.model;
+  auto row = [&](int i) { return glm::vec4(clip[0][i], clip[1][i], clip[2][i], clip[3][i]); };
+  frustumPlanes = { row(3) + row(0), row(3) - row(0), row(3) + row(1), row(3) - row(1), row(2), row(3) - row(2) };
+  for (auto& plane : frustumPlanes)
+  {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  // Camera::position carried into the same space, the model matrix only rotates so distances are kept
+  cullCameraPosition = glm::vec3(glm::inverse(mvp.view * mvp.model) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+  lodPixelScale = std::abs(mvp.proj[1][1]) * 0.5f * static_cast<float>(swapChainExtent.height);
+
   memcpy(uniformBuffersMapped[imageIndex], &mvp, sizeof(mvp));
+
+  // only dirty subtrees are recomputed, and a frame's copy is only rewritten when the graph moved since
+  auto start = std::chrono::steady_clock::now();
+  stats.transformsUpdated = sceneGraph.update();
+  if (transformGenerations[imageIndex] != sceneGraph.generation())
+  {
+    auto* transforms = static_cast<glm::mat4*>(transformBuffersMapped[imageIndex]);
+    for (size_t i = 0; i < batchInstances.size(); i++)
+    {
+      transforms[i] = instanceTransform(batchInstances[i]);
+    }
+    transformGenerations[imageIndex] = sceneGraph.generation();
+  }
+  if (batchBoundsGeneration != sceneGraph.generation())
+  {
+    updateBatchBounds();
+    batchBoundsGeneration = sceneGraph.generation();
+  }
+  auto end = std::chrono::steady_clock::now();
+  stats.transformUpdateTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
 }
 
-void App::recordCommandBuffer(uint32_t imageIndex)
+void App::recordCommandBuffer(uint32_t imageIndex, bool acquireUploads)
 {
   commandBuffers[currentFrame].begin({});
 
+  if (acquireUploads)
+  {
+    uploadBatch->recordAcquires(commandBuffers[currentFrame], uploadsAcquired);
+  }
+
   transitionImageLayout(
     imageIndex,
     vk::ImageLayout::eUndefined,
@@ -1482,9 +4016,37 @@ void App::recordCommandBuffer(uint32_t imageIndex)
     vk::PipelineStageFlagBits2::eColorAttachmentOutput
   );
 
+  stats.meshletsVisible = 0U;
+  stats.meshletsTotal = 0U;
+  stats.trisDrawn = 0U;
+  stats.lodDraws = {};
+  stats.indirectCommands = 0U;
+  stats.drawcalls = 0U;
+  stats.batchesVisible = 0U;
+  stats.batchesTotal = 0U;
+  stats.frustumCullTime = 0L;
+  cellDraws.clear();
+  if (!indirectDraws) collectDraws();
+
+  // the draws phase 0 of culling keeps go first, then the ones phase 1 finds no longer occluded, see recordCullPhase
+  const bool culled = indirectDraws && occlusionCulling && !drawBatches.empty() &&
+                      drawBuffersUploadValue <= uploadsAcquired && materialUploadValue <= uploadsAcquired;
+  if (culled)
+  {
+    recordCullPhase(0);
+    stats.trisDrawn = stats.cull.trianglesDrawn;
+    stats.lodDraws = stats.cull.lodDraws;
+  }
+  else
+  {
+    // a pyramid left over from an earlier culled frame no longer matches the camera or the scene
+    depthPyramidValid = false;
+  }
+
+  // the depth buffer is shared by the frames in flight, the last one's tests are done before it is cleared
   vk::ImageMemoryBarrier2 depthBarrier {
-    .srcStageMask = vk::PipelineStageFlagBits2::eTopOfPipe,
-    .srcAccessMask = {},
+    .srcStageMask = vk::PipelineStageFlagBits2::eLateFragmentTests,
+    .srcAccessMask = vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
     .dstStageMask = vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
     .dstAccessMask = vk::AccessFlagBits2::eDepthStencilAttachmentRead | vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
     .oldLayout = vk::ImageLayout::eUndefined,
@@ -1518,11 +4080,12 @@ void App::recordCommandBuffer(uint32_t imageIndex)
     .clearValue = clearColour,
   };
 
+  // the depth pyramid is built from the first rendering's depth, which the second goes on from
   vk::RenderingAttachmentInfo depthAttachmentInfo {
     .imageView = depthImageView,
     .imageLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal,
     .loadOp = vk::AttachmentLoadOp::eClear,
-    .storeOp = vk::AttachmentStoreOp::eDontCare,
+    .storeOp = culled ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare,
     .clearValue = clearDepth,
   };
   
@@ -1536,37 +4099,111 @@ void App::recordCommandBuffer(uint32_t imageIndex)
     .pColorAttachments = &colourAttachmentInfo,
     .pDepthAttachment = &depthAttachmentInfo
   };
+
+  // a rendering that executes secondaries takes no other commands, so imgui goes in one of its own too
+  // culled needs indirectDraws, so it never comes with them
+  const bool secondaries = parallelRecording && !indirectDraws;
+  if (secondaries) renderingInfo.flags = vk::RenderingFlagBits::eContentsSecondaryCommandBuffers;
+  vk::CommandBufferInheritanceRenderingInfo inheritanceRenderingInfo {
+    .colorAttachmentCount = 1,
+    .pColorAttachmentFormats = &swapChainSurfaceFormat,
+    .depthAttachmentFormat = depthImageFormat,
+    .rasterizationSamples = msaaSamples
+  };
+  vk::CommandBufferInheritanceInfo inheritanceInfo { .pNext = &inheritanceRenderingInfo };
   
   commandBuffers[currentFrame].beginRendering(renderingInfo);
-  
-  commandBuffers[currentFrame].bindPipeline(
-    vk::PipelineBindPoint::eGraphics,
-    *graphicsPipeline
-  );
 
-  commandBuffers[currentFrame].setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(swapChainExtent.width), static_cast<float>(swapChainExtent.height), 0.0f, 1.0f));
-  commandBuffers[currentFrame].setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), swapChainExtent));
-  
-  commandBuffers[currentFrame].bindVertexBuffers(0, *vertexBuffer, {0});
-  
-  for (auto& p : prims)
+  auto recordPasses = [&](uint32_t phase)
   {
-    commandBuffers[currentFrame].bindIndexBuffer(*p.indexBuffer, 0, vk::IndexType::eUint32);
-    commandBuffers[currentFrame].bindDescriptorSets(
-      vk::PipelineBindPoint::eGraphics,
-      pipelineLayout,
-      0,
-      *p.descriptorSets[currentFrame],
-      nullptr
-    );
-    commandBuffers[currentFrame].drawIndexed(
-      static_cast<uint32_t>(p.indices.size()),
-      1, 0, 0, 0
-    );
+    if (secondaries)
+    {
+      recordDrawsParallel(inheritanceInfo);
+      return;
+    }
+
+    commandBuffers[currentFrame].setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(swapChainExtent.width), static_cast<float>(swapChainExtent.height), 0.0f, 1.0f));
+    commandBuffers[currentFrame].setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), swapChainExtent));
+
+    // one set for the whole frame, both pipelines share its layout
+    commandBuffers[currentFrame].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, *descriptorSets[currentFrame], nullptr);
+    for (bool positionsOnly : {true, false})
+    {
+      if (positionsOnly && !depthPrepass) continue;
+      commandBuffers[currentFrame].bindPipeline(vk::PipelineBindPoint::eGraphics, positionsOnly ? *depthPipeline : *graphicsPipeline);
+      if (indirectDraws)
+      {
+        recordIndirectDraws(positionsOnly, culled, phase);
+      }
+      else
+      {
+        recordDraws(commandBuffers[currentFrame], cellDraws, positionsOnly);
+        stats.drawcalls += static_cast<uint32_t>(cellDraws.size());
+      }
+    }
+  };
+  recordPasses(0);
+
+  if (culled)
+  {
+    commandBuffers[currentFrame].endRendering();
+
+    // the first rendering's depth is read by the pyramid build
+    depthBarrier.srcStageMask = vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests;
+    depthBarrier.srcAccessMask = vk::AccessFlagBits2::eDepthStencilAttachmentWrite;
+    depthBarrier.dstStageMask = vk::PipelineStageFlagBits2::eComputeShader;
+    depthBarrier.dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead;
+    depthBarrier.oldLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+    depthBarrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    commandBuffers[currentFrame].pipelineBarrier2(depthDependencyInfo);
+
+    buildDepthPyramid();
+    recordCullPhase(1);
+
+    // the second rendering goes on from the first's colour and depth
+    depthBarrier.srcStageMask = vk::PipelineStageFlagBits2::eComputeShader;
+    depthBarrier.srcAccessMask = {};
+    depthBarrier.dstStageMask = vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests;
+    depthBarrier.dstAccessMask = vk::AccessFlagBits2::eDepthStencilAttachmentRead | vk::AccessFlagBits2::eDepthStencilAttachmentWrite;
+    depthBarrier.oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    depthBarrier.newLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+    vk::MemoryBarrier2 colourBarrier {
+      .srcStageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+      .srcAccessMask = vk::AccessFlagBits2::eColorAttachmentWrite,
+      .dstStageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+      .dstAccessMask = vk::AccessFlagBits2::eColorAttachmentRead | vk::AccessFlagBits2::eColorAttachmentWrite
+    };
+    vk::DependencyInfo secondRenderingDependencyInfo {
+      .dependencyFlags = {},
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers = &colourBarrier,
+      .imageMemoryBarrierCount = 1,
+      .pImageMemoryBarriers = &depthBarrier
+    };
+    commandBuffers[currentFrame].pipelineBarrier2(secondRenderingDependencyInfo);
+
+    colourAttachmentInfo.loadOp = vk::AttachmentLoadOp::eLoad;
+    depthAttachmentInfo.loadOp = vk::AttachmentLoadOp::eLoad;
+    depthAttachmentInfo.storeOp = vk::AttachmentStoreOp::eDontCare;
+    commandBuffers[currentFrame].beginRendering(renderingInfo);
+    recordPasses(1);
   }
 
-  
-  ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), static_cast<VkCommandBuffer>(*commandBuffers[currentFrame]));
+  if (secondaries)
+  {
+    vk::raii::CommandBuffer& imguiCommandBuffer = imguiCommandBuffers[currentFrame];
+    imguiCommandBuffer.begin({
+      .flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+      .pInheritanceInfo = &inheritanceInfo
+    });
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), static_cast<VkCommandBuffer>(*imguiCommandBuffer));
+    imguiCommandBuffer.end();
+    commandBuffers[currentFrame].executeCommands(*imguiCommandBuffer);
+  }
+  else
+  {
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), static_cast<VkCommandBuffer>(*commandBuffers[currentFrame]));
+  }
 
   commandBuffers[currentFrame].endRendering();
   
@@ -1583,6 +4220,397 @@ void App::recordCommandBuffer(uint32_t imageIndex)
   commandBuffers[currentFrame].end();
 }
 
+void App::collectDraws()
+{
+  // every draw reads its draw data, none can go before it has landed
+  if (drawBuffersUploadValue > uploadsAcquired) return;
+
+  // whole batches outside the frustum are dropped up front, eight bounds at a time
+  auto cullStart = std::chrono::steady_clock::now();
+  batchCuller.cull(frustumPlanes, visibleBatches);
+  stats.frustumCullTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - cullStart).count();
+  stats.batchesVisible = static_cast<uint32_t>(visibleBatches.size());
+  stats.batchesTotal = static_cast<uint32_t>(drawBatches.size());
+
+  // prims are skipped until their cell and their texture have been uploaded
+  for (uint32_t b : visibleBatches)
+  {
+    const DrawBatch& batch = drawBatches[b];
+    const PrimData& p = prims[batch.prim];
+    if (!textureBound[materials[p.materialIndex].baseColorTexture][currentFrame] || !cellStreamer.resident(p.cell)) continue;
+    const GeometryCell& cell = cells[p.cell];
+
+    // culling and level selection run in the primitive's own space, where its bounds and errors were measured
+    instanceViews.resize(batch.instanceCount);
+    for (uint32_t i = 0; i < batch.instanceCount; i++)
+    {
+      const glm::mat4 transform = instanceTransform(batchInstances[batch.firstInstance + i]);
+      InstanceView& view = instanceViews[i];
+      for (size_t plane = 0; plane < view.planes.size(); plane++)
+      {
+        view.planes[plane] = frustumPlanes[plane] * transform;
+        view.planes[plane] /= glm::length(glm::vec3(view.planes[plane]));
+      }
+      view.viewer = glm::vec3(glm::inverse(transform) * glm::vec4(cullCameraPosition, 1.0f));
+    }
+
+    // the coarsest level whose error, seen from the camera at the nearest the bounds allow, is at most lodPixelError pixels
+    // for the nearest instance, the others are drawn at least as finely as they need
+    uint32_t lod = 0U;
+    if (selectLods && p.lodCount > 0)
+    {
+      const glm::vec3 centre = p.boundsMin + 0.5f * p.boundsExtent;
+      lod = p.lodCount;
+      for (const InstanceView& view : instanceViews)
+      {
+        const float distance = glm::length(centre - view.viewer) - 0.5f * glm::length(p.boundsExtent);
+        uint32_t level = lod;
+        while (level > 0 && (distance <= 0.0f || p.lods[level - 1].error * lodPixelScale > lodPixelError * distance))
+        {
+          level--;
+        }
+        lod = level;
+        if (lod == 0U) break;
+      }
+    }
+    stats.lodDraws[lod] += batch.instanceCount;
+    const uint32_t lodFirstIndex = lod == 0U ? p.firstIndex : p.lods[lod - 1].firstIndex;
+    const uint32_t lodIndexCount = lod == 0U ? p.indexCount : p.lods[lod - 1].indexCount;
+
+    const bool wideIndices = lodFirstIndex >= shortIndexCount;
+    // the cell's buffer holds its own ranges only
+    const uint32_t firstIndex = lodFirstIndex - (wideIndices ? cell.firstWideIndex : cell.firstShortIndex);
+    const int32_t vertexOffset = p.vertexOffset - static_cast<int32_t>(cell.firstVertex);
+    if (!cullMeshlets || p.meshletCount == 0 || lod > 0U)
+    {
+      cellDraws.push_back({ b, lodIndexCount, batch.instanceCount, firstIndex, vertexOffset, batch.firstInstance, wideIndices });
+      stats.trisDrawn += lodIndexCount / 3 * batch.instanceCount;
+      continue;
+    }
+
+    // meshlets are consecutive in the index buffer, so each run of survivors is one draw
+    // a meshlet survives when any instance would keep it
+    uint32_t runBegin = 0U;
+    uint32_t runCount = 0U;
+    for (const Meshlet& meshlet : std::span(meshlets).subspan(p.firstMeshlet, p.meshletCount))
+    {
+      stats.meshletsTotal++;
+      const glm::vec3 centre = glm::vec3(meshlet.sphere);
+      const bool visible = std::ranges::any_of(instanceViews, [&](const InstanceView& view)
+      {
+        const bool inFrustum = std::ranges::all_of(view.planes, [&](const glm::vec4& plane)
+        {
+          return glm::dot(glm::vec3(plane), centre) + plane.w >= -meshlet.sphere.w;
+        });
+        const bool backFacing = glm::dot(glm::normalize(meshlet.coneApex - view.viewer), meshlet.coneAxis) >= meshlet.coneCutoff;
+        return inFrustum && !backFacing;
+      });
+      if (visible)
+      {
+        stats.meshletsVisible++;
+        if (runCount == 0U) runBegin = meshlet.indexOffset;
+        runCount += meshlet.indexCount;
+        continue;
+      }
+      if (runCount > 0U)
+      {
+        cellDraws.push_back({ b, runCount, batch.instanceCount, firstIndex + runBegin, vertexOffset, batch.firstInstance, wideIndices });
+        stats.trisDrawn += runCount / 3 * batch.instanceCount;
+        runCount = 0U;
+      }
+    }
+    if (runCount > 0U)
+    {
+      cellDraws.push_back({ b, runCount, batch.instanceCount, firstIndex + runBegin, vertexOffset, batch.firstInstance, wideIndices });
+      stats.trisDrawn += runCount / 3 * batch.instanceCount;
+    }
+  }
+}
+
+void App::bindCellStreams(vk::raii::CommandBuffer& commandBuffer, const GeometryCell& cell, bool positionsOnly)
+{
+  // a cell's streams and index ranges share its buffer
+  const uint32_t streamCount = positionsOnly ? 1U : Vertex::STREAM_COUNT;
+  std::array<vk::Buffer, Vertex::STREAM_COUNT> streamBuffers;
+  std::array<vk::DeviceSize, Vertex::STREAM_COUNT> streamOffsets;
+  for (uint32_t stream = 0; stream < streamCount; stream++)
+  {
+    streamBuffers[stream] = *cell.buffer;
+    streamOffsets[stream] = cell.streamOffset(stream);
+  }
+  commandBuffer.bindVertexBuffers(
+    0,
+    vk::ArrayProxy<const vk::Buffer>(streamCount, streamBuffers.data()),
+    vk::ArrayProxy<const vk::DeviceSize>(streamCount, streamOffsets.data())
+  );
+}
+
+void App::bindCellIndices(vk::raii::CommandBuffer& commandBuffer, const GeometryCell& cell, bool wideIndices)
+{
+  if (wideIndices)
+    commandBuffer.bindIndexBuffer(*cell.buffer, cell.wideIndexOffset(), vk::IndexType::eUint32);
+  else
+    commandBuffer.bindIndexBuffer(*cell.buffer, cell.indexOffset(), vk::IndexType::eUint16);
+}
+
+// reads only what collectDraws left, so chunks of the draws can be recorded on several threads at once
+void App::recordDraws(vk::raii::CommandBuffer& commandBuffer, std::span<const CellDraw> draws, bool positionsOnly)
+{
+  // the index buffer is rebound only when a draw's range is in the other half of the cell's
+  std::optional<uint32_t> cellBound;
+  std::optional<bool> wideIndicesBound;
+  std::optional<uint32_t> batchBound;
+  for (const CellDraw& draw : draws)
+  {
+    const PrimData& p = prims[drawBatches[draw.batch].prim];
+    const GeometryCell& cell = cells[p.cell];
+    if (cellBound != p.cell)
+    {
+      bindCellStreams(commandBuffer, cell, positionsOnly);
+      cellBound = p.cell;
+      wideIndicesBound.reset();
+    }
+    if (wideIndicesBound != draw.wideIndices)
+    {
+      bindCellIndices(commandBuffer, cell, draw.wideIndices);
+      wideIndicesBound = draw.wideIndices;
+    }
+
+    // one draw per call, so its draw index is 0 and the batch's draw data is picked here
+    if (batchBound != draw.batch)
+    {
+      const DrawConstants drawConstants { .firstDraw = draw.batch, .culled = 0U };
+      commandBuffer.pushConstants<DrawConstants>(*pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, drawConstants);
+      batchBound = draw.batch;
+    }
+    commandBuffer.drawIndexed(draw.indexCount, draw.instanceCount, draw.firstIndex, draw.vertexOffset, draw.firstInstance);
+  }
+}
+
+void App::recordDrawsParallel(const vk::CommandBufferInheritanceInfo& inheritanceInfo)
+{
+  // this frame's fence was waited on, nothing of its pools is still in use
+  for (uint32_t slot = 0; slot < recordingSlots; slot++)
+  {
+    secondaryCommandPools[currentFrame * recordingSlots + slot].reset();
+  }
+
+  // at most a chunk per recording thread, the chunk's index picks its slot so no pool is recorded from by two threads
+  // each pass of a chunk gets a secondary of its own, every depth draw has to land before the first shaded one
+  const uint32_t drawCount = static_cast<uint32_t>(cellDraws.size());
+  if (drawCount == 0U) return;
+  const uint32_t grainSize = std::max((drawCount + recordingSlots - 1) / recordingSlots, MIN_DRAWS_PER_SECONDARY);
+  const uint32_t chunkCount = (drawCount + grainSize - 1) / grainSize;
+  threadPool.parallelFor(drawCount, grainSize, [&](size_t begin, size_t end)
+  {
+    const size_t slot = currentFrame * recordingSlots + begin / grainSize;
+    for (uint32_t pass = 0; pass < 2; pass++)
+    {
+      const bool positionsOnly = pass == 0;
+      if (positionsOnly && !depthPrepass) continue;
+
+      // nothing is inherited from the primary but the rendering's formats
+      vk::raii::CommandBuffer& commandBuffer = secondaryCommandBuffers[slot * 2 + pass];
+      commandBuffer.begin({
+        .flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+        .pInheritanceInfo = &inheritanceInfo
+      });
+      commandBuffer.setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(swapChainExtent.width), static_cast<float>(swapChainExtent.height), 0.0f, 1.0f));
+      commandBuffer.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), swapChainExtent));
+      commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, *descriptorSets[currentFrame], nullptr);
+      commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, positionsOnly ? *depthPipeline : *graphicsPipeline);
+      recordDraws(commandBuffer, std::span(cellDraws).subspan(begin, end - begin), positionsOnly);
+      commandBuffer.end();
+    }
+  });
+
+  std::vector<vk::CommandBuffer> recorded;
+  for (uint32_t pass = 0; pass < 2; pass++)
+  {
+    if (pass == 0 && !depthPrepass) continue;
+    for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+    {
+      recorded.push_back(*secondaryCommandBuffers[(currentFrame * recordingSlots + chunk) * 2 + pass]);
+    }
+    stats.drawcalls += drawCount;
+  }
+  commandBuffers[currentFrame].executeCommands(recorded);
+}
+
+bool App::groupDrawable(DrawGroup& group)
+{
+  if (!cellStreamer.resident(group.cell)) return false;
+  if (!group.texturesReady)
+  {
+    group.texturesReady = std::ranges::all_of(std::span(drawBatches).subspan(group.firstDraw, group.drawCount), [&](const DrawBatch& batch)
+    {
+      return textureBound[materials[prims[batch.prim].materialIndex].baseColorTexture][currentFrame];
+    });
+  }
+  return group.texturesReady;
+}
+
+void App::recordIndirectDraws(bool positionsOnly, bool culled, uint32_t phase)
+{
+  // the commands were built at load, the cpu only skips the groups that cannot be drawn yet
+  if (drawBuffersUploadValue > uploadsAcquired || materialUploadValue > uploadsAcquired) return;
+
+  // a culled phase's commands and counts are the half of the culled buffers it wrote, see cull.slang
+  const uint32_t drawCount = static_cast<uint32_t>(drawBatches.size());
+  const vk::Buffer commandBuffer = culled ? *culledCommandBuffer : *drawCommandBuffer;
+  const vk::Buffer countBuffer = culled ? *culledCountBuffer : *drawCountBuffer;
+  const uint32_t firstCommand = culled ? phase * drawCount : 0U;
+  const uint32_t firstCount = culled ? phase * static_cast<uint32_t>(drawGroups.size()) : 0U;
+
+  std::optional<uint32_t> cellBound;
+  for (uint32_t g = 0; g < drawGroups.size(); g++)
+  {
+    DrawGroup& group = drawGroups[g];
+    if (!groupDrawable(group)) continue;
+
+    const GeometryCell& cell = cells[group.cell];
+    if (cellBound != group.cell)
+    {
+      bindCellStreams(commandBuffers[currentFrame], cell, positionsOnly);
+      cellBound = group.cell;
+    }
+    bindCellIndices(commandBuffers[currentFrame], cell, group.wideIndices);
+
+    const DrawConstants drawConstants { .firstDraw = firstCommand + group.firstDraw, .culled = culled ? 1U : 0U };
+    commandBuffers[currentFrame].pushConstants<DrawConstants>(*pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, drawConstants);
+    commandBuffers[currentFrame].drawIndexedIndirectCount(
+      commandBuffer,
+      (firstCommand + group.firstDraw) * sizeof(vk::DrawIndexedIndirectCommand),
+      countBuffer,
+      (firstCount + g) * sizeof(uint32_t),
+      group.drawCount,
+      sizeof(vk::DrawIndexedIndirectCommand)
+    );
+    stats.drawcalls++;
+    stats.indirectCommands += group.drawCount;
+    // culled triangles are counted on the device
+    if (!positionsOnly && !culled) stats.trisDrawn += group.triangleCount;
+  }
+}
+
+// Two-phase occlusion culling, each phase a dispatch of cull.slang over every draw batch
+// Phase 0 runs before any drawing and tests against the depth pyramid left by the previous frame, seen from this
+// frame's camera, which may wrongly hide what the camera has just turned or moved towards
+// Phase 1 runs between the two renderings and tests only what phase 0 found occluded, against the pyramid of the
+// depth phase 0's draws laid down, so what was wrongly hidden is drawn in the same frame
+// That pyramid is kept for the next frame, it lacks what phase 1 drew so it can only hide less than a full one
+void App::recordCullPhase(uint32_t phase)
+{
+  vk::raii::CommandBuffer& commandBuffer = commandBuffers[currentFrame];
+  if (phase == 0)
+  {
+    // the groups the cpu would skip are skipped on the device too
+    auto* cullGroups = static_cast<CullGroup*>(cullGroupBuffersMapped[currentFrame]);
+    for (uint32_t g = 0; g < drawGroups.size(); g++)
+    {
+      cullGroups[g] = { .firstDraw = drawGroups[g].firstDraw, .drawable = groupDrawable(drawGroups[g]) ? 1U : 0U };
+    }
+
+    // the previous frame is done drawing from the culled buffers and building the pyramid before they are rewritten and read
+    vk::MemoryBarrier2 previousFrameBarrier {
+      .srcStageMask = vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eVertexShader | vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+      .dstStageMask = vk::PipelineStageFlagBits2::eTransfer | vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite | vk::AccessFlagBits2::eShaderSampledRead
+    };
+    // a pyramid from before the depth buffer was recreated holds nothing worth keeping
+    vk::ImageMemoryBarrier2 pyramidBarrier {
+      .srcStageMask = vk::PipelineStageFlagBits2::eTopOfPipe,
+      .srcAccessMask = {},
+      .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead | vk::AccessFlagBits2::eShaderStorageWrite,
+      .oldLayout = vk::ImageLayout::eUndefined,
+      .newLayout = vk::ImageLayout::eGeneral,
+      .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+      .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+      .image = depthPyramid,
+      .subresourceRange = {
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .baseMipLevel = 0,
+        .levelCount = depthPyramidLevels,
+        .baseArrayLayer = 0,
+        .layerCount = 1
+      }
+    };
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo {
+      .dependencyFlags = {},
+      .memoryBarrierCount = 1,
+      .pMemoryBarriers = &previousFrameBarrier,
+      .imageMemoryBarrierCount = depthPyramidValid ? 0U : 1U,
+      .pImageMemoryBarriers = &pyramidBarrier
+    });
+
+    commandBuffer.fillBuffer(*culledCountBuffer, 0, vk::WholeSize, 0U);
+    vk::MemoryBarrier2 clearBarrier {
+      .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+      .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+      .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite
+    };
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo { .memoryBarrierCount = 1, .pMemoryBarriers = &clearBarrier });
+  }
+
+  const CullConstants cullConstants {
+    .phase = phase,
+    .drawCount = static_cast<uint32_t>(drawBatches.size()),
+    .groupCount = static_cast<uint32_t>(drawGroups.size()),
+    // phase 1 always has the pyramid buildDepthPyramid just made
+    .occlusion = phase == 1 || depthPyramidValid ? 1U : 0U,
+    .viewportSize = glm::vec2(static_cast<float>(swapChainExtent.width), static_cast<float>(swapChainExtent.height)),
+    .pyramidLevels = depthPyramidLevels,
+    .selectLods = selectLods ? 1U : 0U,
+    .cameraPosition = cullCameraPosition,
+    .lodPixelScale = lodPixelScale,
+    .lodPixelError = lodPixelError
+  };
+  commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *cullPipeline);
+  commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *cullPipelineLayout, 0, *cullDescriptorSets[currentFrame], nullptr);
+  commandBuffer.pushConstants<CullConstants>(*cullPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, cullConstants);
+  commandBuffer.dispatch((cullConstants.drawCount + 63U) / 64U, 1, 1);
+
+  // the commands are drawn, phase 0's occluded batches are read by phase 1, the last counts go back to the cpu
+  vk::MemoryBarrier2 culledBarrier {
+    .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+    .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+    .dstStageMask = vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eVertexShader | vk::PipelineStageFlagBits2::eComputeShader |
+                    (phase == 1 ? vk::PipelineStageFlagBits2::eHost : vk::PipelineStageFlagBits2::eNone),
+    .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead | vk::AccessFlagBits2::eShaderStorageRead |
+                     (phase == 1 ? vk::AccessFlagBits2::eHostRead : vk::AccessFlagBits2::eNone)
+  };
+  commandBuffer.pipelineBarrier2(vk::DependencyInfo { .memoryBarrierCount = 1, .pMemoryBarriers = &culledBarrier });
+}
+
+void App::buildDepthPyramid()
+{
+  // each level reads the one before it, level 0 reads the depth buffer
+  vk::raii::CommandBuffer& commandBuffer = commandBuffers[currentFrame];
+  commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *pyramidPipeline);
+  glm::uvec2 sourceSize(swapChainExtent.width, swapChainExtent.height);
+  for (uint32_t level = 0; level < depthPyramidLevels; level++)
+  {
+    const glm::uvec2 size = level == 0 ? sourceSize : glm::max(sourceSize / 2U, glm::uvec2(1U));
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pyramidPipelineLayout, 0, *depthPyramidSets[level], nullptr);
+    commandBuffer.pushConstants<PyramidConstants>(*pyramidPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, PyramidConstants { .sourceSize = sourceSize, .size = size });
+    commandBuffer.dispatch((size.x + 7U) / 8U, (size.y + 7U) / 8U, 1);
+
+    // the pyramid is in the general layout throughout, so a memory barrier orders each level before the next reads it
+    vk::MemoryBarrier2 levelBarrier {
+      .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+      .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead
+    };
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo { .memoryBarrierCount = 1, .pMemoryBarriers = &levelBarrier });
+    sourceSize = size;
+  }
+  depthPyramidValid = true;
+}
+
 void App::transitionImageLayout(
   uint32_t imageIndex,
   vk::ImageLayout oldLayout,
@@ -1627,13 +4655,17 @@ void App::cleanup()
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
 
-  for (auto& p : prims)
+  // decodes still running write into decodedTextures, let them land before anything is torn down
+  threadPool.wait();
+  for (auto& texture : decodedTextures)
   {
-    p.indexBuffer = nullptr;
-    p.indexBufferMemory = nullptr;
-
-    p.descriptorSets.clear();
+    if (texture.kTexture != nullptr) ktxTexture2_Destroy(texture.kTexture);
   }
+  decodedTextures.clear();
+
+  descriptorSets.clear();
+  cullDescriptorSets.clear();
+  depthPyramidSets.clear();
 
   queue = nullptr;
 
@@ -1644,26 +4676,67 @@ void App::cleanup()
   swapChainImageViews.clear();
 
   descriptorSetLayout = nullptr;
+  cullSetLayout = nullptr;
+  pyramidSetLayout = nullptr;
 
   pipelineLayout = nullptr;
   graphicsPipeline = nullptr;
+  depthPipeline = nullptr;
+  cullPipelineLayout = nullptr;
+  cullPipeline = nullptr;
+  pyramidPipelineLayout = nullptr;
+  pyramidPipeline = nullptr;
   
+  imguiCommandBuffers.clear();
+  secondaryCommandBuffers.clear();
+  secondaryCommandPools.clear();
   commandBuffers.clear();
+  uploadBatch.reset();
+  transferQueue = nullptr;
   commandPool = nullptr;
   textureImageViews.clear();
   textureImagesMemory.clear();
   textureImages.clear();
   textureSampler = nullptr;
+  materialBuffer = nullptr;
+  materialBufferMemory = nullptr;
+  drawCommandBuffer = nullptr;
+  drawCommandBufferMemory = nullptr;
+  drawCountBuffer = nullptr;
+  drawCountBufferMemory = nullptr;
+  drawDataBuffer = nullptr;
+  drawDataBufferMemory = nullptr;
+  culledCommandBuffer = nullptr;
+  culledCommandBufferMemory = nullptr;
+  culledDrawIdBuffer = nullptr;
+  culledDrawIdBufferMemory = nullptr;
+  culledCountBuffer = nullptr;
+  culledCountBufferMemory = nullptr;
+  occludedBuffer = nullptr;
+  occludedBufferMemory = nullptr;
 
   depthImage = nullptr;
   depthImageMemory = nullptr;
   depthImageView = nullptr;
+  depthPyramidLevelViews.clear();
+  depthPyramidView = nullptr;
+  depthPyramid = nullptr;
+  depthPyramidMemory = nullptr;
 
-  vertexBuffer = nullptr;
-  vertexBufferMemory = nullptr;
+  cells.clear();
+  for (auto& retired : retiredCellBuffers)
+  {
+    retired.clear();
+  }
 
   uniformBuffers.clear();
   uniformBuffersMemory.clear();
+  transformBuffers.clear();
+  transformBuffersMemory.clear();
+  cullGroupBuffers.clear();
+  cullGroupBuffersMemory.clear();
+  cullStatsBuffers.clear();
+  cullStatsBuffersMemory.clear();
 
   descriptorPool = nullptr;
   imguiDescriptorPool = nullptr;
@@ -1672,6 +4745,9 @@ void App::cleanup()
   renderFinishedSemaphores.clear();
   inFlightFences.clear();
 
+  // every allocation has been handed back by now
+  allocator.reset();
+
   device = nullptr;
   physicalDevice = nullptr;
   debugMessenger = nullptr;
@@ -4,6 +4,12 @@
 #include <vector> // resizable container
 #include <array> // for c++-like syntax of user-type arrays
 #include <filesystem> // for platform-agnostic paths
+#include <chrono> // for startup timing
+#include <deque> // for decoded textures waiting on the uploader
+#include <exception> // for decode errors carried back to the uploader
+#include <mutex> // for guarding the decoded texture queue
+#include <span> // for the cooked geometry cells are read from
+#include <algorithm> // for std::max in GeometryCell
 
 // Windows has different calling conventions, vk_platform defines alternatives
 #include <vulkan/vk_platform.h>
@@ -26,6 +32,7 @@
 #include <glm/ext/matrix_transform.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/hash.hpp>
+#include <glm/gtc/type_precision.hpp> // for the 16-bit vertex attributes
 
 // for declaring fastgltf members
 #include "fastgltf/types.hpp"
@@ -36,12 +43,51 @@
 // for camera member (stores universal uniform buffer)
 #include "camera.hpp"
 
+// for mappedBuffers member (external gltf buffers read straight from the page cache)
+#include "mapped_file.hpp"
+
+// for the cooked scene blob that lets warm starts skip parsing and accessor walking
+#include "scene_cache.hpp"
+
+// for decoding textures (and other load-time work) across cores
+#include "thread_pool.hpp"
+
+// for recording many uploads into one submission
+#include "upload_batch.hpp"
+
+// for sub-allocating buffers and images out of a few large memory blocks
+#include "device_allocator.hpp"
+
+// for reordering indices and vertices at cook time, and the vertex cache stats
+#include "mesh_optimizer.hpp"
+
+// for the node hierarchy and the world matrices of every mesh instance
+#include "scene_graph.hpp"
+
+// for deciding which cells of geometry to keep in host and device memory
+#include "cell_streamer.hpp"
+
+// for testing the world bounds of every draw batch against the frustum on the cpu
+#include "frustum_culler.hpp"
+
 // constexpr allows for explicit typing (vs const)
 constexpr uint32_t WIDTH = 800;
 constexpr uint32_t HEIGHT = 600;
 
 constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
 
+// upper bound on the bindless texture array, lowered to what the device allows
+constexpr uint32_t MAX_BINDLESS_TEXTURES = 4096;
+
+// the depth pyramid's levels, enough for a 32768 pixel wide swapchain
+constexpr uint32_t MAX_DEPTH_PYRAMID_LEVELS = 16;
+
+// fewest draws worth a secondary command buffer of their own, see recordDrawsParallel
+constexpr uint32_t MIN_DRAWS_PER_SECONDARY = 256;
+
+// upload timeline value of a resource that has not been recorded yet
+constexpr uint64_t UPLOAD_PENDING = UINT64_MAX;
+
 // path to gltf, can be defined through compile-line preprocessor
 //#ifndef MODEL_PATH
 //#define MODEL_PATH "../assets/sponza/Sponza.gltf"
@@ -49,6 +95,44 @@ constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
 
 static char model_path[256] = "../assets/sponza/Sponza.gltf";
 
+// memory-map the gltf and its external buffers instead of copying them onto the heap
+static bool mapAssetFiles = true;
+
+// draw only the meshlets of each primitive that are in the frustum and not facing away
+static bool cullMeshlets = true;
+
+// draw each primitive at the coarsest level of detail whose error projects to at most lodPixelError pixels
+static bool selectLods = true;
+static float lodPixelError = 1.0f;
+
+// lay down depth with a position-only pipeline first, so the full pipeline shades each pixel once
+static bool depthPrepass = true;
+
+// draw each resident cell with one drawIndexedIndirectCount per index width, from commands built at load,
+// instead of recording every batch, meshlet culling only applies without it and level selection needs occlusionCulling,
+// whose pass picks each batch's level as it writes the compacted commands
+static bool indirectDraws = true;
+
+// cull the indirect draws on the device first, against the frustum and the depth pyramid of the previous frame,
+// then draw what that rejected as occluded and passes against the pyramid of what it did draw, see recordCullPhase
+static bool occlusionCulling = true;
+
+// record the draws of the cpu path in chunks on the thread pool, into secondary command buffers the rendering executes,
+// the indirect path records a handful of commands per cell and stays in the primary
+static bool parallelRecording = true;
+
+// keep the geometry cells within streamingRadius of the camera, or of where its velocity puts it streamingLookahead
+// seconds from now, resident in at most the budgets of device and host memory, nearest first
+// the radius is well inside the far plane of 1000 so cells out of reach are evicted, Sponza spans about 30 units
+static float streamingRadius = 20.0f;
+static float streamingLookahead = 1.0f;
+static int streamingDeviceBudgetMB = 512;
+static int streamingHostBudgetMB = 256;
+
+// time the welding hash table against std::unordered_map on the loaded vertices when cooking, reported to std::clog,
+// set with --benchmark-welding, which cooks even when the scene is cached
+static bool benchmarkWelding = false;
+
 // path to spv, can be defined through compile-line preprocessor
 //#ifndef SHADER_PATH
 //#define SHADER_PATH "../assets/shaders/shader.spv"
@@ -68,57 +152,180 @@ constexpr bool enableValidationLayers = true;
 #pragma comment(linker, "/SUBSYSTEM:CONSOLE")
 #endif
 
+// counts from both phases of occlusion culling, written by cull.slang
+struct CullStats {
+  uint32_t tested = 0U; // draw batches whose cell and textures are resident
+  uint32_t frustumRejected = 0U;
+  uint32_t phase1Drawn = 0U;
+  uint32_t phase1Occluded = 0U;
+  uint32_t phase2Drawn = 0U; // of the phase 1 occluded, the ones the new depth showed
+  uint32_t trianglesDrawn = 0U;
+  std::array<uint32_t, MAX_LOD_LEVELS> lodDraws{}; // primitives drawn at each level
+};
+
 // stores measurements data
 struct EngineStats {
   long long int frametime = 0L;
   uint32_t tris = 0U;
   uint32_t drawcalls = 0U;
+  // draw batches the cpu draw path found in the frustum, of those there are, and how long finding them took
+  uint32_t batchesVisible = 0U;
+  uint32_t batchesTotal = 0U;
+  long long int frustumCullTime = 0L;
+  uint32_t indirectCommands = 0U; // the most the indirect draw calls can issue
+  // read back from the frame that last used the same frame in flight, so two frames late
+  CullStats cull;
+  uint32_t meshletsVisible = 0U;
+  uint32_t meshletsTotal = 0U;
+  uint32_t trisDrawn = 0U;
+  uint32_t transformsUpdated = 0U;
+  long long int transformUpdateTime = 0L;
+  std::array<uint32_t, MAX_LOD_LEVELS> lodDraws{}; // primitives drawn at each level
   long long int sceneUpdateTime = 0L;
   long long int meshDrawTime = 0L;
+  long long int assetLoadTime = 0L;
+  size_t assetBytesCopied = 0U;
+  bool sceneCacheHit = false;
+  long long int sceneLoadTime = 0L;
+  long long int geometryDecodeTime = 0L;
+  // EXT_meshopt_compression views, only known when the scene was cooked this launch
+  uint32_t compressedViews = 0U;
+  long long int compressedViewDecodeTime = 0L;
+  long long int geometryOptimizeTime = 0L;
+  // as exported, only known when the scene was cooked this launch
+  VertexCacheStats vertexCacheBefore;
+  VertexCacheStats vertexCacheAfter;
+  long long int startupTime = 0L;
+  long long int textureLoadTime = 0L;
+  uint32_t uploadSubmissions = 0U;
+  long long int uploadWaitTime = 0L;
+  uint32_t cellsResident = 0U;
+  uint32_t cellUploads = 0U;
+  uint32_t cellEvictions = 0U;
+  uint64_t cellDeviceBytes = 0U;
+  uint64_t cellHostBytes = 0U;
+  long long int cellStreamTime = 0L;
+  DeviceAllocatorStats memory;
 };
 
+// Compact vertex, 20 bytes instead of the 32 the float layout took
+// Positions are quantized to the primitive's bounds (PrimData::boundsMin/boundsExtent), which the vertex shader undoes
+// Normals and tangents are octahedral encoded, texcoords are half floats
 struct Vertex {
   // Attributes
-  glm::vec3 pos;
-  glm::vec3 colour;
-  glm::vec2 texCoord;
+  // xyz is the position within the bounds, w is the bitangent sign (0 for -1, 65535 for +1)
+  glm::u16vec4 pos = glm::u16vec4(0U, 0U, 0U, UINT16_MAX);
+  glm::i16vec2 normal = glm::i16vec2(0, 0); // +z
+  glm::i16vec2 tangent = glm::i16vec2(INT16_MAX, 0); // +x
+  glm::u16vec2 texCoord = glm::u16vec2(0U, 0U);
+
+  // On the device the attributes are split into streams, each an array of its own, so a pass binds only the ones it reads
+  // Position is stream 0, normal and tangent stream 1, texCoord stream 2
+  static constexpr uint32_t STREAM_COUNT = 3U;
+  static constexpr std::array<vk::DeviceSize, STREAM_COUNT> STREAM_STRIDES = {
+    sizeof(glm::u16vec4),
+    sizeof(glm::i16vec2) * 2U,
+    sizeof(glm::u16vec2)
+  };
 
-  // How the struct is passed
-  static vk::VertexInputBindingDescription getBindingDescription()
+  // How the streams are passed, binding i is stream i
+  static std::array<vk::VertexInputBindingDescription, STREAM_COUNT> getBindingDescriptions()
   {
-    return {0, sizeof(Vertex), vk::VertexInputRate::eVertex};
+    return {
+      vk::VertexInputBindingDescription(0, static_cast<uint32_t>(STREAM_STRIDES[0]), vk::VertexInputRate::eVertex),
+      vk::VertexInputBindingDescription(1, static_cast<uint32_t>(STREAM_STRIDES[1]), vk::VertexInputRate::eVertex),
+      vk::VertexInputBindingDescription(2, static_cast<uint32_t>(STREAM_STRIDES[2]), vk::VertexInputRate::eVertex)
+    };
   }
 
-  // How the struct's data is laid out
-  static std::array<vk::VertexInputAttributeDescription, 3> getAttributeDescriptions()
+  // How each stream's data is laid out, position comes first so depth-only passes can take just the first of each
+  static std::array<vk::VertexInputAttributeDescription, 4> getAttributeDescriptions()
   {
     return {
-      // location, binding, format, offset
-      // Binding is 0, as we decided in getBindingDescription
-      // Formats are aliases for in-shader data types, e.g. R32Sfloat is float, R64Sfloat is double
-      vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, pos)),
-      vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, colour)),
-      vk::VertexInputAttributeDescription(2, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, texCoord))
+      // location, binding, format, offset within the stream
+      // Formats are aliases for in-shader data types, unorm and snorm are read as floats in [0, 1] and [-1, 1]
+      vk::VertexInputAttributeDescription(0, 0, vk::Format::eR16G16B16A16Unorm, 0),
+      vk::VertexInputAttributeDescription(1, 1, vk::Format::eR16G16Snorm, 0),
+      vk::VertexInputAttributeDescription(2, 1, vk::Format::eR16G16Snorm, sizeof(glm::i16vec2)),
+      vk::VertexInputAttributeDescription(3, 2, vk::Format::eR16G16Sfloat, 0)
     };
   }
 
   // equal_to function, needed for use of Vertex as Key in unordered containers e.g. unordered_map(Key, T, hash(Key), equal_to(Key))
   bool operator==(const Vertex& other) const
   {
-    return pos == other.pos && colour == other.colour && texCoord == other.texCoord;
+    return pos == other.pos && normal == other.normal && tangent == other.tangent && texCoord == other.texCoord;
   }
 };
 
 // Hash function, needed for use of Vertex as Key in unordered containers e.g. unordered_map(Key, T, hash(Key), equal_to(Key))
+// The attributes are 20 bytes of integers with no padding, so the bytes are hashed directly and every bit reaches the result
+static_assert(sizeof(Vertex) == 20, "Vertex must stay unpadded to be hashed as bytes");
 template<> struct std::hash<Vertex> {
   size_t operator()(Vertex const& vertex) const noexcept
   {
-    return ((hash<glm::vec3>()(vertex.pos) ^
-            (hash<glm::vec3>()(vertex.colour) << 1 )) >> 1) ^
-            (hash<glm::vec2>()(vertex.texCoord) << 1);
+    return static_cast<size_t>(hashBytes(reinterpret_cast<const std::byte*>(&vertex), sizeof(Vertex)));
   }
 };
 
+// per-call push constants, a draw reads element firstDraw + its draw index within the call of the draw data buffer,
+// or of the culled draw id buffer when culled, which holds the draw data index of each compacted command
+struct DrawConstants {
+  uint32_t firstDraw;
+  uint32_t culled;
+};
+
+// a level of detail of a draw batch for the culling pass, its range local to the cell's buffer like the command's
+struct DrawLod {
+  uint32_t firstIndex;
+  uint32_t indexCount;
+  float error;
+  uint32_t pad;
+};
+
+// one per draw batch, dequantizes the primitive's positions and picks its material, and its levels for the culling pass
+struct DrawData {
+  glm::vec3 boundsMin;
+  uint32_t material; // element of the material buffer, packed into boundsMin's vec4 slot
+  glm::vec3 boundsExtent;
+  uint32_t group; // element of App::drawGroups
+  std::array<DrawLod, MAX_LOD_LEVELS - 1> lods;
+  uint32_t lodCount;
+  uint32_t pad[3];
+};
+static_assert(sizeof(DrawData) == 112, "DrawData must match its std430 layout in shader.slang and cull.slang");
+
+// one per draw group, rewritten each frame for the culling pass
+struct CullGroup {
+  uint32_t firstDraw;
+  uint32_t drawable; // 0 while its cell or a texture of its batches is not resident
+};
+
+// push constants of the culling pass, phase is 0 or 1
+struct CullConstants {
+  uint32_t phase;
+  uint32_t drawCount;
+  uint32_t groupCount;
+  uint32_t occlusion; // 0 when there is no depth pyramid to test against
+  glm::vec2 viewportSize;
+  uint32_t pyramidLevels;
+  uint32_t selectLods;
+  glm::vec3 cameraPosition; // App::cullCameraPosition
+  float lodPixelScale;
+  float lodPixelError;
+};
+
+// push constants of one level of the depth pyramid
+struct PyramidConstants {
+  glm::uvec2 sourceSize;
+  glm::uvec2 size;
+};
+
+// one element of the material buffer per gltf material, textures are elements of the bindless texture array
+struct MaterialData {
+  uint32_t baseColorTexture;
+};
+
 // need to keep byte alignment in mind when defining probe and ray data structures
 // Model, View, Projection uniform buffer object struct
 struct MVP {
@@ -131,30 +338,96 @@ struct MVP {
 struct PrimData {
   fastgltf::Mesh* parent;
 
-  std::vector<uint32_t> indices;
-  
-  vk::raii::Buffer indexBuffer = nullptr;
-  vk::raii::DeviceMemory indexBufferMemory = nullptr;
+  // range of App::indices, which are local to the primitive's vertices starting at vertexOffset
+  uint32_t firstIndex = 0U;
+  uint32_t indexCount = 0U;
+  int32_t vertexOffset = 0;
+  // the App::cells its vertices and every one of its index ranges are streamed with
+  uint32_t cell = 0U;
+
+  // bounds of the vertices at vertexOffset, quantized positions are relative to these
+  glm::vec3 boundsMin = glm::vec3(0.0f);
+  glm::vec3 boundsExtent = glm::vec3(0.0f);
+  // where the primitive sits relative to those bounds, non-zero when it repeats another primitive's vertices somewhere else
+  glm::vec3 placement = glm::vec3(0.0f);
+
+  // range of App::meshlets, the runs of this primitive's triangles that are culled on their own
+  uint32_t firstMeshlet = 0U;
+  uint32_t meshletCount = 0U;
+
+  // ranges of App::indices drawn against the same vertices, each coarser than the last, meshlets only cover the original
+  uint32_t lodCount = 0U;
+  std::array<LodLevel, MAX_LOD_LEVELS - 1> lods{};
   
-  size_t imageViewIndex;
-
-  std::vector<vk::raii::DescriptorSet> descriptorSets;
+  size_t materialIndex;
 };
 
+// the primitives of a gltf mesh, contiguous in App::prims
 struct MeshData {
-  glm::vec3 translation = glm::vec3(0.0f);
-  glm::vec3 rotation = glm::vec3(0.0f);
-  glm::vec3 scale = glm::vec3(1.0f);
+  uint32_t firstPrim = 0U;
+  uint32_t primCount = 0U;
+};
+
+// a node drawing a mesh
+struct MeshInstance {
+  uint32_t node;
+  uint32_t mesh;
+};
+
+// every instance of one primitive's geometry and material, drawn with a single instanced call
+struct DrawBatch {
+  uint32_t prim; // its bounds, meshlets and levels of detail are the ones every instance draws
+  // range of App::batchInstances, and of the transform buffer the vertex shader reads through firstInstance
+  uint32_t firstInstance;
+  uint32_t instanceCount;
+};
+
+// one instance of a batch, the node placing it and the placement of the primitive it stands for
+struct BatchInstance {
+  uint32_t node;
+  glm::vec3 placement;
+};
 
-  glm::mat4 getModelMatrix() const 
+// a spatial cell of the cooked geometry, loaded and evicted as a whole, see streamCells
+struct GeometryCell {
+  // world space, around every instance of the geometry in it
+  glm::vec3 boundsMin;
+  glm::vec3 boundsMax;
+  // its ranges of the cooked vertices and indices, the 16-bit index ranges of every cell come before the 32-bit ones
+  uint32_t firstVertex;
+  uint32_t vertexCount;
+  uint32_t firstShortIndex;
+  uint32_t shortIndexCount;
+  uint32_t firstWideIndex;
+  uint32_t wideIndexCount;
+
+  // host and device copies are laid out alike, each vertex stream from its streamOffset(), then 16-bit indices
+  // from indexOffset() and 32-bit ones from wideIndexOffset(), all 4-byte aligned as binding them requires
+  std::vector<std::byte> hostData;
+  vk::raii::Buffer buffer = nullptr;
+  DeviceAllocation bufferMemory = nullptr;
+  uint64_t uploadValue = UPLOAD_PENDING;
+
+  [[nodiscard]] vk::DeviceSize streamOffset(uint32_t stream) const
   {
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, translation);
-    model = glm::rotate(model, rotation.x, glm::vec3(1.0f, 0.0f, 0.0f));
-    model = glm::rotate(model, rotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
-    model = glm::rotate(model, rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
-    model = glm::scale(model, scale);
-    return model;
+    vk::DeviceSize offset = 0U;
+    for (uint32_t before = 0; before < stream; before++)
+    {
+      offset += Vertex::STREAM_STRIDES[before] * vertexCount;
+    }
+    return offset;
+  }
+  [[nodiscard]] vk::DeviceSize indexOffset() const
+  {
+    return (streamOffset(Vertex::STREAM_COUNT) + 3U) & ~vk::DeviceSize(3U);
+  }
+  [[nodiscard]] vk::DeviceSize wideIndexOffset() const
+  {
+    return (indexOffset() + sizeof(uint16_t) * shortIndexCount + 3U) & ~vk::DeviceSize(3U);
+  }
+  [[nodiscard]] vk::DeviceSize size() const
+  {
+    return std::max<vk::DeviceSize>(wideIndexOffset() + sizeof(uint32_t) * wideIndexCount, sizeof(uint32_t));
   }
 };
 
@@ -165,6 +438,8 @@ static bool hotReload = false;
 class App
 {
   public:
+  // --cook ignores the scene cache, --benchmark-welding also sets benchmarkWelding, the first argument is the program
+  void parseArguments(std::span<char* const> arguments);
   void run();
   private:
   // Class Variables
@@ -172,15 +447,120 @@ class App
   
 
   static int xpos, ypos;
+
+  std::chrono::steady_clock::time_point startTime;
+  // cook the scene and rewrite its cache even when the cache is valid
+  bool forceCook = false;
+
+  // decoded on the thread pool, uploaded by the main thread as frames go by
+  // declared before threadPool so in-flight decodes never outlive the queue they push into
+  struct DecodedTexture {
+    size_t index;
+    ktxTexture2* kTexture;
+    std::exception_ptr error;
+  };
+  std::mutex decodedMutex;
+  std::deque<DecodedTexture> decodedTextures;
+  size_t texturesPending = 0U;
+
+  // cells read into their hostData on the thread pool, handed to the main thread to upload
+  struct ReadCell {
+    uint32_t cell;
+    std::exception_ptr error;
+  };
+  std::mutex readCellsMutex;
+  std::deque<ReadCell> readCells;
+
+  // what cells are read from, the mapped scene cache on a warm start, App::vertices and App::indices after cooking
+  // declared before threadPool too, reads in flight point into the mapping
+  SceneCache sceneCache;
+  std::span<const Vertex> cellVertices;
+  std::span<const uint32_t> cellIndices;
+
+  ThreadPool threadPool;
   
   EngineStats stats;
   
+  // only filled while cooking, cells are streamed from cellVertices and cellIndices
   std::vector<Vertex> vertices;
+  // every primitive's indices back to back, each relative to its own vertexOffset
+  std::vector<uint32_t> indices;
+  // bytes of vertices and indices still held after cooking, only when the scene cache could not be written to stream from
+  uint64_t cookedHostBytes = 0U;
 
+  // declared before asset so the mappings outlive the ByteViews pointing into them
+  std::vector<MappedFile> mappedBuffers;
   fastgltf::Asset asset;
+  // files hashed into the scene cache key, the gltf first, relative to the gltf's directory
+  std::vector<std::string> assetSources;
+  // uri of each image a material samples, relative to the gltf's directory
+  // texture slot i decodes materialTextures[i], the slot after the last is the white fallback
+  std::vector<std::string> materialTextures;
 
   std::vector<MeshData> meshes;
   std::vector<PrimData> prims;
+  SceneGraph sceneGraph;
+  std::vector<MeshInstance> meshInstances;
+  std::vector<DrawBatch> drawBatches;
+  std::vector<BatchInstance> batchInstances;
+  std::vector<Meshlet> meshlets;
+  std::vector<GeometryCell> cells;
+  CellStreamer cellStreamer;
+  CellStreamer::Plan streamingPlan;
+  // uploaded and not yet acquired by the graphics queue
+  std::vector<uint32_t> cellsUploading;
+  // camera position and smoothed velocity in world space as of the last streamCells
+  glm::vec3 streamingPosition = glm::vec3(0.0f);
+  glm::vec3 streamingVelocity = glm::vec3(0.0f);
+  std::chrono::steady_clock::time_point lastStreamTime;
+  // indices below this are in the 16-bit parts of the cells
+  uint32_t shortIndexCount = 0U;
+  // culling inputs for this frame in world space, from updateModelViewProjection
+  std::array<glm::vec4, 6> frustumPlanes{};
+  glm::vec3 cullCameraPosition = glm::vec3(0.0f);
+  // pixels per unit of error one unit away from the camera, from the projection and the swapchain height
+  float lodPixelScale = 0.0f;
+  // culling inputs of each instance of the batch being recorded, carried into the batch primitive's space
+  struct InstanceView {
+    std::array<glm::vec4, 6> planes;
+    glm::vec3 viewer;
+  };
+  std::vector<InstanceView> instanceViews;
+  // world bounds of each draw batch around all of its instances, rebuilt when the scene graph moves
+  FrustumCuller batchCuller;
+  uint64_t batchBoundsGeneration = ~uint64_t(0);
+  // this frame's batches in the frustum, in batch order
+  std::vector<uint32_t> visibleBatches;
+  // this frame's draws once culled and levels picked, ranges are local to the cell's buffer, see recordDraws
+  struct CellDraw {
+    uint32_t batch;
+    uint32_t indexCount;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t firstInstance;
+    bool wideIndices;
+  };
+  std::vector<CellDraw> cellDraws;
+  // a run of draw batches in one cell whose indices have the same width, drawn by one indirect call, see recordIndirectDraws
+  struct DrawGroup {
+    uint32_t cell;
+    bool wideIndices;
+    uint32_t firstDraw;
+    uint32_t drawCount;
+    uint32_t triangleCount;
+    bool texturesReady; // every material's texture has been acquired, from then on it stays so
+  };
+  std::vector<DrawGroup> drawGroups;
+
+  // a run of App::vertices that primitives draw from, with every index range drawn against it
+  struct VertexRange {
+    int32_t vertexOffset;
+    uint32_t vertexCount;
+    std::vector<std::pair<uint32_t, uint32_t>> indexRanges; // firstIndex, indexCount, sorted
+    // none of its index ranges are drawn against other vertices, so its vertices can be renumbered
+    bool exclusive;
+  };
 
   vk::raii::Context context;
   vk::raii::Instance instance = nullptr;
@@ -196,10 +576,15 @@ class App
   
   vk::raii::PhysicalDevice physicalDevice = nullptr;
   vk::raii::Device device = nullptr;
+  // backs createBuffer and createImage, reset in cleanup once everything it handed out is gone
+  std::unique_ptr<DeviceAllocator> allocator;
   
   uint32_t graphicsIndex = ~0;
   uint32_t computeIndex = ~0;
+  uint32_t transferIndex = ~0;
   vk::raii::Queue queue = nullptr;
+  // separate family when the device has one, otherwise the same queue as above
+  vk::raii::Queue transferQueue = nullptr;
   
   vk::raii::SurfaceKHR surface = nullptr;
   vk::Format swapChainSurfaceFormat;
@@ -213,28 +598,109 @@ class App
 
   vk::raii::PipelineLayout pipelineLayout = nullptr;
   vk::raii::Pipeline graphicsPipeline = nullptr;
+  // vertex stage only, reads the position stream alone
+  vk::raii::Pipeline depthPipeline = nullptr;
+  // compute passes of occlusion culling, each with a set layout of its own
+  vk::raii::DescriptorSetLayout cullSetLayout = nullptr;
+  vk::raii::PipelineLayout cullPipelineLayout = nullptr;
+  vk::raii::Pipeline cullPipeline = nullptr;
+  vk::raii::DescriptorSetLayout pyramidSetLayout = nullptr;
+  vk::raii::PipelineLayout pyramidPipelineLayout = nullptr;
+  vk::raii::Pipeline pyramidPipeline = nullptr;
   vk::SampleCountFlagBits msaaSamples = vk::SampleCountFlagBits::e1;
   
   vk::raii::CommandPool commandPool = nullptr;
   std::vector<vk::raii::CommandBuffer> commandBuffers;
+  // a pool per frame in flight per recording thread, the workers and the calling one, indexed frame * recordingSlots + slot
+  // a slot is only ever recorded by one thread at a time, so its pool needs no lock
+  uint32_t recordingSlots = 0U;
+  std::vector<vk::raii::CommandPool> secondaryCommandPools;
+  // a secondary per pass for each pool, indexed (frame * recordingSlots + slot) * 2 + pass, the depth prepass first
+  std::vector<vk::raii::CommandBuffer> secondaryCommandBuffers;
+  // imgui's draws when the rendering takes only secondaries, per frame in flight
+  std::vector<vk::raii::CommandBuffer> imguiCommandBuffers;
+  // submits on transferQueue, drained a little every frame
+  std::unique_ptr<UploadBatch> uploadBatch;
+  // every upload at or below this timeline value has been acquired by the graphics queue
+  uint64_t uploadsAcquired = 0U;
+  // highest timeline value any part of the scene lands at
+  uint64_t sceneUploadValue = 0U;
+
+  std::vector<uint64_t> textureUploadValues;
+  // whether each texture has been written into each frame's set yet
+  std::vector<std::array<bool, MAX_FRAMES_IN_FLIGHT>> textureBound;
+  // length of the texture array in the set layout, what the device allows up to MAX_BINDLESS_TEXTURES
+  uint32_t maxBindlessTextures = 0U;
+
+  std::vector<MaterialData> materials;
+  vk::raii::Buffer materialBuffer = nullptr;
+  DeviceAllocation materialBufferMemory = nullptr;
+  uint64_t materialUploadValue = UPLOAD_PENDING;
   std::vector<vk::raii::Image> textureImages;
-  std::vector<vk::raii::DeviceMemory> textureImagesMemory;
+  std::vector<DeviceAllocation> textureImagesMemory;
   std::vector<vk::raii::ImageView> textureImageViews;
   vk::raii::Sampler textureSampler = nullptr;
 
   vk::raii::Image depthImage = nullptr;
-  vk::raii::DeviceMemory depthImageMemory = nullptr;
+  DeviceAllocation depthImageMemory = nullptr;
+  // found once with the depth image, secondaries inherit it every frame
+  vk::Format depthImageFormat = vk::Format::eUndefined;
   vk::raii::ImageView depthImageView = nullptr;
-
-  vk::raii::Buffer vertexBuffer = nullptr;
-  vk::raii::DeviceMemory vertexBufferMemory = nullptr;
+  // farthest depth of the last phase 0 draws at every level, kept from one frame to be tested against in the next
+  vk::raii::Image depthPyramid = nullptr;
+  DeviceAllocation depthPyramidMemory = nullptr;
+  vk::raii::ImageView depthPyramidView = nullptr;
+  std::vector<vk::raii::ImageView> depthPyramidLevelViews;
+  uint32_t depthPyramidLevels = 0U;
+  // false until a pyramid has been built since the depth buffer was last created
+  bool depthPyramidValid = false;
+
+  // device copies of evicted cells, a frame still in flight may draw from them, freed once that frame's fence has passed
+  std::array<std::vector<std::pair<vk::raii::Buffer, DeviceAllocation>>, MAX_FRAMES_IN_FLIGHT> retiredCellBuffers;
 
   std::vector<vk::raii::Buffer> uniformBuffers;
-  std::vector<vk::raii::DeviceMemory> uniformBuffersMemory;
+  std::vector<DeviceAllocation> uniformBuffersMemory;
   std::vector<void*> uniformBuffersMapped;
 
+  // world matrix of every batch instance, one host-visible copy per frame in flight,
+  // rewritten when the frame's copy is older than the graph
+  std::vector<vk::raii::Buffer> transformBuffers;
+  std::vector<DeviceAllocation> transformBuffersMemory;
+  std::vector<void*> transformBuffersMapped;
+  std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> transformGenerations{};
+
+  // built once the scene is loaded, one command and one element of draw data per draw batch, one count per draw group
+  vk::raii::Buffer drawCommandBuffer = nullptr;
+  DeviceAllocation drawCommandBufferMemory = nullptr;
+  vk::raii::Buffer drawCountBuffer = nullptr;
+  DeviceAllocation drawCountBufferMemory = nullptr;
+  vk::raii::Buffer drawDataBuffer = nullptr;
+  DeviceAllocation drawDataBufferMemory = nullptr;
+  uint64_t drawBuffersUploadValue = UPLOAD_PENDING;
+  // written by the culling pass, two phases of commands, draw ids and counts, and the batches phase 0 found occluded
+  vk::raii::Buffer culledCommandBuffer = nullptr;
+  DeviceAllocation culledCommandBufferMemory = nullptr;
+  vk::raii::Buffer culledDrawIdBuffer = nullptr;
+  DeviceAllocation culledDrawIdBufferMemory = nullptr;
+  vk::raii::Buffer culledCountBuffer = nullptr;
+  DeviceAllocation culledCountBufferMemory = nullptr;
+  vk::raii::Buffer occludedBuffer = nullptr;
+  DeviceAllocation occludedBufferMemory = nullptr;
+  // host-visible, one per frame in flight, the groups going in and the stats coming out
+  std::vector<vk::raii::Buffer> cullGroupBuffers;
+  std::vector<DeviceAllocation> cullGroupBuffersMemory;
+  std::vector<void*> cullGroupBuffersMapped;
+  std::vector<vk::raii::Buffer> cullStatsBuffers;
+  std::vector<DeviceAllocation> cullStatsBuffersMemory;
+  std::vector<void*> cullStatsBuffersMapped;
+
   vk::raii::DescriptorPool descriptorPool = nullptr;
   vk::raii::DescriptorPool imguiDescriptorPool = nullptr;
+  // one bindless set per frame in flight, bound once for every draw of the frame
+  std::vector<vk::raii::DescriptorSet> descriptorSets;
+  // one culling set per frame in flight, and one set per level of the depth pyramid
+  std::vector<vk::raii::DescriptorSet> cullDescriptorSets;
+  std::vector<vk::raii::DescriptorSet> depthPyramidSets;
 
   std::vector<vk::raii::Semaphore> presentCompleteSemaphores;
   std::vector<vk::raii::Semaphore> renderFinishedSemaphores;
@@ -261,6 +727,7 @@ class App
   void createSwapChainImageViews();
   void createDescriptorSetLayout();
   void createGraphicsPipeline();
+  void createCullPipelines();
   [[nodiscard]] vk::raii::ShaderModule createShaderModule(const std::vector<char>& code) const;
   [[nodiscard]] vk::Format findDepthFormat() const;
   vk::Format findSupportedFormat(
@@ -277,55 +744,63 @@ class App
     vk::ImageUsageFlags usage,
     vk::MemoryPropertyFlags properties,
     vk::raii::Image& image,
-    vk::raii::DeviceMemory& imageMemory
+    DeviceAllocation& imageMemory
   );
-  uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
   [[nodiscard]] vk::raii::ImageView createImageView(
     const vk::raii::Image& image,
     vk::Format format,
     vk::ImageAspectFlags aspectFlags,
     uint32_t mipLevels
   ) const;
+  void loadScene(std::filesystem::path path);
+  bool loadSceneCache(std::filesystem::path path);
+  void writeSceneCache(std::filesystem::path path);
   void loadAsset(std::filesystem::path path);
+  void decodeCompressedViews();
+  void collectMaterialTextures();
   void loadTextures(std::filesystem::path path);
-  [[nodiscard]] std::pair<vk::raii::Image, vk::raii::DeviceMemory> createTextureImage(const char* texturePath);
+  [[nodiscard]] static ktxTexture2* decodeTexture(const char* texturePath);
+  [[nodiscard]] static ktxTexture2* createFallbackTexture();
+  void createTextureImage(ktxTexture2* kTexture, size_t textureIndex);
   void createBuffer(
     vk::DeviceSize size,
     vk::BufferUsageFlags usage,
     vk::MemoryPropertyFlags properties,
     vk::raii::Buffer& buffer,
-    vk::raii::DeviceMemory& bufferMemory
-  );
-  void transitionImageLayout(
-    const vk::raii::Image& image,
-    vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
-    uint32_t mipLevels
-  );
-  std::unique_ptr<vk::raii::CommandBuffer> beginSingleTimeCommands();
-  void endSingleTimeCommands(const vk::raii::CommandBuffer& commandBuffer) const;
-  void copyBufferToImage(
-    const vk::raii::Buffer& buffer,
-    const vk::raii::Image& image,
-    uint32_t width, uint32_t height, uint32_t mipLevels,
-    ktxTexture2* kTexture
+    DeviceAllocation& bufferMemory
   );
   void createTextureImageView(
     const vk::raii::Image& image, 
     vk::Format format, 
-    uint32_t mipLevels
+    uint32_t mipLevels,
+    size_t textureIndex
   );
   void createTextureSampler();
+  void createMaterialBuffer();
+  void createDrawBuffers();
   void loadGeometry();
-  void copyBuffer(
-    vk::raii::Buffer& srcBuffer, vk::raii::Buffer& dstBuffer,
-    vk::DeviceSize size
-  );
-  void createVertexBuffer();
-  void createIndexBuffers();
+  void loadNodes();
+  void createDrawBatches();
+  [[nodiscard]] std::vector<VertexRange> collectVertexRanges() const;
+  void weldVertices();
+  void optimizeGeometry();
+  void createMeshlets();
+  void createLods();
+  void createCells();
+  [[nodiscard]] VertexCacheStats measureVertexCache(std::span<const uint32_t> indexData) const;
+  void createCellStreamer();
+  void streamCells();
+  void pumpUploads();
   void createUniformBuffers();
+  void createTransformBuffers();
+  void createCullBuffers();
   void createDescriptorPools();
   void createDescriptorSets();
+  // rewritten whenever the depth buffer is recreated
+  void createDepthPyramidSets();
+  void bindResidentTextures();
   void createCommandBuffers();
+  void createSecondaryCommandBuffers();
   void createSyncObjects();
 
   void initImGui();
@@ -336,6 +811,8 @@ class App
   void reloadShaders();
   void drawFrame();
   void updateModelViewProjection(uint32_t imageIndex);
+  [[nodiscard]] glm::mat4 instanceTransform(const BatchInstance& instance) const;
+  void updateBatchBounds();
   void transitionImageLayout(
     uint32_t imageIndex,
     vk::ImageLayout oldLayout,
@@ -345,7 +822,21 @@ class App
     vk::PipelineStageFlags2 srcStageMask,
     vk::PipelineStageFlags2 dstStageMask
   );
-  void recordCommandBuffer(uint32_t imageIndex);
+  void recordCommandBuffer(uint32_t imageIndex, bool acquireUploads);
+  // culls, picks levels and fills cellDraws from the draw batches of the resident cells
+  void collectDraws();
+  // binds only the position stream when positionsOnly, for depth and other passes that write no attributes
+  void recordDraws(vk::raii::CommandBuffer& commandBuffer, std::span<const CellDraw> draws, bool positionsOnly);
+  // cellDraws split over the thread pool into secondaries, executed in order inside the frame's rendering
+  void recordDrawsParallel(const vk::CommandBufferInheritanceInfo& inheritanceInfo);
+  // draws the commands of the given culling phase when culled, otherwise those built at load
+  void recordIndirectDraws(bool positionsOnly, bool culled, uint32_t phase);
+  // whether the group's cell and every texture of its batches are resident
+  bool groupDrawable(DrawGroup& group);
+  void recordCullPhase(uint32_t phase);
+  void buildDepthPyramid();
+  void bindCellStreams(vk::raii::CommandBuffer& commandBuffer, const GeometryCell& cell, bool positionsOnly);
+  void bindCellIndices(vk::raii::CommandBuffer& commandBuffer, const GeometryCell& cell, bool wideIndices);
   
   void cleanup();
   
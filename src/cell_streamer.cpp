@@ -0,0 +1,166 @@
+#include "cell_streamer.hpp"
+
+#include <algorithm>
+#include <functional>
+
+// host copies of cells already on the device only matter once the device copy goes, so they go first
+constexpr uint64_t DEVICE_COPY_SCORE = 1ULL << 32;
+
+static float distanceToBounds(const glm::vec3& point, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+  return glm::length(glm::max(glm::max(boundsMin - point, point - boundsMax), glm::vec3(0.0f)));
+}
+
+void CellStreamer::Plan::clear()
+{
+  deviceEvictions.clear();
+  uploads.clear();
+  hostEvictions.clear();
+  reads.clear();
+}
+
+void CellStreamer::reset(std::vector<Cell> newCells)
+{
+  cells = std::move(newCells);
+  states.assign(cells.size(), State{});
+  frame = 0U;
+  wantedCount = 0U;
+  hostUsed = 0U;
+  deviceUsed = 0U;
+  readsInFlight = 0U;
+  residentCells = 0U;
+  uploadsStarted = 0U;
+  deviceEvictions = 0U;
+}
+
+uint64_t CellStreamer::evictionScore(uint32_t cell) const
+{
+  // wanted cells keep their place in line, the rest score higher the longer ago they were last wanted
+  const State& state = states[cell];
+  if (state.lastWanted == frame) return state.rank;
+  return wantedCount + (frame - state.lastWanted);
+}
+
+void CellStreamer::plan(const glm::vec3& position, const glm::vec3& velocity, const Settings& settings, Plan& out)
+{
+  out.clear();
+  frame++;
+
+  const glm::vec3 predicted = position + velocity * settings.lookahead;
+  wanted.clear();
+  for (uint32_t cell = 0; cell < cells.size(); cell++)
+  {
+    const float distance = std::min(
+      distanceToBounds(position, cells[cell].boundsMin, cells[cell].boundsMax),
+      distanceToBounds(predicted, cells[cell].boundsMin, cells[cell].boundsMax)
+    );
+    if (distance <= settings.radius) wanted.emplace_back(distance, cell);
+  }
+  std::ranges::sort(wanted);
+  wantedCount = static_cast<uint32_t>(wanted.size());
+  for (uint32_t rank = 0; rank < wanted.size(); rank++)
+  {
+    states[wanted[rank].second].lastWanted = frame;
+    states[wanted[rank].second].rank = rank;
+  }
+
+  deviceCandidates.clear();
+  hostCandidates.clear();
+  for (uint32_t cell = 0; cell < cells.size(); cell++)
+  {
+    if (states[cell].device == Copy::Ready) deviceCandidates.emplace_back(evictionScore(cell), cell);
+    if (states[cell].host == Copy::Ready)
+      hostCandidates.emplace_back(evictionScore(cell) + (states[cell].device != Copy::None ? DEVICE_COPY_SCORE : 0U), cell);
+  }
+  std::ranges::sort(deviceCandidates, std::greater{});
+  std::ranges::sort(hostCandidates, std::greater{});
+  deviceCursor = 0U;
+  hostCursor = 0U;
+
+  // budgets lowered since the last plan are met first, whatever has to go
+  makeRoom(true, 0U, settings.deviceBudget, 0U, out);
+  makeRoom(false, 0U, settings.hostBudget, 0U, out);
+
+  for (uint32_t rank = 0; rank < wanted.size(); rank++)
+  {
+    const uint32_t cell = wanted[rank].second;
+    State& state = states[cell];
+    if (state.device != Copy::None) continue;
+
+    if (state.host == Copy::Ready)
+    {
+      if (!makeRoom(true, cells[cell].deviceBytes, settings.deviceBudget, rank + 1U, out)) continue;
+      out.uploads.push_back(cell);
+      state.device = Copy::Pending;
+      deviceUsed += cells[cell].deviceBytes;
+      uploadsStarted++;
+    }
+    else if (state.host == Copy::None && readsInFlight < settings.maxReads)
+    {
+      if (!makeRoom(false, cells[cell].hostBytes, settings.hostBudget, rank + 1U, out)) continue;
+      out.reads.push_back(cell);
+      state.host = Copy::Pending;
+      hostUsed += cells[cell].hostBytes;
+      readsInFlight++;
+    }
+  }
+}
+
+bool CellStreamer::makeRoom(bool device, uint64_t bytes, uint64_t budget, uint64_t minScore, Plan& out)
+{
+  const uint64_t used = device ? deviceUsed : hostUsed;
+  if (bytes > budget) return false;
+  if (used + bytes <= budget) return true;
+
+  // only drop anything once it is known to be enough
+  const auto& candidates = device ? deviceCandidates : hostCandidates;
+  size_t& cursor = device ? deviceCursor : hostCursor;
+  auto ready = [&](uint32_t cell) { return (device ? states[cell].device : states[cell].host) == Copy::Ready; };
+  auto cellBytes = [&](uint32_t cell) { return device ? cells[cell].deviceBytes : cells[cell].hostBytes; };
+  uint64_t freed = 0U;
+  size_t end = cursor;
+  for (; end < candidates.size() && used + bytes - freed > budget; end++)
+  {
+    const auto [score, cell] = candidates[end];
+    if (score < minScore) break;
+    if (ready(cell)) freed += cellBytes(cell);
+  }
+  if (used + bytes - freed > budget) return false;
+
+  for (; cursor < end; cursor++)
+  {
+    if (ready(candidates[cursor].second)) evict(device, candidates[cursor].second, out);
+  }
+  return true;
+}
+
+void CellStreamer::evict(bool device, uint32_t cell, Plan& out)
+{
+  State& state = states[cell];
+  if (device)
+  {
+    out.deviceEvictions.push_back(cell);
+    state.device = Copy::None;
+    deviceUsed -= cells[cell].deviceBytes;
+    residentCells--;
+    deviceEvictions++;
+  }
+  else
+  {
+    out.hostEvictions.push_back(cell);
+    state.host = Copy::None;
+    hostUsed -= cells[cell].hostBytes;
+  }
+}
+
+void CellStreamer::readFinished(uint32_t cell)
+{
+  states[cell].host = Copy::Ready;
+  readsInFlight--;
+}
+
+void CellStreamer::uploadFinished(uint32_t cell)
+{
+  states[cell].device = Copy::Ready;
+  residentCells++;
+}
@@ -0,0 +1,97 @@
+#ifndef CELL_STREAMER_HPP
+#define CELL_STREAMER_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Residency of spatial cells of geometry, read from disk into host memory and uploaded from there to the device
+// Cells within the radius of the camera, or of where its velocity puts it lookahead seconds from now, are wanted,
+// nearest first, and every plan() fills both memory budgets in that order
+// Room is made by dropping copies least recently wanted first, never those of a cell wanted more than the one
+// taking their place, so cells do not push each other out frame after frame when the budget is too small
+// The caller reads and uploads what the plan says and reports back through readFinished and uploadFinished
+class CellStreamer
+{
+  public:
+  struct Cell {
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    uint64_t hostBytes;
+    uint64_t deviceBytes;
+  };
+
+  struct Settings {
+    float radius;
+    float lookahead; // seconds of the camera's velocity to prefetch along
+    uint64_t hostBudget;
+    uint64_t deviceBudget;
+    uint32_t maxReads; // reads in flight at once
+  };
+
+  // carried out in this order, a host copy dropped here is never one uploaded by the same plan
+  struct Plan {
+    std::vector<uint32_t> deviceEvictions;
+    std::vector<uint32_t> uploads;
+    std::vector<uint32_t> hostEvictions;
+    std::vector<uint32_t> reads;
+
+    void clear();
+  };
+
+  void reset(std::vector<Cell> cells);
+
+  void plan(const glm::vec3& position, const glm::vec3& velocity, const Settings& settings, Plan& out);
+
+  void readFinished(uint32_t cell);
+  void uploadFinished(uint32_t cell);
+
+  [[nodiscard]] size_t size() const { return cells.size(); }
+  [[nodiscard]] bool resident(uint32_t cell) const { return states[cell].device == Copy::Ready; }
+  [[nodiscard]] uint32_t residentCount() const { return residentCells; }
+  // bytes of copies that are there or on their way
+  [[nodiscard]] uint64_t hostBytes() const { return hostUsed; }
+  [[nodiscard]] uint64_t deviceBytes() const { return deviceUsed; }
+  [[nodiscard]] uint32_t uploadCount() const { return uploadsStarted; }
+  [[nodiscard]] uint32_t evictionCount() const { return deviceEvictions; }
+
+  private:
+  enum class Copy : uint8_t { None, Pending, Ready };
+
+  struct State {
+    Copy host = Copy::None;
+    Copy device = Copy::None;
+    uint64_t lastWanted = 0U;
+    uint32_t rank = 0U; // place in this frame's wanted list, when lastWanted is this frame
+  };
+
+  // how readily a copy of the cell is dropped, higher first
+  [[nodiscard]] uint64_t evictionScore(uint32_t cell) const;
+  // drops device or host copies scoring at least minScore, highest first, until bytes more fit in the budget
+  // false, dropping nothing, when they would not
+  bool makeRoom(bool device, uint64_t bytes, uint64_t budget, uint64_t minScore, Plan& out);
+  void evict(bool device, uint32_t cell, Plan& out);
+
+  std::vector<Cell> cells;
+  std::vector<State> states;
+  uint64_t frame = 0U;
+  uint32_t wantedCount = 0U;
+
+  uint64_t hostUsed = 0U;
+  uint64_t deviceUsed = 0U;
+  uint32_t readsInFlight = 0U;
+  uint32_t residentCells = 0U;
+  uint32_t uploadsStarted = 0U;
+  uint32_t deviceEvictions = 0U;
+
+  // reused by plan, candidates are sorted by score once and used up from the cursor
+  std::vector<std::pair<float, uint32_t>> wanted; // distance, cell
+  std::vector<std::pair<uint64_t, uint32_t>> deviceCandidates; // score, cell
+  std::vector<std::pair<uint64_t, uint32_t>> hostCandidates;
+  size_t deviceCursor = 0U;
+  size_t hostCursor = 0U;
+};
+
+#endif
@@ -0,0 +1,372 @@
+#include "device_allocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <utility>
+
+static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+DeviceAllocation::DeviceAllocation(DeviceAllocation&& other) noexcept
+{
+  *this = std::move(other);
+}
+
+DeviceAllocation& DeviceAllocation::operator=(DeviceAllocation&& other) noexcept
+{
+  if (this != &other)
+  {
+    release();
+    allocator = std::exchange(other.allocator, nullptr);
+    pool = other.pool;
+    block = other.block;
+    range = other.range;
+    memory = std::exchange(other.memory, nullptr);
+    offset = std::exchange(other.offset, 0U);
+    size = std::exchange(other.size, 0U);
+    mapped = std::exchange(other.mapped, nullptr);
+  }
+  return *this;
+}
+
+DeviceAllocation::~DeviceAllocation()
+{
+  release();
+}
+
+void DeviceAllocation::release()
+{
+  if (allocator != nullptr)
+  {
+    allocator->free(*this);
+    allocator = nullptr;
+    memory = nullptr;
+    mapped = nullptr;
+  }
+}
+
+DeviceAllocator::DeviceAllocator(
+  const vk::raii::Device& device,
+  const vk::raii::PhysicalDevice& physicalDevice,
+  vk::DeviceSize blockSize
+) : device(device), memoryProperties(physicalDevice.getMemoryProperties())
+{
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+  {
+    // small heaps (e.g. the 256MB host-visible device-local window) get smaller blocks so one block cannot hog them
+    const vk::DeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[i].heapIndex].size;
+    const vk::DeviceSize typeBlockSize = std::max(MIN_RANGE, std::min(blockSize, heapSize / 8U) / MIN_RANGE * MIN_RANGE);
+    for (uint32_t tiling = 0; tiling < 2; tiling++)
+    {
+      pools[i * 2 + tiling].memoryTypeIndex = i;
+      pools[i * 2 + tiling].blockSize = typeBlockSize;
+    }
+  }
+}
+
+DeviceAllocator::~DeviceAllocator() = default;
+
+DeviceAllocation DeviceAllocator::allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags properties, bool linear)
+{
+  const uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+  const uint32_t poolIndex = memoryTypeIndex * 2 + (linear ? 0 : 1);
+  Pool& pool = pools[poolIndex];
+
+  const vk::DeviceSize size = alignUp(std::max<vk::DeviceSize>(requirements.size, 1U), MIN_RANGE);
+  const vk::DeviceSize alignment = std::max(requirements.alignment, MIN_RANGE);
+
+  uint32_t blockIndex = NO_RANGE;
+  uint32_t range = NO_RANGE;
+
+  if (size > pool.blockSize / 2U)
+  {
+    // big resources get a block to themselves rather than splintering the shared ones
+    // the whole block is the allocation, offset 0 suits any alignment
+    std::unique_ptr<Block> block = createBlock(memoryTypeIndex, size, true);
+    range = 0U;
+    block->removeFree(range);
+    block->allocations = 1U;
+    auto slot = std::ranges::find(pool.blocks, nullptr);
+    blockIndex = static_cast<uint32_t>(std::distance(pool.blocks.begin(), slot));
+    if (slot == pool.blocks.end()) pool.blocks.push_back(std::move(block));
+    else *slot = std::move(block);
+  }
+  else
+  {
+    for (uint32_t i = 0; i < pool.blocks.size() && range == NO_RANGE; i++)
+    {
+      if (pool.blocks[i] == nullptr || pool.blocks[i]->dedicated) continue;
+      range = pool.blocks[i]->allocate(size, alignment);
+      blockIndex = i;
+    }
+
+    if (range == NO_RANGE)
+    {
+      std::unique_ptr<Block> block = createBlock(memoryTypeIndex, pool.blockSize, false);
+      range = block->allocate(size, alignment);
+      auto slot = std::ranges::find(pool.blocks, nullptr);
+      blockIndex = static_cast<uint32_t>(std::distance(pool.blocks.begin(), slot));
+      if (slot == pool.blocks.end()) pool.blocks.push_back(std::move(block));
+      else *slot = std::move(block);
+    }
+  }
+
+  const Block& block = *pool.blocks[blockIndex];
+  DeviceAllocation allocation;
+  allocation.allocator = this;
+  allocation.pool = poolIndex;
+  allocation.block = blockIndex;
+  allocation.range = range;
+  allocation.memory = *block.memory;
+  allocation.offset = block.ranges[range].offset;
+  allocation.size = block.ranges[range].size;
+  allocation.mapped = block.mapped != nullptr ? block.mapped + allocation.offset : nullptr;
+  return allocation;
+}
+
+uint32_t DeviceAllocator::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const
+{
+  // typeFilter is a bitmask, and we iterate over it by shifting 1 by i
+  // then we check if it has the same properties as properties
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+  {
+    if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+    {
+      return i;
+    }
+  }
+
+  throw std::runtime_error("failed to find suitable memory type!");
+}
+
+DeviceAllocatorStats DeviceAllocator::getStats() const
+{
+  DeviceAllocatorStats stats;
+  vk::DeviceSize totalFree = 0U;
+  for (const auto& pool : pools)
+  {
+    for (const auto& block : pool.blocks)
+    {
+      if (block == nullptr) continue;
+
+      stats.blocks++;
+      if (block->dedicated) stats.dedicatedBlocks++;
+      stats.allocations += block->allocations;
+      stats.bytesReserved += block->capacity;
+      stats.bytesInUse += block->capacity - block->freeBytes;
+      totalFree += block->freeBytes;
+
+      // the largest free range is somewhere in the highest non-empty bucket
+      if (block->flBitmap != 0U)
+      {
+        const uint32_t fl = static_cast<uint32_t>(std::bit_width(block->flBitmap)) - 1U;
+        const uint32_t sl = static_cast<uint32_t>(std::bit_width(block->slBitmaps[fl])) - 1U;
+        for (uint32_t r = block->freeHeads[fl * SL_COUNT + sl]; r != NO_RANGE; r = block->ranges[r].nextFree)
+        {
+          stats.largestFreeRange = std::max(stats.largestFreeRange, block->ranges[r].size);
+        }
+      }
+    }
+  }
+
+  if (totalFree > 0U)
+  {
+    stats.fragmentation = 1.0f - static_cast<float>(stats.largestFreeRange) / static_cast<float>(totalFree);
+  }
+  return stats;
+}
+
+std::unique_ptr<DeviceAllocator::Block> DeviceAllocator::createBlock(uint32_t memoryTypeIndex, vk::DeviceSize capacity, bool dedicated) const
+{
+  auto block = std::make_unique<Block>();
+  block->memory = vk::raii::DeviceMemory(device, vk::MemoryAllocateInfo{
+    .allocationSize = capacity,
+    .memoryTypeIndex = memoryTypeIndex
+  });
+  if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+  {
+    block->mapped = static_cast<std::byte*>(block->memory.mapMemory(0, vk::WholeSize));
+  }
+  block->capacity = capacity;
+  block->dedicated = dedicated;
+  block->freeHeads.fill(NO_RANGE);
+  block->insertFree(block->newRange(0U, capacity));
+  return block;
+}
+
+void DeviceAllocator::free(const DeviceAllocation& allocation)
+{
+  Pool& pool = pools[allocation.pool];
+  auto& block = pool.blocks[allocation.block];
+  block->free(allocation.range);
+  if (block->allocations > 0U) return;
+
+  // one empty shared block is kept per pool so freeing and reallocating (swapchain resizes) does not thrash
+  const auto emptyBlocks = std::ranges::count_if(pool.blocks, [](const auto& b) { return b != nullptr && !b->dedicated && b->allocations == 0U; });
+  if (block->dedicated || emptyBlocks > 1)
+  {
+    block.reset();
+  }
+}
+
+void DeviceAllocator::mapping(vk::DeviceSize size, uint32_t& fl, uint32_t& sl)
+{
+  constexpr uint32_t smallLog2 = static_cast<uint32_t>(std::bit_width(SMALL_SIZE)) - 1U;
+  if (size < SMALL_SIZE)
+  {
+    fl = 0U;
+    sl = static_cast<uint32_t>(size / MIN_RANGE);
+  }
+  else
+  {
+    const uint32_t f = static_cast<uint32_t>(std::bit_width(size)) - 1U;
+    sl = static_cast<uint32_t>(size >> (f - SL_LOG2)) ^ SL_COUNT;
+    fl = f - (smallLog2 - 1U);
+  }
+}
+
+uint32_t DeviceAllocator::Block::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+  // offsets are all multiples of MIN_RANGE, so this is the most padding alignment can cost
+  uint32_t id = findFree(size + alignment - MIN_RANGE);
+  if (id == NO_RANGE) return NO_RANGE;
+  removeFree(id);
+
+  const vk::DeviceSize aligned = alignUp(ranges[id].offset, alignment);
+  if (aligned > ranges[id].offset)
+  {
+    // the padding in front stays free, its physical neighbour before is never free
+    const uint32_t padding = newRange(ranges[id].offset, aligned - ranges[id].offset);
+    ranges[padding].prevPhysical = ranges[id].prevPhysical;
+    ranges[padding].nextPhysical = id;
+    if (ranges[id].prevPhysical != NO_RANGE) ranges[ranges[id].prevPhysical].nextPhysical = padding;
+    ranges[id].prevPhysical = padding;
+    ranges[id].offset = aligned;
+    ranges[id].size -= ranges[padding].size;
+    insertFree(padding);
+  }
+
+  if (ranges[id].size > size)
+  {
+    const uint32_t rest = newRange(aligned + size, ranges[id].size - size);
+    ranges[rest].prevPhysical = id;
+    ranges[rest].nextPhysical = ranges[id].nextPhysical;
+    if (ranges[id].nextPhysical != NO_RANGE) ranges[ranges[id].nextPhysical].prevPhysical = rest;
+    ranges[id].nextPhysical = rest;
+    ranges[id].size = size;
+    insertFree(rest);
+  }
+
+  allocations++;
+  return id;
+}
+
+void DeviceAllocator::Block::free(uint32_t range)
+{
+  allocations--;
+
+  // coalesce with both physical neighbours, so no two free ranges are ever adjacent
+  const uint32_t prev = ranges[range].prevPhysical;
+  if (prev != NO_RANGE && ranges[prev].free)
+  {
+    removeFree(prev);
+    ranges[prev].size += ranges[range].size;
+    ranges[prev].nextPhysical = ranges[range].nextPhysical;
+    if (ranges[range].nextPhysical != NO_RANGE) ranges[ranges[range].nextPhysical].prevPhysical = prev;
+    unusedRanges.push_back(range);
+    range = prev;
+  }
+
+  const uint32_t next = ranges[range].nextPhysical;
+  if (next != NO_RANGE && ranges[next].free)
+  {
+    removeFree(next);
+    ranges[range].size += ranges[next].size;
+    ranges[range].nextPhysical = ranges[next].nextPhysical;
+    if (ranges[next].nextPhysical != NO_RANGE) ranges[ranges[next].nextPhysical].prevPhysical = range;
+    unusedRanges.push_back(next);
+  }
+
+  insertFree(range);
+}
+
+uint32_t DeviceAllocator::Block::findFree(vk::DeviceSize size) const
+{
+  // round up to the next bucket boundary so anything in the bucket found is big enough
+  if (size >= SMALL_SIZE)
+  {
+    size += (vk::DeviceSize(1) << (std::bit_width(size) - 1U - SL_LOG2)) - 1U;
+  }
+
+  uint32_t fl, sl;
+  mapping(size, fl, sl);
+  if (fl >= FL_COUNT) return NO_RANGE;
+
+  uint32_t slMap = slBitmaps[fl] & (~0U << sl);
+  if (slMap == 0U)
+  {
+    const uint64_t flMap = fl + 1U < FL_COUNT ? flBitmap & (~0ULL << (fl + 1U)) : 0U;
+    if (flMap == 0U) return NO_RANGE;
+    fl = static_cast<uint32_t>(std::countr_zero(flMap));
+    slMap = slBitmaps[fl];
+  }
+  sl = static_cast<uint32_t>(std::countr_zero(slMap));
+  return freeHeads[fl * SL_COUNT + sl];
+}
+
+void DeviceAllocator::Block::insertFree(uint32_t range)
+{
+  uint32_t fl, sl;
+  mapping(ranges[range].size, fl, sl);
+  uint32_t& head = freeHeads[fl * SL_COUNT + sl];
+
+  ranges[range].free = true;
+  ranges[range].prevFree = NO_RANGE;
+  ranges[range].nextFree = head;
+  if (head != NO_RANGE) ranges[head].prevFree = range;
+  head = range;
+
+  slBitmaps[fl] |= 1U << sl;
+  flBitmap |= 1ULL << fl;
+  freeBytes += ranges[range].size;
+}
+
+void DeviceAllocator::Block::removeFree(uint32_t range)
+{
+  uint32_t fl, sl;
+  mapping(ranges[range].size, fl, sl);
+  uint32_t& head = freeHeads[fl * SL_COUNT + sl];
+
+  if (ranges[range].prevFree != NO_RANGE) ranges[ranges[range].prevFree].nextFree = ranges[range].nextFree;
+  if (ranges[range].nextFree != NO_RANGE) ranges[ranges[range].nextFree].prevFree = ranges[range].prevFree;
+  if (head == range) head = ranges[range].nextFree;
+
+  if (head == NO_RANGE)
+  {
+    slBitmaps[fl] &= ~(1U << sl);
+    if (slBitmaps[fl] == 0U) flBitmap &= ~(1ULL << fl);
+  }
+
+  ranges[range].free = false;
+  freeBytes -= ranges[range].size;
+}
+
+uint32_t DeviceAllocator::Block::newRange(vk::DeviceSize offset, vk::DeviceSize size)
+{
+  uint32_t id;
+  if (!unusedRanges.empty())
+  {
+    id = unusedRanges.back();
+    unusedRanges.pop_back();
+  }
+  else
+  {
+    id = static_cast<uint32_t>(ranges.size());
+    ranges.emplace_back();
+  }
+  ranges[id] = Range{ .offset = offset, .size = size };
+  return id;
+}
@@ -0,0 +1,147 @@
+#ifndef DEVICE_ALLOCATOR_HPP
+#define DEVICE_ALLOCATOR_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// same include order as app.hpp, volk has to come before the C++ bindings
+#include <vulkan/vk_platform.h>
+#include <volk/volk.h>
+#include <vulkan/vulkan_raii.hpp>
+
+// memory blocks are this big unless the heap is small, resources over half a block get their own allocation
+constexpr vk::DeviceSize DEFAULT_DEVICE_BLOCK_SIZE = 64ULL * 1024ULL * 1024ULL;
+
+struct DeviceAllocatorStats {
+  uint32_t blocks = 0U; // live vkAllocateMemory calls, dedicated ones included
+  uint32_t dedicatedBlocks = 0U;
+  uint32_t allocations = 0U;
+  vk::DeviceSize bytesReserved = 0U;
+  vk::DeviceSize bytesInUse = 0U;
+  vk::DeviceSize largestFreeRange = 0U;
+  // 0 when all free space is one range, towards 1 as it splinters
+  float fragmentation = 0.0f;
+};
+
+class DeviceAllocator;
+
+// A sub-range of a device memory block, handed back to its allocator when destroyed or assigned nullptr
+// Host-visible blocks are mapped once for their lifetime, getMapped() already points at this range
+class DeviceAllocation
+{
+  public:
+  DeviceAllocation() = default;
+  DeviceAllocation(std::nullptr_t) {}
+  DeviceAllocation(DeviceAllocation&& other) noexcept;
+  DeviceAllocation& operator=(DeviceAllocation&& other) noexcept;
+  DeviceAllocation(const DeviceAllocation&) = delete;
+  DeviceAllocation& operator=(const DeviceAllocation&) = delete;
+  ~DeviceAllocation();
+
+  [[nodiscard]] vk::DeviceMemory getMemory() const { return memory; }
+  [[nodiscard]] vk::DeviceSize getOffset() const { return offset; }
+  [[nodiscard]] vk::DeviceSize getSize() const { return size; }
+  [[nodiscard]] void* getMapped() const { return mapped; }
+
+  private:
+  friend class DeviceAllocator;
+  void release();
+
+  DeviceAllocator* allocator = nullptr;
+  uint32_t pool = 0U;
+  uint32_t block = 0U;
+  uint32_t range = 0U;
+  vk::DeviceMemory memory = nullptr;
+  vk::DeviceSize offset = 0U;
+  vk::DeviceSize size = 0U;
+  void* mapped = nullptr;
+};
+
+// Sub-allocates resources out of large device memory blocks with a two-level segregated fit (TLSF) per block
+// There is a pool per memory type for linear resources (buffers) and another for optimal images,
+// so linear and optimal resources never share a block and bufferImageGranularity never applies
+// Every allocation has to be released before the allocator is destroyed
+class DeviceAllocator
+{
+  public:
+  DeviceAllocator(
+    const vk::raii::Device& device,
+    const vk::raii::PhysicalDevice& physicalDevice,
+    vk::DeviceSize blockSize = DEFAULT_DEVICE_BLOCK_SIZE
+  );
+  DeviceAllocator(const DeviceAllocator&) = delete;
+  DeviceAllocator& operator=(const DeviceAllocator&) = delete;
+  ~DeviceAllocator();
+
+  // linear is true for buffers and linear tiled images, false for optimal tiled images
+  [[nodiscard]] DeviceAllocation allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags properties, bool linear);
+
+  // first memory type allowed by typeFilter that has every one of properties
+  [[nodiscard]] uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+
+  [[nodiscard]] DeviceAllocatorStats getStats() const;
+
+  private:
+  friend class DeviceAllocation;
+
+  static constexpr uint32_t NO_RANGE = ~0U;
+  // second level splits each power of two into 16 buckets, sizes below 256 are bucketed linearly
+  static constexpr uint32_t SL_LOG2 = 4U;
+  static constexpr uint32_t SL_COUNT = 1U << SL_LOG2;
+  static constexpr uint32_t FL_COUNT = 64U;
+  static constexpr vk::DeviceSize MIN_RANGE = 16U;
+  static constexpr vk::DeviceSize SMALL_SIZE = MIN_RANGE * SL_COUNT;
+
+  struct Range {
+    vk::DeviceSize offset;
+    vk::DeviceSize size;
+    uint32_t prevPhysical = NO_RANGE;
+    uint32_t nextPhysical = NO_RANGE;
+    uint32_t prevFree = NO_RANGE;
+    uint32_t nextFree = NO_RANGE;
+    bool free = false;
+  };
+
+  struct Block {
+    vk::raii::DeviceMemory memory = nullptr;
+    std::byte* mapped = nullptr;
+    vk::DeviceSize capacity = 0U;
+    vk::DeviceSize freeBytes = 0U;
+    uint32_t allocations = 0U;
+    bool dedicated = false;
+
+    std::vector<Range> ranges;
+    std::vector<uint32_t> unusedRanges;
+    uint64_t flBitmap = 0U;
+    std::array<uint32_t, FL_COUNT> slBitmaps{};
+    std::array<uint32_t, FL_COUNT * SL_COUNT> freeHeads{};
+
+    [[nodiscard]] uint32_t allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+    void free(uint32_t range);
+    [[nodiscard]] uint32_t findFree(vk::DeviceSize size) const;
+    void insertFree(uint32_t range);
+    void removeFree(uint32_t range);
+    [[nodiscard]] uint32_t newRange(vk::DeviceSize offset, vk::DeviceSize size);
+  };
+
+  struct Pool {
+    uint32_t memoryTypeIndex = 0U;
+    vk::DeviceSize blockSize = 0U;
+    // freed slots stay as nullptr so allocations can keep indexing into this
+    std::vector<std::unique_ptr<Block>> blocks;
+  };
+
+  // size class of a free range: fl is the power of two (linear below SMALL_SIZE), sl the sixteenth within it
+  static void mapping(vk::DeviceSize size, uint32_t& fl, uint32_t& sl);
+  [[nodiscard]] std::unique_ptr<Block> createBlock(uint32_t memoryTypeIndex, vk::DeviceSize capacity, bool dedicated) const;
+  void free(const DeviceAllocation& allocation);
+
+  const vk::raii::Device& device;
+  vk::PhysicalDeviceMemoryProperties memoryProperties;
+  std::array<Pool, VK_MAX_MEMORY_TYPES * 2> pools;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "frustum_culler.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#if defined(__AVX__)
+#define FRUSTUM_CULLER_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLER_SSE2
+#include <emmintrin.h>
+#endif
+
+void FrustumCuller::resize(size_t boxCount)
+{
+  count = boxCount;
+  const size_t padded = (count + BATCH_SIZE - 1) / BATCH_SIZE * BATCH_SIZE;
+  for (auto* values : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ })
+  {
+    values->assign(padded, 0.0f);
+  }
+}
+
+void FrustumCuller::setBounds(size_t index, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+  minX[index] = boundsMin.x;
+  minY[index] = boundsMin.y;
+  minZ[index] = boundsMin.z;
+  maxX[index] = boundsMax.x;
+  maxY[index] = boundsMax.y;
+  maxZ[index] = boundsMax.z;
+}
+
+void FrustumCuller::cull(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& visible) const
+{
+  visible.clear();
+  for (size_t first = 0; first < count; first += BATCH_SIZE)
+  {
+    uint32_t inside = testBatch(planes, first);
+    // the padding of the last batch
+    if (count - first < BATCH_SIZE) inside &= (1U << (count - first)) - 1U;
+    for (; inside != 0U; inside &= inside - 1U)
+    {
+      visible.push_back(static_cast<uint32_t>(first + std::countr_zero(inside)));
+    }
+  }
+}
+
+// a box is outside a plane when its corner farthest along the plane's normal is behind it,
+// that corner takes the max of each axis where the normal is positive and the min where it is negative,
+// so the distance is the sum over the axes of the larger of normal * min and normal * max
+uint32_t FrustumCuller::testBatch(const std::array<glm::vec4, 6>& planes, size_t first) const
+{
+#if defined(FRUSTUM_CULLER_AVX)
+  const __m256 bxMin = _mm256_loadu_ps(&minX[first]);
+  const __m256 byMin = _mm256_loadu_ps(&minY[first]);
+  const __m256 bzMin = _mm256_loadu_ps(&minZ[first]);
+  const __m256 bxMax = _mm256_loadu_ps(&maxX[first]);
+  const __m256 byMax = _mm256_loadu_ps(&maxY[first]);
+  const __m256 bzMax = _mm256_loadu_ps(&maxZ[first]);
+  __m256 outside = _mm256_setzero_ps();
+  for (const glm::vec4& plane : planes)
+  {
+    const __m256 nx = _mm256_set1_ps(plane.x);
+    const __m256 ny = _mm256_set1_ps(plane.y);
+    const __m256 nz = _mm256_set1_ps(plane.z);
+    __m256 distance = _mm256_add_ps(
+      _mm256_max_ps(_mm256_mul_ps(nx, bxMin), _mm256_mul_ps(nx, bxMax)),
+      _mm256_max_ps(_mm256_mul_ps(ny, byMin), _mm256_mul_ps(ny, byMax))
+    );
+    distance = _mm256_add_ps(distance, _mm256_max_ps(_mm256_mul_ps(nz, bzMin), _mm256_mul_ps(nz, bzMax)));
+    distance = _mm256_add_ps(distance, _mm256_set1_ps(plane.w));
+    outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+  }
+  return ~static_cast<uint32_t>(_mm256_movemask_ps(outside)) & 0xFFU;
+#elif defined(FRUSTUM_CULLER_SSE2)
+  uint32_t inside = 0U;
+  for (size_t half = 0; half < BATCH_SIZE; half += 4)
+  {
+    const __m128 bxMin = _mm_loadu_ps(&minX[first + half]);
+    const __m128 byMin = _mm_loadu_ps(&minY[first + half]);
+    const __m128 bzMin = _mm_loadu_ps(&minZ[first + half]);
+    const __m128 bxMax = _mm_loadu_ps(&maxX[first + half]);
+    const __m128 byMax = _mm_loadu_ps(&maxY[first + half]);
+    const __m128 bzMax = _mm_loadu_ps(&maxZ[first + half]);
+    __m128 outside = _mm_setzero_ps();
+    for (const glm::vec4& plane : planes)
+    {
+      const __m128 nx = _mm_set1_ps(plane.x);
+      const __m128 ny = _mm_set1_ps(plane.y);
+      const __m128 nz = _mm_set1_ps(plane.z);
+      __m128 distance = _mm_add_ps(
+        _mm_max_ps(_mm_mul_ps(nx, bxMin), _mm_mul_ps(nx, bxMax)),
+        _mm_max_ps(_mm_mul_ps(ny, byMin), _mm_mul_ps(ny, byMax))
+      );
+      distance = _mm_add_ps(distance, _mm_max_ps(_mm_mul_ps(nz, bzMin), _mm_mul_ps(nz, bzMax)));
+      distance = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+    }
+    inside |= (~static_cast<uint32_t>(_mm_movemask_ps(outside)) & 0xFU) << half;
+  }
+  return inside;
+#else
+  uint32_t inside = 0U;
+  for (size_t lane = 0; lane < BATCH_SIZE; lane++)
+  {
+    const size_t i = first + lane;
+    bool outside = false;
+    for (const glm::vec4& plane : planes)
+    {
+      const float distance = std::max(plane.x * minX[i], plane.x * maxX[i]) +
+                             std::max(plane.y * minY[i], plane.y * maxY[i]) +
+                             std::max(plane.z * minZ[i], plane.z * maxZ[i]) + plane.w;
+      outside = outside || distance < 0.0f;
+    }
+    if (!outside) inside |= 1U << lane;
+  }
+  return inside;
+#endif
+}
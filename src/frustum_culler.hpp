@@ -0,0 +1,37 @@
+#ifndef FRUSTUM_CULLER_HPP
+#define FRUSTUM_CULLER_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// World space bounding boxes as a structure of arrays, tested against the six planes of a frustum eight at a time,
+// with AVX where the target has it, otherwise as two halves on SSE2
+// The arrays are padded to a whole batch of eight, the padding is never reported visible
+class FrustumCuller
+{
+  public:
+  static constexpr size_t BATCH_SIZE = 8;
+
+  // new boxes are a point at the origin until set
+  void resize(size_t boxCount);
+  void setBounds(size_t index, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+  // fills visible with the index of every box at least partly on the inner side of all the planes, in index order
+  // planes are normalised or not, xyz facing inwards, a point p is inside when dot(xyz, p) + w >= 0
+  void cull(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& visible) const;
+
+  [[nodiscard]] size_t size() const { return count; }
+
+  private:
+  // a bit per box of the batch starting at first, set when it is inside
+  [[nodiscard]] uint32_t testBatch(const std::array<glm::vec4, 6>& planes, size_t first) const;
+
+  size_t count = 0U;
+  std::vector<float> minX, minY, minZ;
+  std::vector<float> maxX, maxY, maxZ;
+};
+
+#endif
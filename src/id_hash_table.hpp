@@ -0,0 +1,71 @@
+#ifndef ID_HASH_TABLE_HPP
+#define ID_HASH_TABLE_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Open addressing hash table of uint32 ids, the keys themselves stay in the caller's arrays
+// Linear probing over a power of two capacity sized once to stay at most half full, so nothing is ever rehashed
+// Each slot keeps 32 bits of the hash next to its id, so most mismatches are rejected without touching the key
+class IdHashTable
+{
+  public:
+  static constexpr uint32_t EMPTY = ~0U;
+
+  explicit IdHashTable(size_t expected)
+  {
+    const size_t capacity = std::bit_ceil(std::max<size_t>(expected * 2, 16));
+    slots.assign(capacity, Slot{ .tag = 0U, .id = EMPTY });
+    mask = capacity - 1;
+  }
+
+  // id of an entry with an equal key, otherwise id itself after inserting it
+  template<typename Equal>
+  uint32_t findOrInsert(uint64_t hash, uint32_t id, Equal equal)
+  {
+    const uint32_t tag = static_cast<uint32_t>(hash >> 32);
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+      if (slots[slot].id == EMPTY)
+      {
+        slots[slot] = Slot{ .tag = tag, .id = id };
+        return id;
+      }
+      if (slots[slot].tag == tag && equal(slots[slot].id)) return slots[slot].id;
+    }
+  }
+
+  // entries may share a hash, probe visits all of them
+  void insert(uint64_t hash, uint32_t id)
+  {
+    size_t slot = hash & mask;
+    while (slots[slot].id != EMPTY) slot = (slot + 1) & mask;
+    slots[slot] = Slot{ .tag = static_cast<uint32_t>(hash >> 32), .id = id };
+  }
+
+  // calls visit(id) for each entry inserted with this hash (and the odd collision) until it returns true
+  template<typename Visit>
+  bool probe(uint64_t hash, Visit visit) const
+  {
+    const uint32_t tag = static_cast<uint32_t>(hash >> 32);
+    for (size_t slot = hash & mask; slots[slot].id != EMPTY; slot = (slot + 1) & mask)
+    {
+      if (slots[slot].tag == tag && visit(slots[slot].id)) return true;
+    }
+    return false;
+  }
+
+  private:
+  struct Slot {
+    uint32_t tag;
+    uint32_t id;
+  };
+
+  std::vector<Slot> slots;
+  size_t mask = 0U;
+};
+
+#endif
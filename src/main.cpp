@@ -9,12 +9,13 @@
 #include "app.hpp"
 
 
-int main()
+int main(int argc, char** argv)
 {
   App app;
 
   try
   {
+    app.parseArguments(std::span<char* const>(argv, static_cast<size_t>(argc)));
     app.run();
   }
   catch (const std::exception& e)
@@ -28,7 +29,6 @@ int main()
 #ifdef _WIN32
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance, LPSTR lpCmdLine, int nCmdShow)
 {
-    main();
-    return 0;
+    return main(__argc, __argv);
 }
 #endif
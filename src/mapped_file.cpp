@@ -0,0 +1,129 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+#ifdef _WIN32
+  fileHandle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (fileHandle == INVALID_HANDLE_VALUE)
+  {
+    fileHandle = nullptr;
+    throw std::runtime_error(std::string("failed to open ").append(path.string()));
+  }
+
+  LARGE_INTEGER size;
+  if (GetFileSizeEx(fileHandle, &size) == FALSE)
+  {
+    unmap();
+    throw std::runtime_error(std::string("failed to stat ").append(path.string()));
+  }
+  fileSize = static_cast<size_t>(size.QuadPart);
+
+  // zero-length files cannot be mapped, leave them as an empty view
+  if (fileSize == 0) return;
+
+  fileMapping = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (fileMapping == nullptr)
+  {
+    unmap();
+    throw std::runtime_error(std::string("failed to map ").append(path.string()));
+  }
+
+  pData = static_cast<const std::byte*>(MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0));
+  if (pData == nullptr)
+  {
+    unmap();
+    throw std::runtime_error(std::string("failed to map ").append(path.string()));
+  }
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    throw std::runtime_error(std::string("failed to open ").append(path.string()));
+  }
+
+  struct stat statInfo {};
+  if (fstat(fd, &statInfo) != 0)
+  {
+    close(fd);
+    throw std::runtime_error(std::string("failed to stat ").append(path.string()));
+  }
+  fileSize = static_cast<size_t>(statInfo.st_size);
+
+  // zero-length files cannot be mapped, leave them as an empty view
+  if (fileSize == 0)
+  {
+    close(fd);
+    return;
+  }
+
+  void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping holds its own reference to the file
+  close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    fileSize = 0;
+    throw std::runtime_error(std::string("failed to map ").append(path.string()));
+  }
+
+  // accessors are walked front to back, let the kernel read ahead
+  madvise(mapping, fileSize, MADV_SEQUENTIAL);
+  pData = static_cast<const std::byte*>(mapping);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+  : pData(std::exchange(other.pData, nullptr)),
+    fileSize(std::exchange(other.fileSize, 0))
+#ifdef _WIN32
+  , fileHandle(std::exchange(other.fileHandle, nullptr)),
+    fileMapping(std::exchange(other.fileMapping, nullptr))
+#endif
+{ }
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+  if (this != &other)
+  {
+    unmap();
+    pData = std::exchange(other.pData, nullptr);
+    fileSize = std::exchange(other.fileSize, 0);
+#ifdef _WIN32
+    fileHandle = std::exchange(other.fileHandle, nullptr);
+    fileMapping = std::exchange(other.fileMapping, nullptr);
+#endif
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile()
+{
+  unmap();
+}
+
+void MappedFile::unmap()
+{
+#ifdef _WIN32
+  if (pData != nullptr) UnmapViewOfFile(pData);
+  if (fileMapping != nullptr) CloseHandle(fileMapping);
+  if (fileHandle != nullptr) CloseHandle(fileHandle);
+  fileMapping = nullptr;
+  fileHandle = nullptr;
+#else
+  if (pData != nullptr) munmap(const_cast<std::byte*>(pData), fileSize);
+#endif
+  pData = nullptr;
+  fileSize = 0;
+}
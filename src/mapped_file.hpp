@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <filesystem>
+
+// Read-only view of a whole file, backed by the OS page cache rather than a heap copy
+// Move-only, the mapping is released when the owner is destroyed
+class MappedFile
+{
+  public:
+  MappedFile() = default;
+  explicit MappedFile(const std::filesystem::path& path);
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  ~MappedFile();
+
+  [[nodiscard]] const std::byte* data() const { return pData; }
+  [[nodiscard]] size_t size() const { return fileSize; }
+
+  private:
+  void unmap();
+
+  const std::byte* pData = nullptr;
+  size_t fileSize = 0;
+#ifdef _WIN32
+  // Windows keeps the file and mapping handles alive alongside the view
+  void* fileHandle = nullptr;
+  void* fileMapping = nullptr;
+#endif
+};
+
+#endif
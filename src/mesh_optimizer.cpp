@@ -0,0 +1,592 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+static constexpr uint32_t NO_VERTEX = ~0U;
+
+VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+  VertexCacheStats stats;
+  stats.triangles = indices.size() / 3;
+
+  // a vertex is in the fifo while fewer than cacheSize misses have happened since it was loaded
+  std::vector<uint32_t> cacheTime(vertexCount, 0U);
+  std::vector<bool> referenced(vertexCount, false);
+  uint32_t time = cacheSize + 1;
+  for (uint32_t index : indices)
+  {
+    if (!referenced[index])
+    {
+      referenced[index] = true;
+      stats.vertices++;
+    }
+    if (time - cacheTime[index] > cacheSize)
+    {
+      cacheTime[index] = time++;
+      stats.transformed++;
+    }
+  }
+  return stats;
+}
+
+void optimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount, std::vector<uint32_t>& clusters, uint32_t cacheSize)
+{
+  clusters.clear();
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) return;
+
+  // triangles around each vertex, packed one vertex after another
+  std::vector<uint32_t> offsets(vertexCount + 1, 0U);
+  for (uint32_t index : indices)
+  {
+    offsets[index + 1]++;
+  }
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  std::vector<uint32_t> adjacency(indices.size());
+  {
+    std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+      adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+  }
+
+  // triangles each vertex is still part of
+  std::vector<uint32_t> live(vertexCount);
+  for (uint32_t v = 0; v < vertexCount; v++)
+  {
+    live[v] = offsets[v + 1] - offsets[v];
+  }
+
+  std::vector<uint32_t> cacheTime(vertexCount, 0U);
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<uint32_t> deadEnds;
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  uint32_t time = cacheSize + 1;
+  uint32_t cursor = 0U;
+
+  // most recently touched vertex that still has triangles, else the next one in input order
+  auto skipDeadEnd = [&]()
+  {
+    while (!deadEnds.empty())
+    {
+      const uint32_t v = deadEnds.back();
+      deadEnds.pop_back();
+      if (live[v] > 0) return v;
+    }
+    for (; cursor < vertexCount; cursor++)
+    {
+      if (live[cursor] > 0) return cursor;
+    }
+    return NO_VERTEX;
+  };
+
+  uint32_t fan = skipDeadEnd();
+  clusters.push_back(0U);
+  while (fan != NO_VERTEX)
+  {
+    // emit every remaining triangle around the fanning vertex
+    candidates.clear();
+    for (uint32_t k = offsets[fan]; k < offsets[fan + 1]; k++)
+    {
+      const uint32_t t = adjacency[k];
+      if (emitted[t]) continue;
+      emitted[t] = true;
+
+      for (uint32_t corner = 0; corner < 3; corner++)
+      {
+        const uint32_t v = indices[t * 3 + corner];
+        result.push_back(v);
+        deadEnds.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+        if (time - cacheTime[v] > cacheSize)
+        {
+          cacheTime[v] = time++;
+        }
+      }
+    }
+
+    // the next fan is the candidate that will still be cached after its own triangles, and has been there longest
+    uint32_t next = NO_VERTEX;
+    int64_t bestPriority = -1;
+    for (uint32_t v : candidates)
+    {
+      if (live[v] == 0) continue;
+
+      int64_t priority = 0;
+      if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+      {
+        priority = time - cacheTime[v];
+      }
+      if (priority > bestPriority)
+      {
+        bestPriority = priority;
+        next = v;
+      }
+    }
+
+    if (next == NO_VERTEX)
+    {
+      next = skipDeadEnd();
+      if (next != NO_VERTEX) clusters.push_back(static_cast<uint32_t>(result.size() / 3));
+    }
+    fan = next;
+  }
+
+  std::ranges::copy(result, indices.begin());
+}
+
+void optimizeOverdraw(
+  std::span<uint32_t> indices,
+  std::span<const glm::vec3> positions,
+  std::span<const uint32_t> clusters,
+  uint32_t cacheSize,
+  float threshold
+)
+{
+  const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+  if (triangleCount == 0 || clusters.empty()) return;
+
+  std::vector<uint32_t> cacheTime(positions.size(), 0U);
+  uint32_t time = cacheSize + 1;
+  auto misses = [&](uint32_t t)
+  {
+    uint32_t count = 0U;
+    for (uint32_t corner = 0; corner < 3; corner++)
+    {
+      const uint32_t v = indices[t * 3 + corner];
+      if (time - cacheTime[v] > cacheSize)
+      {
+        cacheTime[v] = time++;
+        count++;
+      }
+    }
+    return count;
+  };
+
+  // cut each hard cluster as soon as the piece so far is nearly as cache efficient as the whole cluster
+  std::vector<uint32_t> cuts;
+  for (size_t c = 0; c < clusters.size(); c++)
+  {
+    const uint32_t begin = clusters[c];
+    const uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+    time += cacheSize + 1;
+    uint32_t clusterMisses = 0U;
+    for (uint32_t t = begin; t < end; t++)
+    {
+      clusterMisses += misses(t);
+    }
+    const float clusterAcmr = static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+    time += cacheSize + 1;
+    cuts.push_back(begin);
+    uint32_t start = begin;
+    uint32_t pieceMisses = 0U;
+    for (uint32_t t = begin; t < end; t++)
+    {
+      pieceMisses += misses(t);
+      if (t + 1 < end && static_cast<float>(pieceMisses) / static_cast<float>(t + 1 - start) <= clusterAcmr * threshold)
+      {
+        cuts.push_back(t + 1);
+        start = t + 1;
+        pieceMisses = 0U;
+        time += cacheSize + 1;
+      }
+    }
+  }
+
+  glm::vec3 meshCentroid(0.0f);
+  for (uint32_t index : indices)
+  {
+    meshCentroid += positions[index];
+  }
+  meshCentroid /= static_cast<float>(indices.size());
+
+  // pieces facing away from the middle of the mesh are likely to occlude the rest, so they go first
+  std::vector<float> sortKeys(cuts.size());
+  for (size_t c = 0; c < cuts.size(); c++)
+  {
+    const uint32_t end = c + 1 < cuts.size() ? cuts[c + 1] : triangleCount;
+    glm::vec3 centroid(0.0f);
+    glm::vec3 normal(0.0f);
+    float area = 0.0f;
+    for (uint32_t t = cuts[c]; t < end; t++)
+    {
+      const glm::vec3& a = positions[indices[t * 3 + 0]];
+      const glm::vec3& b = positions[indices[t * 3 + 1]];
+      const glm::vec3& d = positions[indices[t * 3 + 2]];
+      const glm::vec3 n = glm::cross(b - a, d - a);
+      const float triangleArea = glm::length(n);
+      centroid += (a + b + d) * (triangleArea / 3.0f);
+      normal += n;
+      area += triangleArea;
+    }
+    const float normalLength = glm::length(normal);
+    if (area <= 0.0f || normalLength <= 0.0f)
+    {
+      sortKeys[c] = 0.0f;
+      continue;
+    }
+    sortKeys[c] = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+  }
+
+  std::vector<uint32_t> order(cuts.size());
+  std::iota(order.begin(), order.end(), 0U);
+  std::ranges::stable_sort(order, [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  for (uint32_t c : order)
+  {
+    const uint32_t end = c + 1 < cuts.size() ? cuts[c + 1] : triangleCount;
+    result.insert(result.end(), indices.begin() + cuts[c] * 3, indices.begin() + end * 3);
+  }
+  std::ranges::copy(result, indices.begin());
+}
+
+static Meshlet computeMeshletBounds(std::span<const uint32_t> indices, std::span<const glm::vec3> positions, uint32_t indexOffset, uint32_t indexCount, uint32_t vertexCount)
+{
+  Meshlet meshlet {
+    .sphere = glm::vec4(0.0f),
+    .boundsMin = glm::vec3(std::numeric_limits<float>::max()),
+    .indexOffset = indexOffset,
+    .boundsMax = glm::vec3(std::numeric_limits<float>::lowest()),
+    .indexCount = indexCount,
+    .coneApex = glm::vec3(0.0f),
+    .coneCutoff = 2.0f,
+    .coneAxis = glm::vec3(0.0f, 0.0f, 1.0f),
+    .vertexCount = vertexCount
+  };
+
+  const auto triangles = indices.subspan(indexOffset, indexCount);
+  glm::vec3 normalSum(0.0f);
+  for (size_t i = 0; i < triangles.size(); i += 3)
+  {
+    const glm::vec3& a = positions[triangles[i]];
+    const glm::vec3& b = positions[triangles[i + 1]];
+    const glm::vec3& c = positions[triangles[i + 2]];
+    meshlet.boundsMin = glm::min(meshlet.boundsMin, glm::min(a, glm::min(b, c)));
+    meshlet.boundsMax = glm::max(meshlet.boundsMax, glm::max(a, glm::max(b, c)));
+
+    const glm::vec3 n = glm::cross(b - a, c - a);
+    const float length = glm::length(n);
+    if (length > 0.0f) normalSum += n / length;
+  }
+
+  const glm::vec3 centre = (meshlet.boundsMin + meshlet.boundsMax) * 0.5f;
+  float radius = 0.0f;
+  for (uint32_t index : triangles)
+  {
+    radius = std::max(radius, glm::length(positions[index] - centre));
+  }
+  meshlet.sphere = glm::vec4(centre, radius);
+
+  // the cone is the average normal widened to the furthest one, it only helps when every triangle is within 90 degrees
+  const float normalSumLength = glm::length(normalSum);
+  if (normalSumLength <= 0.0f) return meshlet;
+  const glm::vec3 axis = normalSum / normalSumLength;
+
+  float minDot = 1.0f;
+  for (size_t i = 0; i < triangles.size(); i += 3)
+  {
+    const glm::vec3& a = positions[triangles[i]];
+    const glm::vec3 n = glm::cross(positions[triangles[i + 1]] - a, positions[triangles[i + 2]] - a);
+    const float length = glm::length(n);
+    if (length > 0.0f) minDot = std::min(minDot, glm::dot(n / length, axis));
+  }
+  if (minDot <= 0.1f) return meshlet;
+
+  // the apex is pushed back along the axis until every triangle's plane is in front of it
+  float apexDistance = 0.0f;
+  for (size_t i = 0; i < triangles.size(); i += 3)
+  {
+    const glm::vec3& a = positions[triangles[i]];
+    const glm::vec3 n = glm::cross(positions[triangles[i + 1]] - a, positions[triangles[i + 2]] - a);
+    const float length = glm::length(n);
+    if (length <= 0.0f) continue;
+    const glm::vec3 normal = n / length;
+    apexDistance = std::max(apexDistance, glm::dot(centre - a, normal) / glm::dot(axis, normal));
+  }
+
+  meshlet.coneApex = centre - axis * apexDistance;
+  meshlet.coneAxis = axis;
+  meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+  return meshlet;
+}
+
+void buildMeshlets(std::span<const uint32_t> indices, std::span<const glm::vec3> positions, std::vector<Meshlet>& meshlets)
+{
+  // a vertex is in the current meshlet when its stamp is the meshlet's
+  std::vector<uint32_t> stamps(positions.size(), 0U);
+  uint32_t stamp = 1U;
+  uint32_t begin = 0U;
+  uint32_t vertexCount = 0U;
+
+  for (uint32_t i = 0; i + 2 < indices.size(); i += 3)
+  {
+    uint32_t newVertices = 0U;
+    for (uint32_t corner = 0; corner < 3; corner++)
+    {
+      const uint32_t v = indices[i + corner];
+      // a repeated vertex within the triangle only counts once
+      const bool repeated = (corner > 0 && indices[i] == v) || (corner > 1 && indices[i + 1] == v);
+      if (stamps[v] != stamp && !repeated) newVertices++;
+    }
+
+    if (vertexCount + newVertices > MESHLET_MAX_VERTICES || (i - begin) / 3 == MESHLET_MAX_TRIANGLES)
+    {
+      meshlets.push_back(computeMeshletBounds(indices, positions, begin, i - begin, vertexCount));
+      begin = i;
+      vertexCount = 0U;
+      stamp++;
+    }
+
+    for (uint32_t corner = 0; corner < 3; corner++)
+    {
+      const uint32_t v = indices[i + corner];
+      if (stamps[v] != stamp)
+      {
+        stamps[v] = stamp;
+        vertexCount++;
+      }
+    }
+  }
+
+  const uint32_t end = static_cast<uint32_t>(indices.size() / 3 * 3);
+  if (end > begin)
+  {
+    meshlets.push_back(computeMeshletBounds(indices, positions, begin, end - begin, vertexCount));
+  }
+}
+
+// symmetric 4x4 matrix summing squared distances to planes, in doubles as it accumulates many tiny planes
+// the weights are summed alongside, so the error is a weighted mean squared distance and stays in the units of
+// positions squared whatever the weights and however many planes went in
+struct Quadric {
+  double xx = 0.0, xy = 0.0, xz = 0.0, xw = 0.0;
+  double yy = 0.0, yz = 0.0, yw = 0.0;
+  double zz = 0.0, zw = 0.0;
+  double ww = 0.0;
+  double weight = 0.0;
+
+  void addPlane(const glm::dvec3& n, double d, double weight)
+  {
+    xx += weight * n.x * n.x; xy += weight * n.x * n.y; xz += weight * n.x * n.z; xw += weight * n.x * d;
+    yy += weight * n.y * n.y; yz += weight * n.y * n.z; yw += weight * n.y * d;
+    zz += weight * n.z * n.z; zw += weight * n.z * d;
+    ww += weight * d * d;
+    this->weight += weight;
+  }
+
+  Quadric& operator+=(const Quadric& other)
+  {
+    xx += other.xx; xy += other.xy; xz += other.xz; xw += other.xw;
+    yy += other.yy; yz += other.yz; yw += other.yw;
+    zz += other.zz; zw += other.zw;
+    ww += other.ww;
+    weight += other.weight;
+    return *this;
+  }
+
+  [[nodiscard]] double evaluate(const glm::dvec3& p) const
+  {
+    if (weight <= 0.0) return 0.0;
+    const double sum = xx * p.x * p.x + 2.0 * xy * p.x * p.y + 2.0 * xz * p.x * p.z + 2.0 * xw * p.x
+                     + yy * p.y * p.y + 2.0 * yz * p.y * p.z + 2.0 * yw * p.y
+                     + zz * p.z * p.z + 2.0 * zw * p.z
+                     + ww;
+    return sum / weight;
+  }
+};
+
+std::vector<uint32_t> simplifyMesh(
+  std::span<const uint32_t> indices,
+  std::span<const glm::vec3> positions,
+  size_t targetIndexCount,
+  float maxError,
+  float& error
+)
+{
+  const uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+  std::vector<uint32_t> result(indices.begin(), indices.end() - indices.size() % 3);
+  error = 0.0f;
+
+  // an edge used by anything other than two triangles is a border or a seam, its vertices stay put
+  std::vector<std::pair<uint32_t, uint32_t>> edges;
+  edges.reserve(result.size());
+  for (size_t i = 0; i < result.size(); i += 3)
+  {
+    for (uint32_t corner = 0; corner < 3; corner++)
+    {
+      const uint32_t a = result[i + corner];
+      const uint32_t b = result[i + (corner + 1) % 3];
+      edges.emplace_back(std::min(a, b), std::max(a, b));
+    }
+  }
+  std::ranges::sort(edges);
+  std::vector<bool> locked(vertexCount, false);
+  for (size_t i = 0; i < edges.size();)
+  {
+    size_t j = i;
+    while (j < edges.size() && edges[j] == edges[i]) j++;
+    if (j - i != 2)
+    {
+      locked[edges[i].first] = true;
+      locked[edges[i].second] = true;
+    }
+    i = j;
+  }
+
+  std::vector<Quadric> quadrics(vertexCount);
+  for (size_t i = 0; i < result.size(); i += 3)
+  {
+    const glm::dvec3 a = positions[result[i]];
+    const glm::dvec3 b = positions[result[i + 1]];
+    const glm::dvec3 c = positions[result[i + 2]];
+    const glm::dvec3 n = glm::cross(b - a, c - a);
+    const double length = glm::length(n);
+    if (length <= 0.0) continue;
+
+    // area weighted, so big flat faces count for more than slivers in the mean around a vertex
+    Quadric quadric;
+    quadric.addPlane(n / length, -glm::dot(n / length, a), length * 0.5);
+    for (uint32_t corner = 0; corner < 3; corner++)
+    {
+      quadrics[result[i + corner]] += quadric;
+    }
+  }
+
+  struct Collapse {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+  };
+  std::vector<Collapse> collapses;
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> adjacency;
+  std::vector<uint32_t> remap(vertexCount);
+  std::vector<bool> touched(vertexCount);
+  const double maxCost = static_cast<double>(maxError) * static_cast<double>(maxError);
+  double worstCost = 0.0;
+
+  // every pass collapses the cheapest edges that share no vertex, then the triangles are rebuilt
+  while (result.size() > targetIndexCount)
+  {
+    offsets.assign(vertexCount + 1, 0U);
+    for (uint32_t index : result)
+    {
+      offsets[index + 1]++;
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    adjacency.resize(result.size());
+    {
+      std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+      for (size_t i = 0; i < result.size(); i++)
+      {
+        adjacency[cursor[result[i]]++] = static_cast<uint32_t>(i / 3);
+      }
+    }
+
+    edges.clear();
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+      for (uint32_t corner = 0; corner < 3; corner++)
+      {
+        const uint32_t a = result[i + corner];
+        const uint32_t b = result[i + (corner + 1) % 3];
+        edges.emplace_back(std::min(a, b), std::max(a, b));
+      }
+    }
+    std::ranges::sort(edges);
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    collapses.clear();
+    for (auto [a, b] : edges)
+    {
+      Quadric quadric = quadrics[a];
+      quadric += quadrics[b];
+      const double costToB = locked[a] ? std::numeric_limits<double>::max() : quadric.evaluate(positions[b]);
+      const double costToA = locked[b] ? std::numeric_limits<double>::max() : quadric.evaluate(positions[a]);
+      if (locked[a] && locked[b]) continue;
+      if (costToB <= costToA)
+        collapses.push_back({ std::max(costToB, 0.0), a, b });
+      else
+        collapses.push_back({ std::max(costToA, 0.0), b, a });
+    }
+    std::ranges::sort(collapses, [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+    std::iota(remap.begin(), remap.end(), 0U);
+    touched.assign(vertexCount, false);
+    size_t remaining = result.size() / 3;
+    size_t collapsed = 0U;
+    for (const Collapse& collapse : collapses)
+    {
+      if (remaining * 3 <= targetIndexCount || collapse.cost > maxCost) break;
+      if (touched[collapse.from] || touched[collapse.to]) continue;
+
+      // no triangle around the vertex that moves may fold over, the ones on the edge itself disappear
+      bool flips = false;
+      size_t disappearing = 0U;
+      for (uint32_t k = offsets[collapse.from]; k < offsets[collapse.from + 1] && !flips; k++)
+      {
+        const uint32_t t = adjacency[k];
+        const std::array<uint32_t, 3> corners = { remap[result[t * 3]], remap[result[t * 3 + 1]], remap[result[t * 3 + 2]] };
+        if (std::ranges::find(corners, collapse.to) != corners.end())
+        {
+          disappearing++;
+          continue;
+        }
+        if (corners[0] == corners[1] || corners[1] == corners[2] || corners[0] == corners[2]) continue;
+
+        std::array<glm::vec3, 3> before, after;
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+          before[corner] = positions[corners[corner]];
+          after[corner] = positions[corners[corner] == collapse.from ? collapse.to : corners[corner]];
+        }
+        const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+        const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+        // turning a face by more than about 75 degrees counts too, small tilts add up over the passes,
+        // and so does squashing it into a sliver thinner than 1:100
+        const float longest = std::max({ glm::length(after[1] - after[0]), glm::length(after[2] - after[1]), glm::length(after[0] - after[2]) });
+        const float areaAfter = glm::length(normalAfter);
+        flips = glm::dot(normalBefore, normalAfter) <= 0.25f * glm::length(normalBefore) * areaAfter
+             || areaAfter <= 1e-2f * longest * longest;
+      }
+      if (flips) continue;
+
+      remap[collapse.from] = collapse.to;
+      touched[collapse.from] = true;
+      touched[collapse.to] = true;
+      quadrics[collapse.to] += quadrics[collapse.from];
+      worstCost = std::max(worstCost, collapse.cost);
+      remaining -= std::min(remaining, disappearing);
+      collapsed++;
+    }
+    if (collapsed == 0U) break;
+
+    size_t kept = 0U;
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+      const uint32_t a = remap[result[i]];
+      const uint32_t b = remap[result[i + 1]];
+      const uint32_t c = remap[result[i + 2]];
+      if (a == b || b == c || a == c) continue;
+      result[kept++] = a;
+      result[kept++] = b;
+      result[kept++] = c;
+    }
+    result.resize(kept);
+  }
+
+  error = static_cast<float>(std::sqrt(worstCost));
+  return result;
+}
@@ -0,0 +1,97 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// FIFO size the optimizer targets and the stats simulate, about what current hardware reuses across
+constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+// overdraw clusters are split further while that costs less than this much vertex cache efficiency
+constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+// meshlet limits, the usual mesh shader sizes so the same clusters would suit a VK_EXT_mesh_shader path
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// levels of detail per primitive, the original indices included
+constexpr uint32_t MAX_LOD_LEVELS = 5;
+
+// a simplified copy of a primitive's indices, drawn against its vertices in place of the originals
+struct LodLevel {
+  uint32_t firstIndex;
+  uint32_t indexCount;
+  float error; // furthest the surface moved from the original, in the units of the positions
+};
+
+// A run of a primitive's triangles that is culled and drawn on its own
+// Laid out like a std430 struct so an array of them can be copied into a storage buffer as is
+struct Meshlet {
+  glm::vec4 sphere; // centre and radius
+  glm::vec3 boundsMin;
+  uint32_t indexOffset; // from the primitive's firstIndex
+  glm::vec3 boundsMax;
+  uint32_t indexCount;
+  // backfacing when dot(normalize(coneApex - camera), coneAxis) >= coneCutoff, a cutoff over 1 never culls
+  glm::vec3 coneApex;
+  float coneCutoff;
+  glm::vec3 coneAxis;
+  uint32_t vertexCount;
+};
+static_assert(sizeof(Meshlet) == 80, "Meshlet must match its std430 layout");
+
+// transformed vertices of a FIFO cache simulation, for ACMR (per triangle) and ATVR (per referenced vertex)
+struct VertexCacheStats {
+  uint64_t triangles = 0U;
+  uint64_t vertices = 0U;
+  uint64_t transformed = 0U;
+
+  [[nodiscard]] float acmr() const { return triangles == 0U ? 0.0f : static_cast<float>(transformed) / static_cast<float>(triangles); }
+  [[nodiscard]] float atvr() const { return vertices == 0U ? 0.0f : static_cast<float>(transformed) / static_cast<float>(vertices); }
+
+  VertexCacheStats& operator+=(const VertexCacheStats& other)
+  {
+    triangles += other.triangles;
+    vertices += other.vertices;
+    transformed += other.transformed;
+    return *this;
+  }
+};
+
+// indices are a triangle list into [0, vertexCount)
+[[nodiscard]] VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Tipsify (Sander, Nehab and Barczak 2007), reorders triangles in place for post-transform cache reuse
+// clusters gets the first triangle of each run that started at a dead end, where overdraw sorting may cut
+void optimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount, std::vector<uint32_t>& clusters, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// splits the Tipsify clusters where it costs little cache reuse, then orders them outside-in so occluders draw first
+void optimizeOverdraw(
+  std::span<uint32_t> indices,
+  std::span<const glm::vec3> positions,
+  std::span<const uint32_t> clusters,
+  uint32_t cacheSize = VERTEX_CACHE_SIZE,
+  float threshold = OVERDRAW_THRESHOLD
+);
+
+// splits a triangle list into consecutive runs of at most MESHLET_MAX_VERTICES and MESHLET_MAX_TRIANGLES, appended to meshlets
+// the runs follow the existing triangle order, so run this after optimizeVertexCache to keep them compact
+void buildMeshlets(std::span<const uint32_t> indices, std::span<const glm::vec3> positions, std::vector<Meshlet>& meshlets);
+
+// Quadric error metric simplification (Garland and Heckbert 1997), edges collapse onto one of their own vertices
+// so every level draws from the same vertex range; vertices on open or non-manifold edges never move,
+// which keeps borders and uv seams closed
+// stops at targetIndexCount or before any collapse would move the surface further than maxError,
+// error gets the furthest it did move, in the units of positions, each move measured as the root of the
+// area weighted mean squared distance to the original planes around the vertex
+[[nodiscard]] std::vector<uint32_t> simplifyMesh(
+  std::span<const uint32_t> indices,
+  std::span<const glm::vec3> positions,
+  size_t targetIndexCount,
+  float maxError,
+  float& error
+);
+
+#endif
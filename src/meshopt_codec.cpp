@@ -0,0 +1,504 @@
+#include "meshopt_codec.hpp"
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHOPT_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+// bitstream constants, as the extension specifies them
+constexpr uint8_t VERTEX_HEADER = 0xa0;
+constexpr uint8_t TRIANGLES_HEADER = 0xe0;
+constexpr uint8_t INDICES_HEADER = 0xd0;
+constexpr size_t BYTE_GROUP_SIZE = 16;
+// a group reads at most 24 bytes (8 of 4-bit values and 16 escaped bytes), encoders pad the stream so this much is always left
+constexpr size_t BYTE_GROUP_DECODE_LIMIT = 24;
+constexpr size_t VERTEX_BLOCK_SIZE_BYTES = 8192;
+constexpr size_t VERTEX_BLOCK_MAX_SIZE = 256;
+constexpr size_t VERTEX_TAIL_MIN_SIZE = 32;
+
+// vertices per block, the most whose bytes fit VERTEX_BLOCK_SIZE_BYTES in whole groups
+static size_t vertexBlockSize(size_t stride)
+{
+  const size_t size = (VERTEX_BLOCK_SIZE_BYTES / stride) & ~(BYTE_GROUP_SIZE - 1);
+  return size < VERTEX_BLOCK_MAX_SIZE ? size : VERTEX_BLOCK_MAX_SIZE;
+}
+
+#ifndef MESHOPT_CODEC_SSE2
+// sixteen values of 2 or 4 bits, most significant first, where all ones escapes to the next byte after them
+static const uint8_t* decodeGroupScalar(const uint8_t* data, uint8_t* out, int bits)
+{
+  const size_t packed = BYTE_GROUP_SIZE * bits / 8;
+  const uint8_t escape = static_cast<uint8_t>((1 << bits) - 1);
+  const uint8_t* escaped = data + packed;
+  for (size_t i = 0; i < BYTE_GROUP_SIZE; i++)
+  {
+    const int shift = 8 - bits - static_cast<int>(i * bits % 8);
+    const uint8_t value = (data[i * bits / 8] >> shift) & escape;
+    out[i] = value == escape ? *escaped++ : value;
+  }
+  return escaped;
+}
+#endif
+
+static const uint8_t* decodeGroup(const uint8_t* data, uint8_t* out, int mode)
+{
+  switch (mode)
+  {
+    case 0:
+      std::memset(out, 0, BYTE_GROUP_SIZE);
+      return data;
+    case 3:
+      std::memcpy(out, data, BYTE_GROUP_SIZE);
+      return data + BYTE_GROUP_SIZE;
+  }
+
+#ifdef MESHOPT_CODEC_SSE2
+  // every byte spread over the lanes of its values, then each lane shifted down by its own amount;
+  // 16-bit shifts leak the neighbouring byte into the high bits, which the masks clear
+  __m128i values;
+  int32_t packed;
+  if (mode == 1)
+  {
+    std::memcpy(&packed, data, sizeof(packed));
+    __m128i spread = _mm_cvtsi32_si128(packed);
+    spread = _mm_unpacklo_epi8(spread, spread);
+    spread = _mm_unpacklo_epi16(spread, spread);
+    const __m128i lane = _mm_set1_epi32(0x03);
+    values = _mm_or_si128(
+      _mm_or_si128(_mm_and_si128(_mm_srli_epi16(spread, 6), lane), _mm_and_si128(_mm_srli_epi16(spread, 4), _mm_slli_si128(lane, 1))),
+      _mm_or_si128(_mm_and_si128(_mm_srli_epi16(spread, 2), _mm_slli_si128(lane, 2)), _mm_and_si128(spread, _mm_slli_si128(lane, 3)))
+    );
+  }
+  else
+  {
+    __m128i spread = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+    spread = _mm_unpacklo_epi8(spread, spread);
+    const __m128i lane = _mm_set1_epi16(0x0f);
+    values = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(spread, 4), lane), _mm_and_si128(spread, _mm_slli_si128(lane, 1)));
+  }
+  // escaped lanes are patched from the bytes after the packed values, in lane order
+  const __m128i escape = _mm_set1_epi8(static_cast<char>(mode == 1 ? 0x03 : 0x0f));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), values);
+  const uint8_t* escaped = data + (mode == 1 ? 4 : 8);
+  for (uint32_t lanes = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(values, escape))); lanes != 0; lanes &= lanes - 1)
+  {
+    out[std::countr_zero(lanes)] = *escaped++;
+  }
+  return escaped;
+#else
+  return decodeGroupScalar(data, out, mode == 1 ? 2 : 4);
+#endif
+}
+
+// one byte of every vertex in a block, as 2-bit modes for each group of 16 followed by the groups
+static const uint8_t* decodeBytes(const uint8_t* data, const uint8_t* end, uint8_t* out, size_t count)
+{
+  const size_t groups = count / BYTE_GROUP_SIZE;
+  const size_t headerSize = (groups + 3) / 4;
+  if (static_cast<size_t>(end - data) < headerSize) return nullptr;
+  const uint8_t* header = data;
+  data += headerSize;
+  for (size_t group = 0; group < groups; group++)
+  {
+    if (static_cast<size_t>(end - data) < BYTE_GROUP_DECODE_LIMIT) return nullptr;
+    const int mode = (header[group / 4] >> ((group % 4) * 2)) & 3;
+    data = decodeGroup(data, out + group * BYTE_GROUP_SIZE, mode);
+  }
+  return data;
+}
+
+// zigzag deltas from the previous vertex's byte, back to bytes
+static void undoDeltas(uint8_t* column, size_t count, uint8_t previous)
+{
+  size_t i = 0;
+#ifdef MESHOPT_CODEC_SSE2
+  const __m128i one = _mm_set1_epi8(1);
+  const __m128i low = _mm_set1_epi8(0x7f);
+  __m128i carry = _mm_set1_epi8(static_cast<char>(previous));
+  for (; i + BYTE_GROUP_SIZE <= count; i += BYTE_GROUP_SIZE)
+  {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(column + i));
+    v = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(v, 1), low), _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(v, one)));
+    // running sum over the sixteen lanes in four shifted adds
+    v = _mm_add_epi8(v, _mm_slli_si128(v, 1));
+    v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+    v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+    v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+    v = _mm_add_epi8(v, carry);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(column + i), v);
+    // the last lane carries into the next group
+    v = _mm_unpackhi_epi8(v, v);
+    v = _mm_unpackhi_epi16(v, v);
+    carry = _mm_shuffle_epi32(v, 0xff);
+  }
+  if (i > 0) previous = column[i - 1];
+#endif
+  for (; i < count; i++)
+  {
+    const uint8_t delta = static_cast<uint8_t>((column[i] >> 1) ^ -(column[i] & 1));
+    previous = static_cast<uint8_t>(previous + delta);
+    column[i] = previous;
+  }
+}
+
+// byte columns of a block back to interleaved vertices
+static void interleave(const uint8_t* columns, size_t columnSize, size_t count, size_t stride, std::byte* out)
+{
+#ifdef MESHOPT_CODEC_SSE2
+  // four columns of sixteen vertices at a time, transposed to sixteen runs of four bytes
+  for (size_t k = 0; k < stride; k += 4)
+  {
+    for (size_t i = 0; i < count; i += BYTE_GROUP_SIZE)
+    {
+      const __m128i c0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + k * columnSize + i));
+      const __m128i c1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + (k + 1) * columnSize + i));
+      const __m128i c2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + (k + 2) * columnSize + i));
+      const __m128i c3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + (k + 3) * columnSize + i));
+      const __m128i pairsLow = _mm_unpacklo_epi8(c0, c1);
+      const __m128i pairsHigh = _mm_unpackhi_epi8(c0, c1);
+      const __m128i pairsLow2 = _mm_unpacklo_epi8(c2, c3);
+      const __m128i pairsHigh2 = _mm_unpackhi_epi8(c2, c3);
+      alignas(16) uint8_t quads[BYTE_GROUP_SIZE * 4];
+      _mm_store_si128(reinterpret_cast<__m128i*>(quads), _mm_unpacklo_epi16(pairsLow, pairsLow2));
+      _mm_store_si128(reinterpret_cast<__m128i*>(quads + 16), _mm_unpackhi_epi16(pairsLow, pairsLow2));
+      _mm_store_si128(reinterpret_cast<__m128i*>(quads + 32), _mm_unpacklo_epi16(pairsHigh, pairsHigh2));
+      _mm_store_si128(reinterpret_cast<__m128i*>(quads + 48), _mm_unpackhi_epi16(pairsHigh, pairsHigh2));
+      const size_t runs = count - i < BYTE_GROUP_SIZE ? count - i : BYTE_GROUP_SIZE;
+      for (size_t v = 0; v < runs; v++)
+      {
+        std::memcpy(out + (i + v) * stride + k, quads + v * 4, 4);
+      }
+    }
+  }
+#else
+  for (size_t k = 0; k < stride; k++)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      out[i * stride + k] = static_cast<std::byte>(columns[k * columnSize + i]);
+    }
+  }
+#endif
+}
+
+bool decodeMeshoptVertices(std::byte* out, size_t count, size_t stride, std::span<const std::byte> in)
+{
+  if (stride == 0 || stride > 256 || stride % 4 != 0) return false;
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(in.data());
+  const uint8_t* end = data + in.size();
+  if (in.size() < 1 + stride || (*data & 0xf0) != VERTEX_HEADER || (*data & 0x0f) > 0) return false;
+  data++;
+
+  // deltas start from the first vertex, stored at the very end of the stream
+  std::array<uint8_t, 256> last;
+  std::memcpy(last.data(), end - stride, stride);
+
+  alignas(16) std::array<uint8_t, VERTEX_BLOCK_SIZE_BYTES> columns;
+  const size_t blockSize = vertexBlockSize(stride);
+  for (size_t first = 0; first < count; first += blockSize)
+  {
+    const size_t blockCount = count - first < blockSize ? count - first : blockSize;
+    const size_t columnSize = (blockCount + BYTE_GROUP_SIZE - 1) & ~(BYTE_GROUP_SIZE - 1);
+    for (size_t k = 0; k < stride; k++)
+    {
+      uint8_t* column = columns.data() + k * columnSize;
+      data = decodeBytes(data, end, column, columnSize);
+      if (data == nullptr) return false;
+      undoDeltas(column, blockCount, last[k]);
+      last[k] = column[blockCount - 1];
+    }
+    interleave(columns.data(), columnSize, blockCount, stride, out + first * stride);
+  }
+
+  // what is left is the padding and the first vertex
+  const size_t tailSize = stride < VERTEX_TAIL_MIN_SIZE ? VERTEX_TAIL_MIN_SIZE : stride;
+  return static_cast<size_t>(end - data) == tailSize;
+}
+
+static void writeIndex(std::byte* out, size_t i, size_t indexSize, uint32_t index)
+{
+  if (indexSize == 2)
+  {
+    const uint16_t narrow = static_cast<uint16_t>(index);
+    std::memcpy(out + i * 2, &narrow, sizeof(narrow));
+  }
+  else
+  {
+    std::memcpy(out + i * 4, &index, sizeof(index));
+  }
+}
+
+// 7 bits per byte, low first, the high bit set on every byte but the last
+static uint32_t decodeVByte(const uint8_t*& data)
+{
+  const uint8_t lead = *data++;
+  if (lead < 128) return lead;
+  uint32_t result = lead & 127U;
+  uint32_t shift = 7;
+  for (int i = 0; i < 4; i++)
+  {
+    const uint8_t group = *data++;
+    result |= static_cast<uint32_t>(group & 127U) << shift;
+    shift += 7;
+    if (group < 128) break;
+  }
+  return result;
+}
+
+static uint32_t unzigzag(uint32_t v)
+{
+  return (v >> 1) ^ (0U - (v & 1U));
+}
+
+bool decodeMeshoptTriangles(std::byte* out, size_t count, size_t indexSize, std::span<const std::byte> in)
+{
+  if (count % 3 != 0 || (indexSize != 2 && indexSize != 4)) return false;
+  // at least the header, a code per triangle and the 16-byte table of auxiliary codes
+  if (in.size() < 1 + count / 3 + 16) return false;
+  const uint8_t* buffer = reinterpret_cast<const uint8_t*>(in.data());
+  if ((buffer[0] & 0xf0) != TRIANGLES_HEADER) return false;
+  const int version = buffer[0] & 0x0f;
+  if (version > 1) return false;
+
+  // recently seen edges and vertices, the codes refer back into these
+  std::array<std::array<uint32_t, 2>, 16> edges;
+  std::array<uint32_t, 16> recent;
+  edges.fill({ ~0U, ~0U });
+  recent.fill(~0U);
+  size_t edgeOffset = 0;
+  size_t recentOffset = 0;
+  auto pushEdge = [&](uint32_t a, uint32_t b)
+  {
+    edges[edgeOffset] = { a, b };
+    edgeOffset = (edgeOffset + 1) & 15;
+  };
+  auto pushVertex = [&](uint32_t v, bool advance = true)
+  {
+    recent[recentOffset] = v;
+    recentOffset = (recentOffset + (advance ? 1 : 0)) & 15;
+  };
+
+  uint32_t next = 0;
+  uint32_t last = 0;
+  const int recentLimit = version >= 1 ? 13 : 15;
+  const uint8_t* code = buffer + 1;
+  const uint8_t* data = code + count / 3;
+  const uint8_t* safeEnd = buffer + in.size() - 16;
+  const uint8_t* auxTable = safeEnd;
+  for (size_t i = 0; i < count; i += 3)
+  {
+    // a triangle reads at most 16 bytes, which the table after the data leaves room for
+    if (data > safeEnd) return false;
+    const uint8_t codeTri = *code++;
+    uint32_t a, b, c;
+    if (codeTri < 0xf0)
+    {
+      // a recent edge and a third vertex: new, recent, or one away from the last free index
+      const std::array<uint32_t, 2> edge = edges[(edgeOffset - 1 - (codeTri >> 4)) & 15];
+      a = edge[0];
+      b = edge[1];
+      const int fec = codeTri & 15;
+      if (fec < recentLimit)
+      {
+        c = fec == 0 ? next++ : recent[(recentOffset - 1 - fec) & 15];
+        pushVertex(c, fec == 0);
+      }
+      else
+      {
+        // 13 and 14 step -1 and +1 from the last free index, 15 reads one
+        c = last = fec != 15 ? last + static_cast<uint32_t>(fec - (fec ^ 3)) : last + unzigzag(decodeVByte(data));
+        pushVertex(c);
+      }
+      pushEdge(c, b);
+      pushEdge(a, c);
+      writeIndex(out, i, indexSize, a);
+      writeIndex(out, i + 1, indexSize, b);
+      writeIndex(out, i + 2, indexSize, c);
+      continue;
+    }
+
+    // no edge to reuse, the code or an auxiliary byte picks each vertex
+    const bool tabled = codeTri < 0xfe;
+    const uint8_t codeAux = tabled ? auxTable[codeTri & 15] : *data++;
+    const int fea = tabled || codeTri == 0xfe ? 0 : 15;
+    const int feb = codeAux >> 4;
+    const int fec = codeAux & 15;
+    if (!tabled && codeAux == 0) next = 0;
+
+    a = fea == 0 ? next++ : 0U;
+    b = feb == 0 ? next++ : recent[(recentOffset - feb) & 15];
+    c = fec == 0 ? next++ : recent[(recentOffset - fec) & 15];
+    if (fea == 15) a = last = last + unzigzag(decodeVByte(data));
+    if (feb == 15) b = last = last + unzigzag(decodeVByte(data));
+    if (fec == 15) c = last = last + unzigzag(decodeVByte(data));
+
+    pushVertex(a);
+    pushVertex(b, feb == 0 || feb == 15);
+    pushVertex(c, fec == 0 || fec == 15);
+    pushEdge(b, a);
+    pushEdge(c, b);
+    pushEdge(a, c);
+    writeIndex(out, i, indexSize, a);
+    writeIndex(out, i + 1, indexSize, b);
+    writeIndex(out, i + 2, indexSize, c);
+  }
+
+  // every data byte read, up to the table
+  return data == safeEnd;
+}
+
+bool decodeMeshoptIndices(std::byte* out, size_t count, size_t indexSize, std::span<const std::byte> in)
+{
+  if (indexSize != 2 && indexSize != 4) return false;
+  // at least the header, a byte per index and the 4-byte tail
+  if (in.size() < 1 + count + 4) return false;
+  const uint8_t* buffer = reinterpret_cast<const uint8_t*>(in.data());
+  if ((buffer[0] & 0xf0) != INDICES_HEADER || (buffer[0] & 0x0f) > 1) return false;
+
+  // each index is a delta from one of two baselines, picked by its lowest bit
+  const uint8_t* data = buffer + 1;
+  const uint8_t* safeEnd = buffer + in.size() - 4;
+  std::array<uint32_t, 2> last = { 0U, 0U };
+  for (size_t i = 0; i < count; i++)
+  {
+    // an index reads at most 5 bytes, which the tail leaves room for
+    if (data >= safeEnd) return false;
+    const uint32_t v = decodeVByte(data);
+    const uint32_t baseline = v & 1U;
+    last[baseline] += unzigzag(v >> 1);
+    writeIndex(out, i, indexSize, last[baseline]);
+  }
+  return data == safeEnd;
+}
+
+template <typename T>
+static void unfilterOctahedral(T* data, size_t count)
+{
+  // z is stored as the value 1.0 encodes to, so the other two can be taken off it
+  constexpr float one = static_cast<float>((1 << (sizeof(T) * 8 - 1)) - 1);
+  size_t i = 0;
+#ifdef MESHOPT_CODEC_SSE2
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 signBit = _mm_set1_ps(-0.0f);
+  for (; i + 4 <= count; i += 4)
+  {
+    alignas(16) float lanes[3][4];
+    for (size_t lane = 0; lane < 4; lane++)
+    {
+      for (size_t component = 0; component < 3; component++)
+      {
+        lanes[component][lane] = static_cast<float>(data[(i + lane) * 4 + component]);
+      }
+    }
+    __m128 x = _mm_load_ps(lanes[0]);
+    __m128 y = _mm_load_ps(lanes[1]);
+    const __m128 z = _mm_sub_ps(_mm_sub_ps(_mm_load_ps(lanes[2]), _mm_andnot_ps(signBit, x)), _mm_andnot_ps(signBit, y));
+
+    // the lower hemisphere unfolds back over the diagonals
+    const __m128 t = _mm_min_ps(z, zero);
+    x = _mm_add_ps(x, _mm_xor_ps(t, _mm_andnot_ps(_mm_cmpge_ps(x, zero), signBit)));
+    y = _mm_add_ps(y, _mm_xor_ps(t, _mm_andnot_ps(_mm_cmpge_ps(y, zero), signBit)));
+
+    const __m128 scale = _mm_div_ps(_mm_set1_ps(one), _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z))));
+    // rounded half away from zero
+    auto round = [&](__m128 v)
+    {
+      const __m128 sign = _mm_andnot_ps(_mm_cmpge_ps(v, zero), signBit);
+      return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), _mm_or_ps(half, sign)));
+    };
+    alignas(16) int32_t rounded[3][4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(rounded[0]), round(x));
+    _mm_store_si128(reinterpret_cast<__m128i*>(rounded[1]), round(y));
+    _mm_store_si128(reinterpret_cast<__m128i*>(rounded[2]), round(z));
+    for (size_t lane = 0; lane < 4; lane++)
+    {
+      for (size_t component = 0; component < 3; component++)
+      {
+        data[(i + lane) * 4 + component] = static_cast<T>(rounded[component][lane]);
+      }
+    }
+  }
+#endif
+  for (; i < count; i++)
+  {
+    float x = static_cast<float>(data[i * 4 + 0]);
+    float y = static_cast<float>(data[i * 4 + 1]);
+    const float z = static_cast<float>(data[i * 4 + 2]) - std::abs(x) - std::abs(y);
+
+    const float t = z >= 0.0f ? 0.0f : z;
+    x += x >= 0.0f ? t : -t;
+    y += y >= 0.0f ? t : -t;
+
+    const float scale = one / std::sqrt(x * x + y * y + z * z);
+    data[i * 4 + 0] = static_cast<T>(static_cast<int>(x * scale + (x >= 0.0f ? 0.5f : -0.5f)));
+    data[i * 4 + 1] = static_cast<T>(static_cast<int>(y * scale + (y >= 0.0f ? 0.5f : -0.5f)));
+    data[i * 4 + 2] = static_cast<T>(static_cast<int>(z * scale + (z >= 0.0f ? 0.5f : -0.5f)));
+  }
+}
+
+void unfilterMeshoptOctahedral(std::byte* data, size_t count, size_t stride)
+{
+  if (stride == 4)
+    unfilterOctahedral(reinterpret_cast<int8_t*>(data), count);
+  else
+    unfilterOctahedral(reinterpret_cast<int16_t*>(data), count);
+}
+
+void unfilterMeshoptQuaternion(std::byte* data, size_t count)
+{
+  auto* q = reinterpret_cast<int16_t*>(data);
+  const float range = 1.0f / std::sqrt(2.0f);
+  for (size_t i = 0; i < count; i++)
+  {
+    // the high bits of w hold the scale the three components were stored at, its low two bits the index of the one left out
+    const int16_t packed = q[i * 4 + 3];
+    const float scale = range / static_cast<float>(packed | 3);
+    const float x = static_cast<float>(q[i * 4 + 0]) * scale;
+    const float y = static_cast<float>(q[i * 4 + 1]) * scale;
+    const float z = static_cast<float>(q[i * 4 + 2]) * scale;
+    const float ww = 1.0f - x * x - y * y - z * z;
+    const float w = std::sqrt(ww >= 0.0f ? ww : 0.0f);
+
+    const int largest = packed & 3;
+    q[i * 4 + ((largest + 1) & 3)] = static_cast<int16_t>(static_cast<int>(x * 32767.0f + (x >= 0.0f ? 0.5f : -0.5f)));
+    q[i * 4 + ((largest + 2) & 3)] = static_cast<int16_t>(static_cast<int>(y * 32767.0f + (y >= 0.0f ? 0.5f : -0.5f)));
+    q[i * 4 + ((largest + 3) & 3)] = static_cast<int16_t>(static_cast<int>(z * 32767.0f + (z >= 0.0f ? 0.5f : -0.5f)));
+    q[i * 4 + largest] = static_cast<int16_t>(static_cast<int>(w * 32767.0f + 0.5f));
+  }
+}
+
+void unfilterMeshoptExponential(std::byte* data, size_t valueCount)
+{
+  size_t i = 0;
+#ifdef MESHOPT_CODEC_SSE2
+  // 2^e built straight into the float's exponent bits, times the mantissa as a float
+  const __m128i bias = _mm_set1_epi32(127);
+  for (; i + 4 <= valueCount; i += 4)
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 4));
+    const __m128i mantissa = _mm_srai_epi32(_mm_slli_epi32(v, 8), 8);
+    const __m128i exponent = _mm_srai_epi32(v, 24);
+    const __m128 power = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(exponent, bias), 23));
+    _mm_storeu_ps(reinterpret_cast<float*>(data + i * 4), _mm_mul_ps(power, _mm_cvtepi32_ps(mantissa)));
+  }
+#endif
+  for (; i < valueCount; i++)
+  {
+    uint32_t v;
+    std::memcpy(&v, data + i * 4, sizeof(v));
+    const int32_t mantissa = static_cast<int32_t>(v << 8) >> 8;
+    const int32_t exponent = static_cast<int32_t>(v) >> 24;
+    const uint32_t powerBits = static_cast<uint32_t>(exponent + 127) << 23;
+    float power;
+    std::memcpy(&power, &powerBits, sizeof(power));
+    const float value = power * static_cast<float>(mantissa);
+    std::memcpy(data + i * 4, &value, sizeof(value));
+  }
+}
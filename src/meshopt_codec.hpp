@@ -0,0 +1,28 @@
+#ifndef MESHOPT_CODEC_HPP
+#define MESHOPT_CODEC_HPP
+
+#include <cstddef>
+#include <span>
+
+// Decoders for the EXT_meshopt_compression bitstreams and filters, byte groups, deltas and filters run
+// on SSE2 where the target has it
+// Decoders return false when the data is malformed or does not decode to exactly count elements
+
+// attributes mode, count elements of stride bytes (a multiple of 4, at most 256) to out
+[[nodiscard]] bool decodeMeshoptVertices(std::byte* out, size_t count, size_t stride, std::span<const std::byte> in);
+
+// triangles mode, count indices (a multiple of 3) of indexSize bytes (2 or 4) to out
+[[nodiscard]] bool decodeMeshoptTriangles(std::byte* out, size_t count, size_t indexSize, std::span<const std::byte> in);
+
+// indices mode, count indices of indexSize bytes (2 or 4) to out
+[[nodiscard]] bool decodeMeshoptIndices(std::byte* out, size_t count, size_t indexSize, std::span<const std::byte> in);
+
+// filters undone in place after decoding
+// octahedral: four snorm8s or snorm16s (stride 4 or 8), xyz come back as a unit vector, w is kept
+void unfilterMeshoptOctahedral(std::byte* data, size_t count, size_t stride);
+// quaternion: four int16s, the three smallest components and the index of the largest come back as a unit quaternion
+void unfilterMeshoptQuaternion(std::byte* data, size_t count);
+// exponential: every 32-bit value, an 8-bit exponent over a 24-bit mantissa comes back as a float
+void unfilterMeshoptExponential(std::byte* data, size_t valueCount);
+
+#endif
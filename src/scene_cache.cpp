@@ -0,0 +1,260 @@
+#include "scene_cache.hpp"
+
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+static constexpr std::array<char, 4> SCENE_CACHE_MAGIC = {'G', 'I', 'S', 'C'};
+
+static constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static constexpr uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static constexpr uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+template<typename T>
+static T readUnaligned(const std::byte* data)
+{
+  T value;
+  memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+static uint64_t hashRound(uint64_t acc, uint64_t input)
+{
+  acc += input * PRIME64_2;
+  acc = std::rotl(acc, 31);
+  return acc * PRIME64_1;
+}
+
+static uint64_t hashMerge(uint64_t acc, uint64_t value)
+{
+  acc ^= hashRound(0, value);
+  return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t hashBytes(const std::byte* data, size_t size, uint64_t seed)
+{
+  const std::byte* end = data + size;
+  uint64_t hash;
+
+  if (size >= 32)
+  {
+    // four independent lanes keep the multiplies pipelined
+    uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+    uint64_t v2 = seed + PRIME64_2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - PRIME64_1;
+    for (const std::byte* limit = end - 32; data <= limit; data += 32)
+    {
+      v1 = hashRound(v1, readUnaligned<uint64_t>(data));
+      v2 = hashRound(v2, readUnaligned<uint64_t>(data + 8));
+      v3 = hashRound(v3, readUnaligned<uint64_t>(data + 16));
+      v4 = hashRound(v4, readUnaligned<uint64_t>(data + 24));
+    }
+    hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+    hash = hashMerge(hash, v1);
+    hash = hashMerge(hash, v2);
+    hash = hashMerge(hash, v3);
+    hash = hashMerge(hash, v4);
+  }
+  else
+  {
+    hash = seed + PRIME64_5;
+  }
+
+  hash += static_cast<uint64_t>(size);
+
+  for (; data + 8 <= end; data += 8)
+  {
+    hash ^= hashRound(0, readUnaligned<uint64_t>(data));
+    hash = std::rotl(hash, 27) * PRIME64_1 + PRIME64_4;
+  }
+  if (data + 4 <= end)
+  {
+    hash ^= static_cast<uint64_t>(readUnaligned<uint32_t>(data)) * PRIME64_1;
+    hash = std::rotl(hash, 23) * PRIME64_2 + PRIME64_3;
+    data += 4;
+  }
+  for (; data < end; data++)
+  {
+    hash ^= static_cast<uint64_t>(*data) * PRIME64_5;
+    hash = std::rotl(hash, 11) * PRIME64_1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= PRIME64_2;
+  hash ^= hash >> 29;
+  hash *= PRIME64_3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+uint64_t hashSources(const std::filesystem::path& directory, const std::vector<std::string>& sources)
+{
+  uint64_t hash = SCENE_CACHE_VERSION;
+  for (const auto& source : sources)
+  {
+    MappedFile file(directory / source);
+    hash = hashBytes(file.data(), file.size(), hash);
+  }
+  return hash;
+}
+
+std::filesystem::path sceneCachePath(const std::filesystem::path& assetPath)
+{
+  return std::filesystem::path(assetPath).concat(".scenecache");
+}
+
+void SceneCacheWriter::add(SceneCacheSection section, const void* data, size_t size)
+{
+  auto& bytes = sections[static_cast<size_t>(section)];
+  const auto* first = static_cast<const std::byte*>(data);
+  bytes.insert(bytes.end(), first, first + size);
+}
+
+void SceneCacheWriter::addStrings(SceneCacheSection section, const std::vector<std::string>& strings)
+{
+  // count, then each string as length + characters, no terminators
+  uint32_t count = static_cast<uint32_t>(strings.size());
+  add(section, &count, sizeof(count));
+  for (const auto& string : strings)
+  {
+    uint32_t length = static_cast<uint32_t>(string.size());
+    add(section, &length, sizeof(length));
+    add(section, string.data(), string.size());
+  }
+}
+
+void SceneCacheWriter::write(const std::filesystem::path& path, uint64_t key, uint32_t vertexStride) const
+{
+  SceneCacheHeader header {};
+  header.magic = SCENE_CACHE_MAGIC;
+  header.version = SCENE_CACHE_VERSION;
+  header.key = key;
+  header.vertexStride = vertexStride;
+  header.sectionCount = static_cast<uint32_t>(sections.size());
+
+  uint64_t offset = (sizeof(SceneCacheHeader) + SCENE_CACHE_ALIGNMENT - 1) & ~(SCENE_CACHE_ALIGNMENT - 1);
+  for (size_t i = 0; i < sections.size(); i++)
+  {
+    header.sections[i].offset = offset;
+    header.sections[i].size = sections[i].size();
+    offset = (offset + sections[i].size() + SCENE_CACHE_ALIGNMENT - 1) & ~(SCENE_CACHE_ALIGNMENT - 1);
+  }
+
+  auto tempPath = std::filesystem::path(path).concat(".tmp");
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+      throw std::runtime_error(std::string("failed to open ").append(tempPath.string()));
+    }
+
+    const char zeros[SCENE_CACHE_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t written = sizeof(header);
+    for (size_t i = 0; i < sections.size(); i++)
+    {
+      file.write(zeros, static_cast<std::streamsize>(header.sections[i].offset - written));
+      file.write(reinterpret_cast<const char*>(sections[i].data()), static_cast<std::streamsize>(sections[i].size()));
+      written = header.sections[i].offset + sections[i].size();
+    }
+
+    if (!file.good())
+    {
+      throw std::runtime_error(std::string("failed to write ").append(tempPath.string()));
+    }
+  }
+
+  std::filesystem::rename(tempPath, path);
+}
+
+bool SceneCache::open(const std::filesystem::path& path, const std::filesystem::path& assetDirectory, uint32_t vertexStride)
+{
+  // a rejected cache drops its mapping, so the cook that follows can replace the file
+  const auto reject = [this]()
+  {
+    file = MappedFile{};
+    header = nullptr;
+    return false;
+  };
+
+  header = nullptr;
+  if (!std::filesystem::exists(path)) return reject();
+
+  try
+  {
+    file = MappedFile(path);
+  }
+  catch (const std::exception&)
+  {
+    return reject();
+  }
+
+  if (file.size() < sizeof(SceneCacheHeader)) return reject();
+
+  const auto* candidate = reinterpret_cast<const SceneCacheHeader*>(file.data());
+  if (candidate->magic != SCENE_CACHE_MAGIC ||
+      candidate->version != SCENE_CACHE_VERSION ||
+      candidate->vertexStride != vertexStride ||
+      candidate->sectionCount != static_cast<uint32_t>(SceneCacheSection::Count))
+  {
+    return reject();
+  }
+
+  for (const auto& section : candidate->sections)
+  {
+    // written so that a corrupt offset or size cannot wrap around
+    if (section.offset > file.size() || section.size > file.size() - section.offset) return reject();
+  }
+
+  header = candidate;
+
+  // the key covers the gltf and every buffer it referenced when the cache was cooked
+  try
+  {
+    if (hashSources(assetDirectory, strings(SceneCacheSection::Sources)) != header->key) return reject();
+  }
+  catch (const std::exception&)
+  {
+    return reject();
+  }
+
+  return true;
+}
+
+std::span<const std::byte> SceneCache::raw(SceneCacheSection section) const
+{
+  const auto& entry = header->sections[static_cast<size_t>(section)];
+  return { file.data() + entry.offset, static_cast<size_t>(entry.size) };
+}
+
+std::vector<std::string> SceneCache::strings(SceneCacheSection section) const
+{
+  auto bytes = raw(section);
+  std::vector<std::string> result;
+  if (bytes.size() < sizeof(uint32_t)) return result;
+
+  size_t cursor = 0;
+  uint32_t count = readUnaligned<uint32_t>(bytes.data());
+  cursor += sizeof(uint32_t);
+  result.reserve(count);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    if (cursor + sizeof(uint32_t) > bytes.size())
+    {
+      throw std::runtime_error("truncated scene cache string table!");
+    }
+    uint32_t length = readUnaligned<uint32_t>(bytes.data() + cursor);
+    cursor += sizeof(uint32_t);
+    if (cursor + length > bytes.size())
+    {
+      throw std::runtime_error("truncated scene cache string table!");
+    }
+    result.emplace_back(reinterpret_cast<const char*>(bytes.data() + cursor), length);
+    cursor += length;
+  }
+  return result;
+}
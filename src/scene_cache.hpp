@@ -0,0 +1,132 @@
+#ifndef SCENE_CACHE_HPP
+#define SCENE_CACHE_HPP
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "mesh_optimizer.hpp"
+
+// Cooked scene blob written next to the source asset (Sponza.gltf -> Sponza.gltf.scenecache)
+// Sections are aligned so a mapping of the file can be read in place, with no parsing or fixups
+// Bump the version whenever a section, or a struct stored in one, changes layout
+constexpr uint32_t SCENE_CACHE_VERSION = 11;
+constexpr size_t SCENE_CACHE_ALIGNMENT = 16;
+
+enum class SceneCacheSection : uint32_t {
+  Sources,   // strings: the gltf then every external buffer, relative to the gltf, in hashing order
+  Vertices,  // Vertex[], cell by cell
+  Indices,   // uint32_t[], every primitive and level of detail back to back, local to its vertexOffset, 16-bit ranges first, each part cell by cell
+  Prims,     // CachedPrim[]
+  Materials, // strings: uri of each image a material samples, once however many share it, relative to the gltf
+  MaterialTextures, // uint32_t[]: each material's base colour texture, an index into Materials, or Materials' size for the white fallback
+  Meshlets,  // Meshlet[], every primitive's back to back
+  Meshes,    // CachedMesh[]
+  Nodes,     // CachedNode[], parents before children
+  Cells,     // CachedCell[]
+  Count
+};
+
+// one entry per PrimData, indices are a range of the Indices section
+struct CachedPrim {
+  uint32_t firstIndex;
+  uint32_t indexCount;
+  uint32_t materialIndex;
+  int32_t vertexOffset;
+  uint32_t cell;
+  std::array<float, 3> boundsMin;
+  std::array<float, 3> boundsExtent;
+  std::array<float, 3> placement;
+  uint32_t firstMeshlet;
+  uint32_t meshletCount;
+  uint32_t lodCount;
+  std::array<LodLevel, MAX_LOD_LEVELS - 1> lods;
+};
+
+// a spatial cell of geometry streamed as a whole, bounds are in world space
+// its vertices are one range of the Vertices section, its indices one range of each part of the Indices section
+struct CachedCell {
+  std::array<float, 3> boundsMin;
+  std::array<float, 3> boundsMax;
+  uint32_t firstVertex;
+  uint32_t vertexCount;
+  uint32_t firstShortIndex;
+  uint32_t shortIndexCount;
+  uint32_t firstWideIndex;
+  uint32_t wideIndexCount;
+};
+
+struct CachedMesh {
+  uint32_t firstPrim;
+  uint32_t primCount;
+};
+
+// a flattened scene graph node, parent and mesh are ~0U when it has none
+struct CachedNode {
+  uint32_t parent;
+  uint32_t mesh;
+  std::array<float, 3> translation;
+  std::array<float, 4> rotation; // x, y, z, w
+  std::array<float, 3> scale;
+};
+
+struct SceneCacheHeader {
+  std::array<char, 4> magic;
+  uint32_t version;
+  uint64_t key;
+  uint32_t vertexStride;
+  uint32_t sectionCount;
+  struct {
+    uint64_t offset;
+    uint64_t size;
+  } sections[static_cast<size_t>(SceneCacheSection::Count)];
+};
+
+// 64-bit content hash (xxHash64), fast enough to key the cache on every launch
+uint64_t hashBytes(const std::byte* data, size_t size, uint64_t seed = 0);
+
+// hashes each source file in order, chaining the seeds, throws if any cannot be mapped
+uint64_t hashSources(const std::filesystem::path& directory, const std::vector<std::string>& sources);
+
+std::filesystem::path sceneCachePath(const std::filesystem::path& assetPath);
+
+class SceneCacheWriter
+{
+  public:
+  void add(SceneCacheSection section, const void* data, size_t size);
+  void addStrings(SceneCacheSection section, const std::vector<std::string>& strings);
+
+  // writes beside the final path then renames, so a crash never leaves a torn cache behind
+  void write(const std::filesystem::path& path, uint64_t key, uint32_t vertexStride) const;
+
+  private:
+  std::array<std::vector<std::byte>, static_cast<size_t>(SceneCacheSection::Count)> sections;
+};
+
+class SceneCache
+{
+  public:
+  // false if the cache is missing, from another version or vertex layout, or older than its sources
+  bool open(const std::filesystem::path& path, const std::filesystem::path& assetDirectory, uint32_t vertexStride);
+
+  template<typename T>
+  [[nodiscard]] std::span<const T> get(SceneCacheSection section) const
+  {
+    auto bytes = raw(section);
+    return { reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T) };
+  }
+
+  [[nodiscard]] std::vector<std::string> strings(SceneCacheSection section) const;
+
+  private:
+  [[nodiscard]] std::span<const std::byte> raw(SceneCacheSection section) const;
+
+  MappedFile file;
+  const SceneCacheHeader* header = nullptr;
+};
+
+#endif
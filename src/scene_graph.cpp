@@ -0,0 +1,179 @@
+#include "scene_graph.hpp"
+
+#include <algorithm>
+#include <array>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCENE_GRAPH_SSE2
+#include <emmintrin.h>
+#endif
+
+void SceneGraph::clear()
+{
+  for (auto* array : { &tx, &ty, &tz, &rx, &ry, &rz, &rw, &sx, &sy, &sz })
+  {
+    array->clear();
+  }
+  parents.clear();
+  worldMatrices.clear();
+  dirty.clear();
+  anyDirty = false;
+  updates++;
+}
+
+uint32_t SceneGraph::addNode(uint32_t parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+  const uint32_t node = static_cast<uint32_t>(parents.size());
+  parents.push_back(parent);
+  tx.push_back(translation.x); ty.push_back(translation.y); tz.push_back(translation.z);
+  rx.push_back(rotation.x); ry.push_back(rotation.y); rz.push_back(rotation.z); rw.push_back(rotation.w);
+  sx.push_back(scale.x); sy.push_back(scale.y); sz.push_back(scale.z);
+  worldMatrices.emplace_back(1.0f);
+  dirty.push_back(1U);
+  anyDirty = true;
+  return node;
+}
+
+void SceneGraph::markDirty(uint32_t node)
+{
+  dirty[node] = 1U;
+  anyDirty = true;
+}
+
+void SceneGraph::setTranslation(uint32_t node, const glm::vec3& translation)
+{
+  tx[node] = translation.x; ty[node] = translation.y; tz[node] = translation.z;
+  markDirty(node);
+}
+
+void SceneGraph::setRotation(uint32_t node, const glm::quat& rotation)
+{
+  rx[node] = rotation.x; ry[node] = rotation.y; rz[node] = rotation.z; rw[node] = rotation.w;
+  markDirty(node);
+}
+
+void SceneGraph::setScale(uint32_t node, const glm::vec3& scale)
+{
+  sx[node] = scale.x; sy[node] = scale.y; sz[node] = scale.z;
+  markDirty(node);
+}
+
+// translation * rotation * scale of up to four nodes, one node per lane
+// trs holds the tx, ty, tz, rx, ry, rz, rw, sx, sy and sz arrays
+static void composeLocals(const uint32_t* index, size_t count, const std::array<const float*, 10>& trs, glm::mat4* out)
+{
+#ifdef SCENE_GRAPH_SSE2
+  auto gather = [&](const float* array)
+  {
+    alignas(16) float lanes[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (size_t lane = 0; lane < count; lane++) lanes[lane] = array[index[lane]];
+    return _mm_load_ps(lanes);
+  };
+  const __m128 x = gather(trs[3]), y = gather(trs[4]), z = gather(trs[5]), w = gather(trs[6]);
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+  const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+  const __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+  const __m128 scaleX = gather(trs[7]), scaleY = gather(trs[8]), scaleZ = gather(trs[9]);
+
+  // columns of the rotation, as glm::mat3_cast lays them out, times the scale on that axis
+  const __m128 m[12] = {
+    _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scaleX),
+    _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scaleX),
+    _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scaleX),
+    _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scaleY),
+    _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scaleY),
+    _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scaleY),
+    _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scaleZ),
+    _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scaleZ),
+    _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scaleZ),
+    gather(trs[0]), gather(trs[1]), gather(trs[2])
+  };
+  alignas(16) float lanes[12][4];
+  for (size_t element = 0; element < 12; element++)
+  {
+    _mm_store_ps(lanes[element], m[element]);
+  }
+  for (size_t lane = 0; lane < count; lane++)
+  {
+    glm::mat4& local = out[lane];
+    for (int column = 0; column < 4; column++)
+    {
+      local[column] = glm::vec4(lanes[column * 3][lane], lanes[column * 3 + 1][lane], lanes[column * 3 + 2][lane], column == 3 ? 1.0f : 0.0f);
+    }
+  }
+#else
+  for (size_t lane = 0; lane < count; lane++)
+  {
+    const uint32_t node = index[lane];
+    const glm::mat3 rotation = glm::mat3_cast(glm::quat(trs[6][node], trs[3][node], trs[4][node], trs[5][node]));
+    out[lane] = glm::mat4(
+      glm::vec4(rotation[0] * trs[7][node], 0.0f),
+      glm::vec4(rotation[1] * trs[8][node], 0.0f),
+      glm::vec4(rotation[2] * trs[9][node], 0.0f),
+      glm::vec4(trs[0][node], trs[1][node], trs[2][node], 1.0f)
+    );
+  }
+#endif
+}
+
+static void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#ifdef SCENE_GRAPH_SSE2
+  const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+  const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+  const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+  const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+  for (int column = 0; column < 4; column++)
+  {
+    __m128 result = _mm_mul_ps(a0, _mm_set1_ps(b[column][0]));
+    result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(b[column][1])));
+    result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(b[column][2])));
+    result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(b[column][3])));
+    _mm_storeu_ps(&out[column][0], result);
+  }
+#else
+  out = a * b;
+#endif
+}
+
+uint32_t SceneGraph::update()
+{
+  if (!anyDirty) return 0U;
+
+  // parents come first, so one pass hands dirtiness down whole subtrees
+  pending.clear();
+  for (uint32_t node = 0; node < parents.size(); node++)
+  {
+    if (!dirty[node] && parents[node] != NO_PARENT && dirty[parents[node]]) dirty[node] = 1U;
+    if (dirty[node]) pending.push_back(node);
+  }
+
+  const std::array<const float*, 10> trs = {
+    tx.data(), ty.data(), tz.data(), rx.data(), ry.data(), rz.data(), rw.data(), sx.data(), sy.data(), sz.data()
+  };
+  locals.resize(pending.size());
+  for (size_t i = 0; i < pending.size(); i += 4)
+  {
+    composeLocals(pending.data() + i, std::min<size_t>(4, pending.size() - i), trs, locals.data() + i);
+  }
+
+  // a parent that was not dirty has kept its world matrix, one that was is earlier in pending
+  for (size_t i = 0; i < pending.size(); i++)
+  {
+    const uint32_t node = pending[i];
+    if (parents[node] == NO_PARENT)
+      worldMatrices[node] = locals[i];
+    else
+      multiply(worldMatrices[parents[node]], locals[i], worldMatrices[node]);
+  }
+
+  for (uint32_t node : pending)
+  {
+    dirty[node] = 0U;
+  }
+  anyDirty = false;
+  updates++;
+  return static_cast<uint32_t>(pending.size());
+}
@@ -0,0 +1,58 @@
+#ifndef SCENE_GRAPH_HPP
+#define SCENE_GRAPH_HPP
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Flattened node hierarchy as a structure of arrays, every parent before its children
+// Local transforms are set per node, update() recomputes world matrices for the dirty subtrees only,
+// composing four local matrices at a time and multiplying them with SSE2 where the target has it
+class SceneGraph
+{
+  public:
+  static constexpr uint32_t NO_PARENT = ~0U;
+
+  void clear();
+
+  // parent must already be in the graph, returns the new node
+  uint32_t addNode(uint32_t parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+
+  void setTranslation(uint32_t node, const glm::vec3& translation);
+  void setRotation(uint32_t node, const glm::quat& rotation);
+  void setScale(uint32_t node, const glm::vec3& scale);
+
+  // recomputes the world matrix of every dirty node and everything under it, returns how many changed
+  uint32_t update();
+
+  [[nodiscard]] size_t size() const { return parents.size(); }
+  [[nodiscard]] uint32_t parent(uint32_t node) const { return parents[node]; }
+  [[nodiscard]] glm::vec3 translation(uint32_t node) const { return { tx[node], ty[node], tz[node] }; }
+  [[nodiscard]] glm::quat rotation(uint32_t node) const { return glm::quat(rw[node], rx[node], ry[node], rz[node]); }
+  [[nodiscard]] glm::vec3 scale(uint32_t node) const { return { sx[node], sy[node], sz[node] }; }
+  [[nodiscard]] std::span<const glm::mat4> worlds() const { return worldMatrices; }
+
+  // changes with every update that moves a node, so copies of worlds() can tell they are stale
+  [[nodiscard]] uint64_t generation() const { return updates; }
+
+  private:
+  void markDirty(uint32_t node);
+
+  std::vector<uint32_t> parents;
+  std::vector<float> tx, ty, tz;
+  std::vector<float> rx, ry, rz, rw;
+  std::vector<float> sx, sy, sz;
+  std::vector<glm::mat4> worldMatrices;
+  std::vector<uint8_t> dirty;
+  bool anyDirty = false;
+  uint64_t updates = 0U;
+
+  // reused by update, the nodes being recomputed and their local matrices
+  std::vector<uint32_t> pending;
+  std::vector<glm::mat4> locals;
+};
+
+#endif
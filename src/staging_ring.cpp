@@ -0,0 +1,108 @@
+#include "staging_ring.hpp"
+
+#include <stdexcept>
+
+static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+StagingRing::StagingRing(
+  const vk::raii::Device& device,
+  const vk::PhysicalDeviceMemoryProperties& memoryProperties,
+  vk::DeviceSize capacity
+) : capacity(capacity)
+{
+  buffer = vk::raii::Buffer(device, vk::BufferCreateInfo{
+    .size = capacity,
+    .usage = vk::BufferUsageFlagBits::eTransferSrc,
+    .sharingMode = vk::SharingMode::eExclusive
+  });
+  vk::MemoryRequirements memRequirements = buffer.getMemoryRequirements();
+
+  // coherent so writes never need flushing, the ring is only ever written sequentially by the cpu
+  const vk::MemoryPropertyFlags properties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+  uint32_t memoryTypeIndex = ~0U;
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+  {
+    if ((memRequirements.memoryTypeBits & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+    {
+      memoryTypeIndex = i;
+      break;
+    }
+  }
+  if (memoryTypeIndex == ~0U)
+  {
+    throw std::runtime_error("failed to find suitable memory type!");
+  }
+
+  memory = vk::raii::DeviceMemory(device, vk::MemoryAllocateInfo{
+    .allocationSize = memRequirements.size,
+    .memoryTypeIndex = memoryTypeIndex
+  });
+  buffer.bindMemory(*memory, 0);
+  mapped = static_cast<std::byte*>(memory.mapMemory(0, capacity));
+}
+
+std::optional<vk::DeviceSize> StagingRing::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+  if (size > capacity) return std::nullopt;
+
+  // nothing live, start over at the front so the whole ring is contiguous again
+  if (used == 0U)
+  {
+    head = 0U;
+    tail = 0U;
+  }
+
+  vk::DeviceSize offset = alignUp(head, alignment);
+  vk::DeviceSize newHead;
+  if (head > tail || used == 0U)
+  {
+    // free space is [head, capacity) then [0, tail)
+    if (offset + size <= capacity)
+    {
+      newHead = offset + size;
+    }
+    else if (size <= tail)
+    {
+      // the end of the ring is skipped, and counted as used until the ranges before it retire
+      offset = 0U;
+      newHead = size;
+    }
+    else
+    {
+      return std::nullopt;
+    }
+  }
+  else
+  {
+    // wrapped, free space is [head, tail)
+    if (offset + size > tail) return std::nullopt;
+    newHead = offset + size;
+  }
+
+  const vk::DeviceSize consumed = newHead > head ? newHead - head : capacity - head + newHead;
+  used += consumed;
+  pendingBytes += consumed;
+  head = newHead;
+  return offset;
+}
+
+void StagingRing::retireAt(uint64_t value)
+{
+  if (pendingBytes == 0U) return;
+
+  retirements.push_back(Retirement{ .value = value, .end = head, .bytes = pendingBytes });
+  pendingBytes = 0U;
+}
+
+void StagingRing::reclaim(uint64_t completedValue)
+{
+  while (!retirements.empty() && retirements.front().value <= completedValue)
+  {
+    tail = retirements.front().end;
+    used -= retirements.front().bytes;
+    retirements.pop_front();
+  }
+}
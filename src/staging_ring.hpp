@@ -0,0 +1,67 @@
+#ifndef STAGING_RING_HPP
+#define STAGING_RING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+
+// same include order as app.hpp, volk has to come before the C++ bindings
+#include <vulkan/vk_platform.h>
+#include <volk/volk.h>
+#include <vulkan/vulkan_raii.hpp>
+
+constexpr vk::DeviceSize DEFAULT_STAGING_RING_SIZE = 64ULL * 1024ULL * 1024ULL;
+
+// One persistently mapped host-visible buffer handed out front to back as aligned sub-ranges
+// Ranges are grouped by the timeline value of the submission that reads them and reclaimed, oldest first,
+// once the semaphore has passed that value
+class StagingRing
+{
+  public:
+  StagingRing(
+    const vk::raii::Device& device,
+    const vk::PhysicalDeviceMemoryProperties& memoryProperties,
+    vk::DeviceSize capacity = DEFAULT_STAGING_RING_SIZE
+  );
+  StagingRing(const StagingRing&) = delete;
+  StagingRing& operator=(const StagingRing&) = delete;
+
+  // offset of size bytes aligned to alignment (not necessarily a power of two),
+  // or nothing when that much contiguous space is not free until older ranges retire
+  [[nodiscard]] std::optional<vk::DeviceSize> allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+
+  // everything allocated since the last call is read by the submission signalling value
+  void retireAt(uint64_t value);
+
+  // hands back the ranges of every submission at or below completedValue
+  void reclaim(uint64_t completedValue);
+
+  [[nodiscard]] std::byte* data(vk::DeviceSize offset) const { return mapped + offset; }
+  [[nodiscard]] vk::Buffer getBuffer() const { return *buffer; }
+  [[nodiscard]] vk::DeviceSize getCapacity() const { return capacity; }
+  // bytes handed out since the last retireAt
+  [[nodiscard]] vk::DeviceSize unretiredBytes() const { return pendingBytes; }
+  [[nodiscard]] bool idle() const { return used == 0U; }
+
+  private:
+  struct Retirement {
+    uint64_t value;
+    vk::DeviceSize end;
+    vk::DeviceSize bytes;
+  };
+
+  vk::DeviceSize capacity;
+  vk::raii::Buffer buffer = nullptr;
+  vk::raii::DeviceMemory memory = nullptr;
+  std::byte* mapped = nullptr;
+
+  // live data runs from tail up to head, wrapping at capacity, used tells full from empty
+  vk::DeviceSize head = 0U;
+  vk::DeviceSize tail = 0U;
+  vk::DeviceSize used = 0U;
+  vk::DeviceSize pendingBytes = 0U;
+  std::deque<Retirement> retirements;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+uint32_t ThreadPool::defaultThreadCount()
+{
+  uint32_t cores = std::thread::hardware_concurrency();
+  return std::max(1U, cores > 1 ? cores - 1 : 1U);
+}
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+  workers.reserve(threadCount);
+  for (uint32_t i = 0; i < threadCount; i++)
+  {
+    workers.emplace_back(&ThreadPool::workerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  taskAvailable.notify_all();
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+  {
+    std::lock_guard lock(mutex);
+    tasks.push_back(std::move(task));
+    unfinishedTasks++;
+  }
+  taskAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+  std::unique_lock lock(mutex);
+  tasksFinished.wait(lock, [this] { return unfinishedTasks == 0; });
+}
+
+void ThreadPool::workerLoop()
+{
+  while (true)
+  {
+    std::function<void()> task;
+    {
+      std::unique_lock lock(mutex);
+      taskAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+      // drain what is queued before stopping, callers may be waiting on it
+      if (tasks.empty()) return;
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+
+    task();
+
+    {
+      std::lock_guard lock(mutex);
+      unfinishedTasks--;
+      if (unfinishedTasks == 0) tasksFinished.notify_all();
+    }
+  }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& func)
+{
+  if (count == 0) return;
+  grainSize = std::max<size_t>(1, grainSize);
+  const size_t chunkCount = (count + grainSize - 1) / grainSize;
+
+  // shared with the helpers, which may only get to run after we have returned when older tasks are ahead of them
+  // in the queue, by then every chunk is claimed and a helper leaves without touching func
+  struct Shared {
+    std::atomic<size_t> nextChunk = 0;
+    std::mutex mutex;
+    std::condition_variable chunksDone;
+    size_t finishedChunks = 0;
+    std::exception_ptr error;
+  };
+  auto shared = std::make_shared<Shared>();
+
+  auto runChunks = [shared, chunkCount, count, grainSize, &func]()
+  {
+    for (size_t chunk = shared->nextChunk++; chunk < chunkCount; chunk = shared->nextChunk++)
+    {
+      std::exception_ptr error;
+      try
+      {
+        func(chunk * grainSize, std::min(count, (chunk + 1) * grainSize));
+      }
+      catch (...)
+      {
+        error = std::current_exception();
+      }
+      std::lock_guard lock(shared->mutex);
+      if (error && !shared->error) shared->error = error;
+      if (++shared->finishedChunks == chunkCount) shared->chunksDone.notify_one();
+    }
+  };
+
+  const size_t helperCount = std::min<size_t>(workers.size(), chunkCount - 1);
+  for (size_t i = 0; i < helperCount; i++)
+  {
+    submit(runChunks);
+  }
+
+  runChunks();
+
+  // waits on the chunks, not the helpers, a helper that never claimed one is not waited for
+  std::unique_lock lock(shared->mutex);
+  shared->chunksDone.wait(lock, [&] { return shared->finishedChunks == chunkCount; });
+  if (shared->error) std::rethrow_exception(shared->error);
+}
@@ -0,0 +1,49 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads fed from one FIFO
+// Tasks must not block on other tasks of the same pool (parallelFor included), all workers could end up waiting
+class ThreadPool
+{
+  public:
+  // one thread per core, less the calling thread which usually has its own work (uploads, recording)
+  explicit ThreadPool(uint32_t threadCount = defaultThreadCount());
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ~ThreadPool();
+
+  void submit(std::function<void()> task);
+
+  // blocks until every task submitted so far has finished
+  void wait();
+
+  // calls func(begin, end) over [0, count) in chunks of grainSize, on the workers and the calling thread
+  // returns once every chunk is done, rethrowing the first exception thrown by func, without waiting for helpers
+  // still queued behind other tasks, the calling thread takes their chunks instead
+  void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& func);
+
+  [[nodiscard]] uint32_t size() const { return static_cast<uint32_t>(workers.size()); }
+
+  static uint32_t defaultThreadCount();
+
+  private:
+  void workerLoop();
+
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable taskAvailable;
+  std::condition_variable tasksFinished;
+  size_t unfinishedTasks = 0;
+  bool stopping = false;
+};
+
+#endif
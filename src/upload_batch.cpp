@@ -0,0 +1,323 @@
+#include "upload_batch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+
+// copies are fine from any offset, this just keeps chunks on cache line boundaries
+constexpr vk::DeviceSize BUFFER_STAGING_ALIGNMENT = 64U;
+
+UploadBatch::UploadBatch(
+  const vk::raii::Device& device,
+  const vk::raii::PhysicalDevice& physicalDevice,
+  const vk::raii::Queue& queue,
+  uint32_t queueFamilyIndex,
+  uint32_t dstQueueFamilyIndex,
+  vk::DeviceSize stagingCapacity
+) : device(device), queue(queue), queueFamilyIndex(queueFamilyIndex), dstQueueFamilyIndex(dstQueueFamilyIndex),
+    memoryProperties(physicalDevice.getMemoryProperties()), ring(device, memoryProperties, stagingCapacity),
+    maxChunk(stagingCapacity / 4U)
+{
+  vk::CommandPoolCreateInfo commandPoolInfo {
+    .flags = vk::CommandPoolCreateFlagBits::eTransient,
+    .queueFamilyIndex = queueFamilyIndex
+  };
+  commandPool = vk::raii::CommandPool(device, commandPoolInfo);
+
+  vk::SemaphoreTypeCreateInfo timelineInfo {
+    .semaphoreType = vk::SemaphoreType::eTimeline,
+    .initialValue = 0U
+  };
+  semaphore = vk::raii::Semaphore(device, vk::SemaphoreCreateInfo{ .pNext = &timelineInfo });
+}
+
+UploadBatch::~UploadBatch()
+{
+  try
+  {
+    waitFor(nextValue - 1U);
+  }
+  catch (...)
+  {
+    // device lost, nothing left to wait for
+  }
+}
+
+uint64_t UploadBatch::uploadBuffer(
+  const void* data, vk::DeviceSize size,
+  vk::Buffer dstBuffer, vk::DeviceSize dstOffset,
+  vk::PipelineStageFlags2 dstStage, vk::AccessFlags2 dstAccess
+)
+{
+  if (size == 0) return 0U;
+
+  const auto* bytes = static_cast<const std::byte*>(data);
+  for (vk::DeviceSize copied = 0U; copied < size; copied += maxChunk)
+  {
+    const vk::DeviceSize chunk = std::min(maxChunk, size - copied);
+    const vk::DeviceSize offset = stage(bytes + copied, chunk, BUFFER_STAGING_ALIGNMENT);
+    recordingCommandBuffer().copyBuffer(ring.getBuffer(), dstBuffer, vk::BufferCopy{
+      .srcOffset = offset,
+      .dstOffset = dstOffset + copied,
+      .size = chunk
+    });
+  }
+  stats.uploads++;
+
+  // chunks may have gone out in earlier submissions on this queue, the barrier still covers their copies
+  const auto& commandBuffer = recordingCommandBuffer();
+
+  // without an ownership transfer the barrier is complete on this queue, otherwise this is the release half
+  vk::BufferMemoryBarrier2 barrier {
+    .srcStageMask = vk::PipelineStageFlagBits2::eCopy,
+    .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+    .dstStageMask = transfersOwnership() ? vk::PipelineStageFlagBits2::eNone : dstStage,
+    .dstAccessMask = transfersOwnership() ? vk::AccessFlags2{} : dstAccess,
+    .srcQueueFamilyIndex = transfersOwnership() ? queueFamilyIndex : vk::QueueFamilyIgnored,
+    .dstQueueFamilyIndex = transfersOwnership() ? dstQueueFamilyIndex : vk::QueueFamilyIgnored,
+    .buffer = dstBuffer,
+    .offset = dstOffset,
+    .size = size
+  };
+  commandBuffer.pipelineBarrier2(vk::DependencyInfo{ .bufferMemoryBarrierCount = 1, .pBufferMemoryBarriers = &barrier });
+
+  if (transfersOwnership())
+  {
+    barrier.srcStageMask = vk::PipelineStageFlagBits2::eNone;
+    barrier.srcAccessMask = {};
+    barrier.dstStageMask = dstStage;
+    barrier.dstAccessMask = dstAccess;
+    bufferAcquires.emplace_back(nextValue, barrier);
+  }
+
+  return nextValue;
+}
+
+uint64_t UploadBatch::uploadImage(
+  const void* data,
+  vk::Image image, vk::Format format, uint32_t mipLevels,
+  std::span<const vk::BufferImageCopy> regions
+)
+{
+  const uint32_t texelBlockSize = vk::blockSize(format);
+  if (texelBlockSize == 0U)
+  {
+    throw std::runtime_error("failed to upload image with unknown texel block size!");
+  }
+  const auto blockExtent = vk::blockExtent(format);
+  // buffer offsets of image copies have to be a multiple of both the block size and 4
+  const vk::DeviceSize alignment = std::lcm<vk::DeviceSize>(4U, texelBlockSize);
+
+  const vk::ImageSubresourceRange range {
+    .aspectMask = vk::ImageAspectFlagBits::eColor,
+    .baseMipLevel = 0,
+    .levelCount = mipLevels,
+    .baseArrayLayer = 0,
+    .layerCount = 1
+  };
+
+  vk::ImageMemoryBarrier2 toTransfer {
+    .srcStageMask = vk::PipelineStageFlagBits2::eNone,
+    .srcAccessMask = {},
+    .dstStageMask = vk::PipelineStageFlagBits2::eCopy,
+    .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+    .oldLayout = vk::ImageLayout::eUndefined,
+    .newLayout = vk::ImageLayout::eTransferDstOptimal,
+    .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+    .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+    .image = image,
+    .subresourceRange = range
+  };
+  recordingCommandBuffer().pipelineBarrier2(vk::DependencyInfo{ .imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &toTransfer });
+
+  // each region goes through the ring in bands of whole block rows, small mips are a single band
+  const auto* bytes = static_cast<const std::byte*>(data);
+  for (const auto& region : regions)
+  {
+    const uint32_t blocksWide = (region.imageExtent.width + blockExtent[0] - 1) / blockExtent[0];
+    const uint32_t blockRows = (region.imageExtent.height + blockExtent[1] - 1) / blockExtent[1];
+    const vk::DeviceSize rowBytes = static_cast<vk::DeviceSize>(blocksWide) * texelBlockSize;
+    if (rowBytes > maxChunk)
+    {
+      throw std::runtime_error("failed to fit image row in staging ring!");
+    }
+    const uint32_t rowsPerBand = static_cast<uint32_t>(maxChunk / rowBytes);
+
+    for (uint32_t row = 0; row < blockRows; row += rowsPerBand)
+    {
+      const uint32_t rows = std::min(rowsPerBand, blockRows - row);
+      const vk::DeviceSize offset = stage(bytes + region.bufferOffset + row * rowBytes, rows * rowBytes, alignment);
+
+      vk::BufferImageCopy band = region;
+      band.bufferOffset = offset;
+      band.bufferRowLength = 0;
+      band.bufferImageHeight = 0;
+      band.imageOffset.y = region.imageOffset.y + static_cast<int32_t>(row * blockExtent[1]);
+      band.imageExtent.height = std::min(rows * blockExtent[1], region.imageExtent.height - row * blockExtent[1]);
+      recordingCommandBuffer().copyBufferToImage(ring.getBuffer(), image, vk::ImageLayout::eTransferDstOptimal, band);
+    }
+  }
+  stats.uploads++;
+
+  const auto& commandBuffer = recordingCommandBuffer();
+
+  // the layout transition is part of both halves of an ownership transfer and must match exactly
+  vk::ImageMemoryBarrier2 toShader {
+    .srcStageMask = vk::PipelineStageFlagBits2::eCopy,
+    .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+    .dstStageMask = transfersOwnership() ? vk::PipelineStageFlagBits2::eNone : vk::PipelineStageFlagBits2::eFragmentShader,
+    .dstAccessMask = transfersOwnership() ? vk::AccessFlags2{} : vk::AccessFlagBits2::eShaderSampledRead,
+    .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+    .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+    .srcQueueFamilyIndex = transfersOwnership() ? queueFamilyIndex : vk::QueueFamilyIgnored,
+    .dstQueueFamilyIndex = transfersOwnership() ? dstQueueFamilyIndex : vk::QueueFamilyIgnored,
+    .image = image,
+    .subresourceRange = range
+  };
+  commandBuffer.pipelineBarrier2(vk::DependencyInfo{ .imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &toShader });
+
+  if (transfersOwnership())
+  {
+    toShader.srcStageMask = vk::PipelineStageFlagBits2::eNone;
+    toShader.srcAccessMask = {};
+    toShader.dstStageMask = vk::PipelineStageFlagBits2::eFragmentShader;
+    toShader.dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead;
+    imageAcquires.emplace_back(nextValue, toShader);
+  }
+
+  return nextValue;
+}
+
+void UploadBatch::submit()
+{
+  if (!*commandBuffer) return;
+
+  commandBuffer.end();
+
+  vk::CommandBufferSubmitInfo commandBufferInfo { .commandBuffer = *commandBuffer };
+  vk::SemaphoreSubmitInfo signalInfo {
+    .semaphore = *semaphore,
+    .value = nextValue,
+    .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+  };
+  queue.submit2(vk::SubmitInfo2{
+    .commandBufferInfoCount = 1,
+    .pCommandBufferInfos = &commandBufferInfo,
+    .signalSemaphoreInfoCount = 1,
+    .pSignalSemaphoreInfos = &signalInfo
+  });
+  stats.submissions++;
+
+  ring.retireAt(nextValue);
+  inFlight.push_back(Submission{
+    .value = nextValue,
+    .commandBuffer = std::move(commandBuffer)
+  });
+  commandBuffer = nullptr;
+  nextValue++;
+}
+
+void UploadBatch::collect()
+{
+  if (inFlight.empty()) return;
+
+  const uint64_t completed = completedValue();
+  ring.reclaim(completed);
+  while (!inFlight.empty() && inFlight.front().value <= completed)
+  {
+    inFlight.pop_front();
+  }
+}
+
+void UploadBatch::finish()
+{
+  submit();
+  waitFor(nextValue - 1U);
+}
+
+void UploadBatch::recordAcquires(const vk::raii::CommandBuffer& commandBuffer, uint64_t value)
+{
+  auto landed = [value](const auto& acquire) { return acquire.first <= value; };
+  // both lists are in value order, so what has landed is always a prefix
+  auto bufferEnd = std::find_if_not(bufferAcquires.begin(), bufferAcquires.end(), landed);
+  auto imageEnd = std::find_if_not(imageAcquires.begin(), imageAcquires.end(), landed);
+
+  std::vector<vk::BufferMemoryBarrier2> bufferBarriers;
+  std::vector<vk::ImageMemoryBarrier2> imageBarriers;
+  std::transform(bufferAcquires.begin(), bufferEnd, std::back_inserter(bufferBarriers), [](const auto& acquire) { return acquire.second; });
+  std::transform(imageAcquires.begin(), imageEnd, std::back_inserter(imageBarriers), [](const auto& acquire) { return acquire.second; });
+  bufferAcquires.erase(bufferAcquires.begin(), bufferEnd);
+  imageAcquires.erase(imageAcquires.begin(), imageEnd);
+
+  if (bufferBarriers.empty() && imageBarriers.empty()) return;
+
+  commandBuffer.pipelineBarrier2(vk::DependencyInfo{
+    .bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size()),
+    .pBufferMemoryBarriers = bufferBarriers.data(),
+    .imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size()),
+    .pImageMemoryBarriers = imageBarriers.data()
+  });
+}
+
+vk::DeviceSize UploadBatch::stage(const void* data, vk::DeviceSize size, vk::DeviceSize alignment)
+{
+  while (true)
+  {
+    collect();
+    if (auto offset = ring.allocate(size, alignment))
+    {
+      memcpy(ring.data(*offset), data, size);
+      stats.bytesStaged += size;
+      return *offset;
+    }
+
+    // out of space: send what is recorded so its ranges can retire, then wait for the oldest submission
+    if (ring.unretiredBytes() > 0U)
+    {
+      submit();
+    }
+    else if (!inFlight.empty())
+    {
+      waitFor(inFlight.front().value);
+    }
+    else
+    {
+      throw std::runtime_error("failed to fit upload in staging ring!");
+    }
+  }
+}
+
+const vk::raii::CommandBuffer& UploadBatch::recordingCommandBuffer()
+{
+  if (!*commandBuffer)
+  {
+    vk::CommandBufferAllocateInfo allocInfo {
+      .commandPool = commandPool,
+      .level = vk::CommandBufferLevel::ePrimary,
+      .commandBufferCount = 1
+    };
+    commandBuffer = std::move(device.allocateCommandBuffers(allocInfo).front());
+    commandBuffer.begin(vk::CommandBufferBeginInfo{ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+    stats.commandBuffers++;
+  }
+  return commandBuffer;
+}
+
+void UploadBatch::waitFor(uint64_t value)
+{
+  if (value == 0U || completedValue() >= value) return;
+
+  auto start = std::chrono::steady_clock::now();
+  vk::SemaphoreWaitInfo waitInfo {
+    .semaphoreCount = 1,
+    .pSemaphores = &*semaphore,
+    .pValues = &value
+  };
+  while (vk::Result::eTimeout == device.waitSemaphores(waitInfo, UINT64_MAX))
+  { }
+  auto end = std::chrono::steady_clock::now();
+  stats.waitTime += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
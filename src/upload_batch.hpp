@@ -0,0 +1,119 @@
+#ifndef UPLOAD_BATCH_HPP
+#define UPLOAD_BATCH_HPP
+
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <utility>
+#include <vector>
+
+// same include order as app.hpp, volk has to come before the C++ bindings
+#include <vulkan/vk_platform.h>
+#include <volk/volk.h>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "staging_ring.hpp"
+
+struct UploadStats {
+  uint32_t submissions = 0U;
+  uint32_t commandBuffers = 0U;
+  uint32_t uploads = 0U;
+  vk::DeviceSize bytesStaged = 0U;
+  long long int waitTime = 0L; // microseconds spent blocked on the timeline semaphore, i.e. on ring space
+};
+
+// Records layout transitions and copies for many buffers and images into one command buffer per submission,
+// on a queue of its own when the device has a dedicated transfer family
+// Each submission signals the next value of a timeline semaphore, every upload reports the value it lands at,
+// and its staging range in the ring is reclaimed as the semaphore passes it
+// Uploads bigger than a quarter of the ring are copied in chunks, so any size fits through a fixed budget
+// When the upload queue is a different family, resources are released to the destination family and
+// recordAcquires has to be called on the destination queue before they are used there
+class UploadBatch
+{
+  public:
+  UploadBatch(
+    const vk::raii::Device& device,
+    const vk::raii::PhysicalDevice& physicalDevice,
+    const vk::raii::Queue& queue,
+    uint32_t queueFamilyIndex,
+    uint32_t dstQueueFamilyIndex,
+    vk::DeviceSize stagingCapacity = DEFAULT_STAGING_RING_SIZE
+  );
+  UploadBatch(const UploadBatch&) = delete;
+  UploadBatch& operator=(const UploadBatch&) = delete;
+  // waits for anything still in flight, the ring is never freed under the GPU
+  ~UploadBatch();
+
+  // dstStage and dstAccess describe the first use on the destination queue, the returned value is when the data lands
+  uint64_t uploadBuffer(
+    const void* data, vk::DeviceSize size,
+    vk::Buffer dstBuffer, vk::DeviceSize dstOffset,
+    vk::PipelineStageFlags2 dstStage, vk::AccessFlags2 dstAccess
+  );
+
+  // regions are relative to data and tightly packed, the image goes from undefined to shader read only
+  uint64_t uploadImage(
+    const void* data,
+    vk::Image image, vk::Format format, uint32_t mipLevels,
+    std::span<const vk::BufferImageCopy> regions
+  );
+
+  // submits everything recorded so far, never blocks
+  void submit();
+
+  // reclaims staging and command buffers of every submission the device has finished, never blocks
+  void collect();
+
+  // submits, then blocks until every upload has landed
+  void finish();
+
+  // records the destination half of the ownership transfer for every upload landed at or before value
+  // the submission containing commandBuffer has to wait on getSemaphore() for value
+  void recordAcquires(const vk::raii::CommandBuffer& commandBuffer, uint64_t value);
+
+  [[nodiscard]] uint64_t completedValue() const { return semaphore.getCounterValue(); }
+  [[nodiscard]] const vk::raii::Semaphore& getSemaphore() const { return semaphore; }
+  [[nodiscard]] bool transfersOwnership() const { return queueFamilyIndex != dstQueueFamilyIndex; }
+  [[nodiscard]] const UploadStats& getStats() const { return stats; }
+
+  private:
+  struct Submission {
+    uint64_t value;
+    vk::raii::CommandBuffer commandBuffer = nullptr;
+  };
+
+  // copies into the ring and returns the offset, submitting or waiting on older submissions until it fits
+  // may submit, so the recording command buffer has to be fetched again afterwards
+  [[nodiscard]] vk::DeviceSize stage(const void* data, vk::DeviceSize size, vk::DeviceSize alignment);
+  [[nodiscard]] const vk::raii::CommandBuffer& recordingCommandBuffer();
+  void waitFor(uint64_t value);
+
+  const vk::raii::Device& device;
+  const vk::raii::Queue& queue;
+  uint32_t queueFamilyIndex;
+  uint32_t dstQueueFamilyIndex;
+  vk::PhysicalDeviceMemoryProperties memoryProperties;
+  StagingRing ring;
+  // largest single staging range, so a chunk can be written while the previous ones are copied
+  vk::DeviceSize maxChunk;
+
+  vk::raii::CommandPool commandPool = nullptr;
+  vk::raii::Semaphore semaphore = nullptr;
+  // value signalled by the submission currently being recorded
+  uint64_t nextValue = 1U;
+
+  // the submission being recorded
+  vk::raii::CommandBuffer commandBuffer = nullptr;
+
+  // submitted and not yet collected, oldest first
+  std::deque<Submission> inFlight;
+
+  // destination halves of released ownership, in value order
+  std::vector<std::pair<uint64_t, vk::BufferMemoryBarrier2>> bufferAcquires;
+  std::vector<std::pair<uint64_t, vk::ImageMemoryBarrier2>> imageAcquires;
+
+  UploadStats stats;
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include "vertex_codec.hpp"
+
+#include <cstring>
+
+#include <glm/gtc/packing.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VERTEX_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+glm::i16vec2 octEncode(glm::vec3 n)
+{
+  n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+  glm::vec2 p(n.x, n.y);
+  if (n.z < 0.0f)
+  {
+    // lower hemisphere folds out over the diagonals
+    p = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * glm::vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+  }
+  return glm::i16vec2(glm::packSnorm1x16(p.x), glm::packSnorm1x16(p.y));
+}
+
+static glm::vec3 loadFloat3(const Float3Stream& in, size_t i)
+{
+  glm::vec3 v;
+  std::memcpy(&v, in.data + i * in.stride, sizeof(v));
+  return v;
+}
+
+#ifdef VERTEX_CODEC_SSE2
+// elements a 16-byte load may be used on, the element itself is only 12 bytes, so whatever the stride the last
+// one can end exactly at the end of its buffer view (or of a mapped file) and is always left to the scalar tail
+static size_t vectorCount(const Float3Stream& in)
+{
+  return in.count == 0 ? 0 : in.count - 1;
+}
+
+static __m128 loadLanes(const Float3Stream& in, size_t i)
+{
+  return _mm_loadu_ps(reinterpret_cast<const float*>(in.data + i * in.stride));
+}
+#endif
+
+void float3Bounds(const Float3Stream& in, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+  size_t i = 0;
+#ifdef VERTEX_CODEC_SSE2
+  if (vectorCount(in) > 0)
+  {
+    __m128 lo = _mm_setr_ps(boundsMin.x, boundsMin.y, boundsMin.z, 0.0f);
+    __m128 hi = _mm_setr_ps(boundsMax.x, boundsMax.y, boundsMax.z, 0.0f);
+    for (; i < vectorCount(in); i++)
+    {
+      const __m128 v = loadLanes(in, i);
+      lo = _mm_min_ps(lo, v);
+      hi = _mm_max_ps(hi, v);
+    }
+    alignas(16) float l[4], h[4];
+    _mm_store_ps(l, lo);
+    _mm_store_ps(h, hi);
+    boundsMin = glm::vec3(l[0], l[1], l[2]);
+    boundsMax = glm::vec3(h[0], h[1], h[2]);
+  }
+#endif
+  for (; i < in.count; i++)
+  {
+    const glm::vec3 v = loadFloat3(in, i);
+    boundsMin = glm::min(boundsMin, v);
+    boundsMax = glm::max(boundsMax, v);
+  }
+}
+
+void quantizeUnorm16(const Float3Stream& in, glm::vec3 offset, glm::vec3 scale, std::byte* out, size_t outStride)
+{
+  size_t i = 0;
+#ifdef VERTEX_CODEC_SSE2
+  const __m128 o = _mm_setr_ps(offset.x, offset.y, offset.z, 0.0f);
+  const __m128 s = _mm_setr_ps(scale.x, scale.y, scale.z, 0.0f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 unorm = _mm_set1_ps(65535.0f);
+  for (; i < vectorCount(in); i++)
+  {
+    const __m128 unit = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(loadLanes(in, i), o), s), zero), one);
+    alignas(16) int32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_cvtps_epi32(_mm_mul_ps(unit, unorm)));
+    const glm::u16vec3 q(lanes[0], lanes[1], lanes[2]);
+    std::memcpy(out + i * outStride, &q, sizeof(q));
+  }
+#endif
+  for (; i < in.count; i++)
+  {
+    const glm::vec3 unit = (loadFloat3(in, i) - offset) * scale;
+    const glm::u16vec3 q(glm::packUnorm1x16(unit.x), glm::packUnorm1x16(unit.y), glm::packUnorm1x16(unit.z));
+    std::memcpy(out + i * outStride, &q, sizeof(q));
+  }
+}
+
+void octEncodeSnorm16(const Float3Stream& in, std::byte* out, size_t outStride)
+{
+  size_t i = 0;
+#ifdef VERTEX_CODEC_SSE2
+  // four directions per iteration, transposed so each register holds one component of all four
+  const __m128 signBit = _mm_set1_ps(-0.0f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 snorm = _mm_set1_ps(32767.0f);
+  for (; i + 4 <= vectorCount(in); i += 4)
+  {
+    __m128 x = loadLanes(in, i);
+    __m128 y = loadLanes(in, i + 1);
+    __m128 z = loadLanes(in, i + 2);
+    __m128 w = loadLanes(in, i + 3);
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+
+    const __m128 ax = _mm_andnot_ps(signBit, x);
+    const __m128 ay = _mm_andnot_ps(signBit, y);
+    const __m128 inverse = _mm_div_ps(one, _mm_add_ps(_mm_add_ps(ax, ay), _mm_andnot_ps(signBit, z)));
+    x = _mm_mul_ps(x, inverse);
+    y = _mm_mul_ps(y, inverse);
+
+    // lower hemisphere folds out over the diagonals
+    const __m128 signX = _mm_or_ps(_mm_andnot_ps(_mm_cmpge_ps(x, zero), signBit), one);
+    const __m128 signY = _mm_or_ps(_mm_andnot_ps(_mm_cmpge_ps(y, zero), signBit), one);
+    const __m128 foldX = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(ay, inverse)), signX);
+    const __m128 foldY = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(ax, inverse)), signY);
+    const __m128 lower = _mm_cmplt_ps(z, zero);
+    x = _mm_or_ps(_mm_and_ps(lower, foldX), _mm_andnot_ps(lower, x));
+    y = _mm_or_ps(_mm_and_ps(lower, foldY), _mm_andnot_ps(lower, y));
+
+    x = _mm_max_ps(_mm_min_ps(x, one), _mm_sub_ps(zero, one));
+    y = _mm_max_ps(_mm_min_ps(y, one), _mm_sub_ps(zero, one));
+    alignas(16) int32_t lanesX[4], lanesY[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanesX), _mm_cvtps_epi32(_mm_mul_ps(x, snorm)));
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanesY), _mm_cvtps_epi32(_mm_mul_ps(y, snorm)));
+    for (size_t lane = 0; lane < 4; lane++)
+    {
+      const glm::i16vec2 p(lanesX[lane], lanesY[lane]);
+      std::memcpy(out + (i + lane) * outStride, &p, sizeof(p));
+    }
+  }
+#endif
+  for (; i < in.count; i++)
+  {
+    const glm::i16vec2 p = octEncode(loadFloat3(in, i));
+    std::memcpy(out + i * outStride, &p, sizeof(p));
+  }
+}
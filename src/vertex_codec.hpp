@@ -0,0 +1,32 @@
+#ifndef VERTEX_CODEC_HPP
+#define VERTEX_CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+// Float attributes to the compact vertex encodings, four lanes at a time with SSE2 where the target has it
+// Outputs are strided so they can write straight into interleaved vertices
+
+// float3 elements, or the xyz of float4s, in place in a buffer view
+struct Float3Stream {
+  const std::byte* data;
+  size_t count;
+  size_t stride; // bytes between elements, at least 12
+};
+
+// octahedral encoding, folds the unit sphere onto a square so a direction fits two snorm16s
+[[nodiscard]] glm::i16vec2 octEncode(glm::vec3 n);
+
+// componentwise min and max of every element, left untouched when there are none
+void float3Bounds(const Float3Stream& in, glm::vec3& boundsMin, glm::vec3& boundsMax);
+
+// (element - offset) * scale clamped to [0, 1], as three unorm16s at out + i * outStride
+void quantizeUnorm16(const Float3Stream& in, glm::vec3 offset, glm::vec3 scale, std::byte* out, size_t outStride);
+
+// octEncode of every element, as two snorm16s at out + i * outStride
+void octEncodeSnorm16(const Float3Stream& in, std::byte* out, size_t outStride);
+
+#endif